@@ -2,8 +2,10 @@
 
 #include "PlayerAI.h"
 
-#include <limits>
+#include <chrono>
 
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "EngineUtils.h"
 #include "Math/UnrealMathUtility.h"
 
@@ -14,6 +16,7 @@
 #include "Terrain.h"
 #include "AStar.h"
 #include "MovementRange.h"
+#include "DistanceFields.h"
 #include "HexGrid.h"
 #include "AkFlag.h"
 #include "Abilities/Ability.h"
@@ -22,6 +25,16 @@
 #define print(text) if(GEngine) GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Green, text);
 #define printFString(text, fstring) if (GEngine) GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Green, FString::Printf(TEXT(text), fstring));
 
+static TAutoConsoleVariable<int32> CVarTreeSearch(
+	TEXT("AI.TreeSearch"),
+	0,
+	TEXT("Pick the AI's moves and shift abilities with a tree search over the turns of both players, instead of its personalities."));
+
+static TAutoConsoleVariable<float> CVarTreeSearchBudgetMs(
+	TEXT("AI.TreeSearchBudgetMs"),
+	20.f,
+	TEXT("Milliseconds the tree search of the AI may spend on a turn."));
+
 void UPlayerAI::Initialize(UAkPlayer* InPlayer, UAkPlayer* InHumanPlayer)
 {
 	Player = InPlayer;
@@ -40,6 +53,15 @@ void UPlayerAI::Initialize(UAkPlayer* InPlayer, UAkPlayer* InHumanPlayer)
 	MovementRange = GameMode->GetMovementRange();
 	AStar = GameMode->GetAStar();
 
+	// Paths to flags and end zones are shared by every unit and turn, so keep them as distance fields.
+	DistanceFields = NewObject<UDistanceFields>(this);
+	DistanceFields->Initialize(HexGrid);
+
+	MoveSnapshot.adjacency = &DistanceFields->GetGridView().GetAdjacency();
+	DistanceFields->GetGridView().CopyTiles(MoveSnapshot.tiles);
+	FHexGridView::FindOrCreate(HexGrid)->OnTilesChanged().AddUObject(this, &UPlayerAI::OnGridTilesChanged);
+	ShiftPlanner.Initialize(MoveSnapshot.adjacency);
+
 	AnimEndCallback = FAnimEndDel::CreateUObject(this, &UPlayerAI::AnimationEnd);
 	
 	// Set flags.
@@ -58,6 +80,27 @@ void UPlayerAI::Initialize(UAkPlayer* InPlayer, UAkPlayer* InHumanPlayer)
 		}
 	}
 	destination = FlagToTake->OccupiedTile;
+	destinationGoals = { destination };
+
+	// Tree search, with a context for every task graph worker and the game thread.
+	const FHexGridView& GridView = DistanceFields->GetGridView();
+
+	TreeSearch.Initialize(&GridView, MoveSnapshot.tiles, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+	TreeSearchRules.adjacency = MoveSnapshot.adjacency;
+	TreeSearchRules.abilityBudget = ShiftAbilityBudget;
+
+	const uint8 TeamIds[] = { Player->TeamId, HumanPlayer->TeamId };
+	const AAkFlag* Flags[] = { FlagToProtect, FlagToTake };
+
+	for (int32 i = 0; i < AkPathfinding::TeamCount; ++i)
+	{
+		for (const FIntPoint& Tile : HexGrid->GetEndZoneTileCoords()[TeamIds[i]])
+		{
+			TreeSearchRules.endZones[i].push_back(GridView.ToIndex(Tile));
+		}
+
+		FlagHomes[i] = GridView.ToIndex(Flags[i]->OccupiedTile);
+	}
 	
 	// Set personalities.
 	if (GetTypeCanSpread(characters[0]->ElementType) == characters[1]->ElementType)
@@ -74,16 +117,24 @@ void UPlayerAI::Initialize(UAkPlayer* InPlayer, UAkPlayer* InHumanPlayer)
 
 void UPlayerAI::OnTurnBegan(UAkPlayer* InPlayer)
 {
+	// Tiles the other player changed came through FHexGridView::NotifyGridChanged, so the adjacency and MoveSnapshot are up to date.
 	FTimerHandle TimerHandle;
 	
 	GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &UPlayerAI::Planning, 1.f, false, 0);
 }
 
+void UPlayerAI::OnGridTilesChanged(const std::vector<int32_t>& Tiles)
+{
+	// A height change may leave the adjacency as it was, so copy the tiles whatever it did.
+	DistanceFields->GetGridView().CopyTiles(MoveSnapshot.tiles, Tiles);
+}
+
 void UPlayerAI::Planning()
 {
 	// Get character and current position.
 	ControllingCharacter = Player->GetControllingUnit();
 	position = Terrain->Grid->WorldToGrid(ControllingCharacter->GetActorLocation());
+	bTreeSearchTurn = CVarTreeSearch.GetValueOnGameThread() != 0;
 
 	// Is this turn for bump?
 	if (ControllingCharacter->ActiveAbility->AbilityType == EActionType::Bump)
@@ -104,10 +155,27 @@ void UPlayerAI::Planning()
 		UseAbility(ControllingCharacter, ControllingCharacter->ActiveAbility, Neighbors[FMath::RandRange(0, NeighborNum)]);
 		return;
 	}
+
+	if (bTreeSearchTurn)
+	{
+		PlanningTreeSearch();
+		return;
+	}
 	
 	if (ControllingCharacter->HasFlag)
 	{
-		destination = HexGrid->GetEndZoneTileCoords()[Player->TeamId][FMath::RandRange(0, HexGrid->GetEndZoneTileCoords()[Player->TeamId].Num()-1)];
+		destinationGoals = HexGrid->GetEndZoneTileCoords()[Player->TeamId];
+
+		// Nearest tile of the end zone by walking, from the field GetPositionToMove reads anyway.
+		// GetPositionToMove falls back to the straight line distance to it where the element can't walk.
+		if (DistanceFields->GetPath(DistanceFields->GetShortestField(destinationGoals), position, path))
+		{
+			destination = path.Num() > 0 ? path[0] : position;
+		}
+		else
+		{
+			destination = destinationGoals[0];
+		}
 		personalities[ControllingCharacter] = Personality::CarryingFlag;
 	}
 	
@@ -148,13 +216,94 @@ void UPlayerAI::Planning()
 		move = true;
 	}
 
-	// Path to ability target.
-	if (AStar->GetShortestPath(position, abilityTarget, path))
+	if (personalities[ControllingCharacter] == Personality::CarryingFlag)
+	{
+		// Head for the closest tile of the end zone.
+		if (DistanceFields->GetPath(DistanceFields->GetShortestField(destinationGoals), position, path) && path.Num() > 0)
+		{
+			abilityTarget = path[0];
+		}
+	}
+
+	// Walk toward the ability target from where the move ends, with the shift abilities clearing the way this turn.
+	const FHexGridView& GridView = DistanceFields->GetGridView();
+
+	ShiftPlanner.Plan(MoveSnapshot.tiles, GridView.ToIndex(position), GridView.ToIndex(abilityTarget), ElementMask::MapColor(ControllingCharacter->ElementType), ShiftAbilityBudget, ShiftPlan);
+	ShiftPlanIndex = 0;
+	AbilityNum = AkPathfinding::AbilityPlanner::GetAbilityCount(ShiftPlan);
+
+	// No movement.
+	if (move == false)
+	{
+		// Start to use shift abilities manually.
+		AnimationEnd();
+	}
+}
+
+void UPlayerAI::PlanningTreeSearch()
+{
+	const FHexGridView& GridView = DistanceFields->GetGridView();
+
+	// Tiles changed since the last turn, outside the budget.
+	TreeSearch.SetTiles(MoveSnapshot.tiles);
+
+	AkPathfinding::GameState State;
+
+	const UAkPlayer* Players[] = { Player, HumanPlayer };
+	const AAkFlag* Flags[] = { FlagToProtect, FlagToTake };
+
+	for (uint8 Team = 0; Team < AkPathfinding::TeamCount; ++Team)
+	{
+		State.flags[Team].home = FlagHomes[Team];
+		State.flags[Team].tile = GridView.ToIndex(Flags[Team]->OccupiedTile);
+		State.nextUnits[Team] = static_cast<int32_t>(State.units.size());
+
+		for (const AAkCharacter* Character : Players[Team]->ControllableUnits)
+		{
+			AkPathfinding::GameUnit Unit;
+			Unit.tile = GridView.ToIndex(HexGrid->WorldToGrid(Character->GetActorLocation()));
+			Unit.elementColor = ElementMask::MapColor(Character->ElementType);
+			Unit.team = Team;
+			Unit.bHasFlag = Character->HasFlag;
+
+			// The flag of the other team moves with its carrier.
+			if (Character->HasFlag)
+			{
+				State.flags[Team ^ 1].carrier = static_cast<int32_t>(State.units.size());
+				State.flags[Team ^ 1].tile = Unit.tile;
+			}
+
+			if (Character == ControllingCharacter)
+			{
+				State.nextUnits[Team] = static_cast<int32_t>(State.units.size());
+			}
+
+			State.units.push_back(Unit);
+		}
+	}
+
+	const std::chrono::microseconds Budget(static_cast<int64>(CVarTreeSearchBudgetMs.GetValueOnGameThread() * 1000.f));
+
+	const AkPathfinding::MonteCarloDecision Decision = TreeSearch.Decide(TreeSearchRules, State, Budget, [](int32_t count, const auto& body)
+	{
+		ParallelFor(count, body);
+	});
+
+	bool move = false;
+
+	const FIntPoint posToMove = GridView.ToPosition(Decision.moveTile);
+	if (position != posToMove)
 	{
-		AbilityNum = 3;
-		prevTile = nullptr;
+		UseAbility(ControllingCharacter, ControllingCharacter->MoveAbility, posToMove);
+		position = posToMove;
+		move = true;
 	}
 
+	// Shift abilities the search played after the move.
+	ShiftPlan = Decision.plan;
+	ShiftPlanIndex = 0;
+	AbilityNum = AkPathfinding::AbilityPlanner::GetAbilityCount(ShiftPlan);
+
 	// No movement.
 	if (move == false)
 	{
@@ -165,13 +314,26 @@ void UPlayerAI::Planning()
 
 void UPlayerAI::AnimationEnd()
 {
-	if (path.Num() == 0 || AbilityNum <= 0)
+	// The ability took effect, so update the grids searches use.
+	if (ChangedTiles.Num() > 0)
+	{
+		// The grid view is shared, so the adapters catch up on their next query and OnGridTilesChanged copies the tiles.
+		FHexGridView::NotifyGridChanged(HexGrid, ChangedTiles);
+		ChangedTiles.Reset();
+	}
+
+	if (AbilityNum <= 0)
 	{
 		ControllingCharacter->EndTurn();
 		return;
 	}
 
-	if (HexGrid->GetTileData(abilityTarget)->TopType == ControllingCharacter->ElementType)
+	// Turns of the tree search follow the plan to its end, its last tile is of the element before the abilities on the way are used.
+	const bool bDone = bTreeSearchTurn
+		? ShiftPlanIndex >= ShiftPlan.size()
+		: HexGrid->GetTileData(abilityTarget)->TopType == ControllingCharacter->ElementType;
+
+	if (bDone)
 	{
 		ControllingCharacter->EndTurn();
 		return;
@@ -183,55 +345,72 @@ void UPlayerAI::AnimationEnd()
 	GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &UPlayerAI::UseShiftAbility, 3.f, false, 0);
 }
 
-void UPlayerAI::UseAbility(AAkCharacter* Character,UAbility* Ability, FIntPoint TargetPoint) const
+void UPlayerAI::UseAbility(AAkCharacter* Character,UAbility* Ability, FIntPoint TargetPoint)
 {
 	Character->SelectAbility(Ability);
 	Ability->AnimEndCallback = AnimEndCallback;
 	
-	TArray<FIntPoint> tiles;
-
 	if (Ability == Character->MoveAbility)
 	{
-		AStar->GetPath(position, TargetPoint, tiles, Character->ElementType, true, true);		
+		AStar->GetPath(position, TargetPoint, AbilityTiles, Character->ElementType, true, true);		
 	}
 	else
 	{
-		tiles.Add(TargetPoint);
+		AbilityTiles.Reset();
+		AbilityTiles.Add(TargetPoint);
+		ChangedTiles.Add(TargetPoint);
 	}
 
-	Character->ActiveAbility->SetEffectingTiles(tiles);
+	Character->ActiveAbility->SetEffectingTiles(AbilityTiles);
 	Character->ActiveAbility->Use();
 }
 
-FIntPoint UPlayerAI::GetPositionToMove() const
+FIntPoint UPlayerAI::GetPositionToMove()
 {
 	const FIntPoint pos = Terrain->Grid->WorldToGrid(ControllingCharacter->GetActorLocation());
 	
-	TArray<FIntPoint> MovablePoints;
 	MovementRange->GetMovementRange(pos, 4, MovablePoints, ControllingCharacter->ElementType, false, false, false);
 
-	const int32 PointsNum = MovablePoints.Num();
-	int32 index = -1;
-	int32 minDistance = std::numeric_limits<int32>::max();
+	const FHexGridView& GridView = DistanceFields->GetGridView();
+
+	// The unit ends its move on its own element.
+	MoveCandidates.clear();
 
-	for (int32 i = 0; i < PointsNum; ++i)
+	for (const FIntPoint& point : MovablePoints)
 	{
-		if (HexGrid->GetTileData(MovablePoints[i])->TopType != ControllingCharacter->ElementType)
+		if (HexGrid->GetTileData(point)->TopType == ControllingCharacter->ElementType)
 		{
-			continue;
+			MoveCandidates.push_back(GridView.ToIndex(point));
 		}
-		
-		const int32 distance = HexGrid->Distance(MovablePoints[i], destination);
-		if (distance < minDistance)
+	}
+
+	// Guard the own flag, or the enemy carrying it away.
+	MoveThreats.clear();
+	int32 GuardTile = GridView.ToIndex(FlagToProtect->OccupiedTile);
+
+	for (const AAkCharacter* Enemy : HumanPlayer->ControllableUnits)
+	{
+		MoveThreats.push_back(GridView.ToIndex(HexGrid->WorldToGrid(Enemy->GetActorLocation())));
+
+		if (Enemy->HasFlag)
 		{
-			index = i;
-			minDistance = distance;
+			GuardTile = MoveThreats.back();
 		}
 	}
 
-	if (index >= 0)
+	// From there the unit follows the path of its element. Where that reaches nothing, the shortest path cleared with shift abilities.
+	const AkPathfinding::DistanceField& Field = DistanceFields->GetField(destinationGoals, ControllingCharacter->ElementType, false);
+	const AkPathfinding::DistanceField& FallbackField = DistanceFields->GetShortestField(destinationGoals);
+
+	const int32 Best = MoveEvaluator.Evaluate(MoveSnapshot, Field, FallbackField, ElementMask::MapColor(ControllingCharacter->ElementType), MoveCandidates, MoveThreats,
+		GuardTile, GridView.ToIndex(destination), std::chrono::microseconds(MoveBudgetMicroseconds), [](int32_t count, const auto& body)
+	{
+		ParallelFor(count, body);
+	});
+
+	if (Best != AkPathfinding::InvalidIndex)
 	{
-		return MovablePoints[index];
+		return GridView.ToPosition(Best);
 	}
 
 	return pos;
@@ -239,69 +418,34 @@ FIntPoint UPlayerAI::GetPositionToMove() const
 
 void UPlayerAI::UseShiftAbility()
 {
-	while (path.Num() > 0)
-	{
-		const FTileData* tile = HexGrid->GetTileData(position);
+	const FHexGridView& GridView = DistanceFields->GetGridView();
 
-		const FIntPoint& nextPos = path.Last();
-		const FTileData* nextTile = HexGrid->GetTileData(nextPos);
+	// Follow the plan up to its next ability.
+	while (ShiftPlanIndex < ShiftPlan.size())
+	{
+		const AkPathfinding::PlanStep& Step = ShiftPlan[ShiftPlanIndex++];
+		const FIntPoint Target = GridView.ToPosition(Step.tile);
 
-		if (tile->TopType == nextTile->TopType)
-		{
-			if (nextTile->Height > tile->Height + 1)
-			{
-				UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::LowerTile], nextPos);
-				return;
-			}
-			else if (nextTile->Height < tile->Height - 1)
-			{
-				UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::RaiseTile], nextPos);
-				return;
-			}
-			else // Passable
-			{
-				// Don't need to do anything here.
-				position = nextPos;
-				path.RemoveAt(path.Num()-1);
-				prevTile = tile;
-			}
-		}
-		else // Different color.
+		switch (Step.action)
 		{
-			if (tile->Height == nextTile->Height)
-			{
-				UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::ExpandTile], nextPos);
-			}
-			else if (nextTile->Height > tile->Height)
-			{
-				// After raising the current tile, it is still movable from the previous tile.
-				if (prevTile == nullptr ||
-					FMath::Abs(prevTile->Height - (tile->Height + 1)) <= 1)
-				{
-					UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::RaiseTile], position);
-				}
-				else // Can't raise the tile anymore.
-				{
-					// Nothing we can do.
-					ControllingCharacter->EndTurn();
-				}
-			}
-			else
-			{
-				// After lowering the current tile, it is still movable from the previous tile.
-				if (prevTile == nullptr ||
-					FMath::Abs(prevTile->Height - (tile->Height - 1)) <= 1)
-				{
-					UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::LowerTile], position);
-				}
-				else // Can't lower the tile anymore.
-				{
-					// Nothing we can do.
-					ControllingCharacter->EndTurn();
-				}
-			}
+		case AkPathfinding::PlanAction::Walk:
+			position = Target;
+			break;
+
+		case AkPathfinding::PlanAction::Raise:
+			UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::RaiseTile], Target);
+			return;
 
+		case AkPathfinding::PlanAction::Lower:
+			UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::LowerTile], Target);
+			return;
+
+		case AkPathfinding::PlanAction::Expand:
+			UseAbility(ControllingCharacter, ControllingCharacter->Abilities[(uint8)EActionType::ExpandTile], Target);
 			return;
 		}
 	}
+
+	// Nothing left to use.
+	ControllingCharacter->EndTurn();
 }
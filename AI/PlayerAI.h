@@ -5,6 +5,11 @@
 #include "CoreMinimal.h"
 #include "AkPlayerController.h"
 #include "UObject/NoExportTypes.h"
+
+#include "AbilityPlanner.h"
+#include "MonteCarloPlanner.h"
+#include "MoveEvaluation.h"
+
 #include "PlayerAI.generated.h"
 
 class AAkPlayerController;
@@ -13,6 +18,7 @@ class UAkPlayer;
 class UTurnSystem;
 class UAStar;
 class UMovementRange;
+class UDistanceFields;
 class ATerrain;
 class AAkFlag;
 class UHexGrid;
@@ -33,10 +39,16 @@ public:
 	void Planning();
 
 private:
+	// Keep MoveSnapshot up to date with tiles rebuilt in the shared grid view.
+	void OnGridTilesChanged(const std::vector<int32_t>& Tiles);
+
 	void AnimationEnd();
-	void UseAbility(AAkCharacter* Character, UAbility* Ability, FIntPoint TargetPoint) const;
+	void UseAbility(AAkCharacter* Character, UAbility* Ability, FIntPoint TargetPoint);
 	
-	FIntPoint GetPositionToMove() const;
+	// Move and shift abilities of the turn from a tree search over the turns of both players, instead of the personalities.
+	void PlanningTreeSearch();
+
+	FIntPoint GetPositionToMove();
 	//void PlanAbility(AAkCharacter* character, FIntPoint position, const FIntPoint& destination);
 	void UseShiftAbility();
 	
@@ -57,6 +69,8 @@ private:
 	UPROPERTY()
 	class UMovementRange* MovementRange;
 	UPROPERTY()
+	class UDistanceFields* DistanceFields;
+	UPROPERTY()
 	class ATerrain* Terrain;
 	UPROPERTY()
 	class UHexGrid* HexGrid;
@@ -73,11 +87,42 @@ private:
 	int AbilityNum;
 	TArray<FIntPoint> path;
 
+	// Tiles shift abilities changed since the last animation ended.
+	TArray<FIntPoint> ChangedTiles;
+
+	// Kept between turns, so searches fill them without allocating once they have grown.
+	TArray<FIntPoint> AbilityTiles;
+	TArray<FIntPoint> MovablePoints;
+
+	// Time GetPositionToMove may spend scoring where to move, however large the range.
+	int32 MoveBudgetMicroseconds = 2000;
+
+	AkPathfinding::MoveSnapshot MoveSnapshot;
+	AkPathfinding::MoveEvaluator MoveEvaluator;
+	std::vector<int32_t> MoveCandidates;
+	std::vector<int32_t> MoveThreats;
+
+	// Shift abilities a unit uses in a turn after moving.
+	static constexpr int32 ShiftAbilityBudget = 3;
+
+	AkPathfinding::AbilityPlanner ShiftPlanner;
+	std::vector<AkPathfinding::PlanStep> ShiftPlan;
+	// Next step of the plan UseShiftAbility follows.
+	size_t ShiftPlanIndex = 0;
+
+	// The AI is team 0 of the tree search, the human player team 1.
+	AkPathfinding::MonteCarloPlanner TreeSearch;
+	AkPathfinding::GameRules TreeSearchRules;
+	int32 FlagHomes[AkPathfinding::TeamCount];
+	// Whether the tree search planned this turn, so AnimationEnd follows its plan instead of the ability target.
+	bool bTreeSearchTurn = false;
+
 	UPROPERTY()
 	class AAkCharacter* ControllingCharacter;
-	const FTileData* prevTile;
 	FIntPoint position;
 	FIntPoint destination;
+	// Tiles any of which will do as the destination, goals of the distance field GetPositionToMove reads.
+	TArray<FIntPoint> destinationGoals;
 	FIntPoint abilityTarget;
 	
 	enum class Personality
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Replacement operators live alone in this file, so no caller sees a delete freeing what a new expression allocated.
+ * Inlined into the benchmarks, GCC would warn about every such pair.
+ */
+namespace
+{
+	std::atomic<int64_t> AllocatedBytes { 0 };
+
+	void* Allocate(std::size_t size)
+	{
+		AllocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+
+		if (void* memory = std::malloc(size == 0 ? 1 : size))
+		{
+			return memory;
+		}
+
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return Allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace AkBenchmark
+{
+	int64_t GetAllocatedBytes()
+	{
+		return AllocatedBytes.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+namespace AkBenchmark
+{
+	/*!
+	 * \brief Bytes requested from the global operator new so far.
+	 *		  Every allocation of the process counts, so only read it around the measured call.
+	 */
+	int64_t GetAllocatedBytes();
+}
@@ -0,0 +1,1143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include <benchmark/benchmark.h>
+
+#include "AbilityPlanner.h"
+#include "AdjacencyTable.h"
+#include "AllocationCounter.h"
+#include "AStarSearch.h"
+#include "ComponentIndex.h"
+#include "DistanceField.h"
+#include "GridSnapshot.h"
+#include "HexMap.h"
+#include "HierarchicalSearch.h"
+#include "IncrementalSearch.h"
+#include "MonteCarloPlanner.h"
+#include "MoveEvaluation.h"
+#include "PathBatch.h"
+#include "QueryCache.h"
+#include "RangeSearch.h"
+#include "SearchMetrics.h"
+#include "SearchPool.h"
+#include "SyntheticMap.h"
+#include "WorkerPool.h"
+
+using namespace AkPathfinding;
+using namespace AkBenchmark;
+
+namespace
+{
+	constexpr int32_t QueryNum = 64;
+
+	// Movement budget the AI passes to GetMovementRange.
+	constexpr int32_t MovementBudget = 4;
+
+	struct MapFixture
+	{
+		std::unique_ptr<HexMap> map;
+		AdjacencyTable adjacency;
+		std::vector<PathQuery> queries;
+	};
+
+	MapSettings ToSettings(const benchmark::State& state)
+	{
+		MapSettings settings;
+		settings.size = static_cast<int32_t>(state.range(0));
+		settings.blockPercent = static_cast<int32_t>(state.range(1));
+		settings.heightVariance = static_cast<int32_t>(state.range(2));
+		settings.mix = static_cast<ElementMix>(state.range(3));
+		return settings;
+	}
+
+	// Large maps take a while to generate, so share them between benchmarks and their threads.
+	const MapFixture& GetFixture(const MapSettings& settings)
+	{
+		static std::mutex mutex;
+		static std::map<std::tuple<int32_t, int32_t, int32_t, ElementMix>, MapFixture> fixtures;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		MapFixture& fixture = fixtures[std::make_tuple(settings.size, settings.blockPercent, settings.heightVariance, settings.mix)];
+		if (fixture.map == nullptr)
+		{
+			fixture.map = GenerateMap(settings);
+			fixture.adjacency.Build(fixture.map.get());
+			fixture.queries = GenerateQueries(*fixture.map, QueryNum, settings.seed);
+		}
+
+#if AK_PATHFINDING_METRICS
+		SearchMetrics::Get().SetMapLabel(settings.ToString());
+#endif
+
+		return fixture;
+	}
+
+	struct QueryCounters
+	{
+		int64_t expanded = 0;
+		int64_t nodeBytes = 0;
+		int64_t bytes = 0;
+		int64_t found = 0;
+
+		void Report(benchmark::State& state, const MapSettings& settings) const
+		{
+			state.SetItemsProcessed(state.iterations());
+			state.SetLabel(settings.ToString());
+
+			state.counters["expanded/query"] = benchmark::Counter(static_cast<double>(expanded), benchmark::Counter::kAvgIterations);
+			state.counters["time/expanded"] = benchmark::Counter(static_cast<double>(expanded), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+			state.counters["nodeBytes/query"] = benchmark::Counter(static_cast<double>(nodeBytes), benchmark::Counter::kAvgIterations);
+			state.counters["bytes/query"] = benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+			state.counters["found"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+		}
+	};
+
+	// Sizes from 16x16 to 1024x1024 on the default terrain, then each terrain knob on its own.
+	GridSnapshot ToSnapshot(const HexMap& map)
+	{
+		GridSnapshot snapshot;
+		snapshot.Initialize(map.GetTileCount());
+
+		for (int32_t tile = 0; tile < map.GetTileCount(); ++tile)
+		{
+			snapshot.SetTile(tile, map.GetTileHeight(tile), map.GetTileColor(tile));
+		}
+
+		return snapshot;
+	}
+
+	void MapArguments(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->ArgNames({ "size", "block", "height", "mix" });
+
+		for (int64_t size : { 16, 64, 256, 1024 })
+		{
+			benchmark->Args({ size, 10, 3, static_cast<int64_t>(ElementMix::Uniform) });
+		}
+
+		for (int64_t blockPercent : { 0, 25 })
+		{
+			benchmark->Args({ 256, blockPercent, 3, static_cast<int64_t>(ElementMix::Uniform) });
+		}
+
+		for (int64_t heightVariance : { 0, 6 })
+		{
+			benchmark->Args({ 256, 10, heightVariance, static_cast<int64_t>(ElementMix::Uniform) });
+		}
+
+		for (ElementMix mix : { ElementMix::StoneHeavy, ElementMix::Patches })
+		{
+			benchmark->Args({ 256, 10, 3, static_cast<int64_t>(mix) });
+		}
+	}
+}
+
+static void BM_GetShortestPath(benchmark::State& state, OpenListType openListType)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	search.SetOpenListType(openListType);
+	std::vector<int32_t> path;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = search.GetShortestPath(query.start, query.destination, path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_GetShortestPath, heap, OpenListType::BinaryHeap)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_GetShortestPath, buckets, OpenListType::Buckets)->Apply(MapArguments);
+
+static void BM_GetPath(benchmark::State& state, OpenListType openListType)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	search.SetOpenListType(openListType);
+	std::vector<int32_t> path;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Same flags UPlayerAI::UseAbility moves with.
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = search.GetPath(query.start, query.destination, path, query.elementColor, true, true);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_GetPath, heap, OpenListType::BinaryHeap)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_GetPath, buckets, OpenListType::Buckets)->Apply(MapArguments);
+
+// The BM_GetShortestPath and BM_GetPath queries searched from both ends; compare expanded/query with them.
+static void BM_GetPathBidirectional(benchmark::State& state, bool bShortestPath)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	std::vector<int32_t> path;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		PathRequest request = bShortestPath
+			? AStarSearch::MakeShortestPathRequest(query.start, query.destination)
+			: AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+		request.bBidirectional = true;
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = search.FindPath(request, path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_GetPathBidirectional, shortest, true)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_GetPathBidirectional, path, false)->Apply(MapArguments);
+
+// Paths to the nearest of eight goals, the destinations of the next queries: one search to the set (multi),
+// or one search per goal keeping the cheapest (each), the way a single target search would pick.
+static void BM_GetPathToAny(benchmark::State& state, bool bMultiGoal)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	constexpr size_t GoalNum = 8;
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	std::vector<int32_t> path;
+	std::vector<int32_t> goals;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex % fixture.queries.size()];
+
+		goals.clear();
+
+		for (size_t i = 1; i <= GoalNum; ++i)
+		{
+			goals.push_back(fixture.queries[(queryIndex + i) % fixture.queries.size()].destination);
+		}
+
+		++queryIndex;
+
+		PathRequest request = AStarSearch::MakePathRequest(query.start, query.start, query.elementColor, true, true);
+		bool bFound = false;
+
+		if (bMultiGoal)
+		{
+			bFound = search.FindPathToAny(request, goals, path);
+			counters.expanded += search.GetStats().nodesExpanded;
+		}
+		else
+		{
+			for (const int32_t goal : goals)
+			{
+				request.destination = goal;
+				bFound |= search.FindPath(request, path);
+				counters.expanded += search.GetStats().nodesExpanded;
+			}
+		}
+
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_GetPathToAny, multi, true)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_GetPathToAny, each, false)->Apply(MapArguments);
+
+// Test_Height behind a pointer WithNodeTester doesn't know, so the search calls it per neighbor instead of inlining it.
+static bool IndirectHeightTest(const NodePool& nodePool, int32_t, int32_t neighborNode, bool bPassable)
+{
+	return nodePool.IsBlocked(neighborNode) == false && bPassable;
+}
+
+static void BM_GetPathIndirect(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	std::vector<int32_t> path;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		PathRequest request = AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+		request.nodeBlockTest = &IndirectHeightTest;
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = search.FindPath(request, path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_GetPathIndirect)->Apply(MapArguments);
+
+static void BM_GetPathComponents(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	AStarSearch search;
+	search.Initialize(&fixture.adjacency);
+	std::vector<int32_t> path;
+
+	// Labels of every element used by the queries are built up front, like UAStar after the first queries.
+	ComponentIndex components;
+	components.Initialize(&fixture.adjacency);
+
+	for (const PathQuery& query : fixture.queries)
+	{
+		components.GetLabels(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true));
+	}
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Same flags as BM_GetPath, rejected without a search when there is no path.
+		const PathRequest request = AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bReachable = components.CanReach(request);
+		const bool bFound = bReachable && search.FindPath(request, path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		if (bReachable)
+		{
+			const SearchStats stats = search.GetStats();
+			counters.expanded += stats.nodesExpanded;
+			counters.nodeBytes += stats.nodeBytes;
+		}
+
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_GetPathComponents)->Apply(MapArguments);
+
+static void BM_GetPathHierarchical(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Cluster graphs of every element used by the queries are built up front.
+	HierarchicalSearch search;
+	search.Initialize(&fixture.adjacency, fixture.map->GetWidth());
+	std::vector<int32_t> path;
+
+	for (const PathQuery& query : fixture.queries)
+	{
+		search.FindPath(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true), path);
+	}
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Same flags as BM_GetPath.
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = search.FindPath(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true), path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_GetPathHierarchical)->Apply(MapArguments);
+
+static void BM_GetMovementRange(benchmark::State& state, OpenListType openListType)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	RangeSearch search;
+	search.Initialize(&fixture.adjacency);
+	search.SetOpenListType(openListType);
+	std::vector<int32_t> range;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Same flags UPlayerAI::GetPositionToMove searches with.
+		const int64_t bytesBefore = GetAllocatedBytes();
+		search.GetMovementRange(query.start, MovementBudget, range, query.elementColor, false, false, false);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = search.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += static_cast<int64_t>(range.size());
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_GetMovementRange, heap, OpenListType::BinaryHeap)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_GetMovementRange, buckets, OpenListType::Buckets)->Apply(MapArguments);
+
+// Queries of a few units asked again and again, with a tile edit now and then, like a turn of UPlayerAI behind UAStar's cache.
+static void BM_GetPathCached(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Keep the shared fixture untouched.
+	HexMap map = *fixture.map;
+	AdjacencyTable adjacency;
+	adjacency.Build(&map);
+
+	AStarSearch search;
+	search.Initialize(&adjacency);
+	QueryCache cache;
+	cache.Initialize(&adjacency);
+
+	constexpr size_t UnitNum = 4;
+	constexpr int32_t QueriesPerEdit = 16;
+
+	std::vector<int32_t> path;
+	std::vector<int32_t> visitedTiles;
+	std::vector<int32_t> tiles(1);
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+	int32_t queriesLeft = QueriesPerEdit;
+
+	for (auto _ : state)
+	{
+		// Raise or lower a tile on the way of one of the units.
+		if (--queriesLeft == 0)
+		{
+			const PathQuery& query = fixture.queries[queryIndex % UnitNum];
+			tiles[0] = (query.start + query.destination) / 2;
+
+			map.SetTile(tiles[0], map.GetTileHeight(tiles[0]) + (queryIndex & 1 ? -1 : 1), map.GetTileColor(tiles[0]), map.IsBlocked(tiles[0]));
+			adjacency.RebuildTiles(tiles);
+			cache.NotifyTilesChanged(tiles);
+
+			queriesLeft = QueriesPerEdit;
+		}
+
+		const PathQuery& query = fixture.queries[queryIndex++ % UnitNum];
+		const PathRequest request = AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+		const QueryKey key = QueryKey::MakePathKey(request);
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		bool bFound;
+
+		if (const QueryCache::Result* cached = cache.Find(key))
+		{
+			path = cached->tiles;
+			bFound = cached->bFound;
+		}
+		else
+		{
+			bFound = search.FindPath(request, path);
+			search.GetVisitedTiles(visitedTiles);
+			cache.AddPath(key, bFound, path, visitedTiles);
+
+			counters.expanded += search.GetStats().nodesExpanded;
+			counters.nodeBytes += search.GetStats().nodeBytes;
+		}
+
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+	state.counters["hits"] = benchmark::Counter(static_cast<double>(cache.GetHitCount()), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GetPathCached)->Apply(MapArguments);
+
+static void BM_GetPathPooled(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Shared by all threads of the run. Threads wait for each other before the loop starts.
+	static SearchPool<AStarSearch> searches;
+
+	if (state.thread_index() == 0)
+	{
+		searches.Initialize(&fixture.adjacency);
+	}
+
+	QueryCounters counters;
+	size_t queryIndex = static_cast<size_t>(state.thread_index());
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Other threads allocate meanwhile too, so this is the total of all queries in flight.
+		const int64_t bytesBefore = GetAllocatedBytes();
+		auto context = searches.Acquire();
+		const bool bFound = context->search.GetPath(query.start, query.destination, context->tiles, query.elementColor, true, true);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		counters.expanded += context->search.GetStats().nodesExpanded;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_GetPathPooled)->ArgNames({ "size", "block", "height", "mix" })->Args({ 64, 10, 3, 0 })->Args({ 256, 10, 3, 0 })->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_FindPaths(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	WorkerPool workers(static_cast<int32_t>(state.range(4)));
+	SearchPool<AStarSearch> searches;
+	searches.Initialize(&fixture.adjacency);
+
+	// The whole query set in one batch, with the flags UPlayerAI::UseAbility moves with.
+	std::vector<PathRequest> requests;
+
+	for (const PathQuery& query : fixture.queries)
+	{
+		requests.push_back(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true));
+	}
+
+	std::vector<PathResult> results;
+	int64_t bytes = 0;
+	int64_t found = 0;
+
+	for (auto _ : state)
+	{
+		const int64_t bytesBefore = GetAllocatedBytes();
+		FindPaths(searches, requests, results, [&](int32_t count, const std::function<void(int32_t)>& body)
+		{
+			workers.ParallelFor(count, body);
+		});
+		bytes += GetAllocatedBytes() - bytesBefore;
+
+		for (const PathResult& result : results)
+		{
+			found += result.bFound;
+		}
+	}
+
+	// Per query rather than per batch.
+	const double queryNum = static_cast<double>(state.iterations() * static_cast<int64_t>(requests.size()));
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(requests.size()));
+	state.SetLabel(settings.ToString());
+	state.counters["bytes/query"] = static_cast<double>(bytes) / queryNum;
+	state.counters["found"] = static_cast<double>(found) / queryNum;
+}
+BENCHMARK(BM_FindPaths)->ArgNames({ "size", "block", "height", "mix", "workers" })->Args({ 64, 10, 3, 0, 0 })->Args({ 64, 10, 3, 0, 3 })->Args({ 256, 10, 3, 0, 0 })->Args({ 256, 10, 3, 0, 3 })->UseRealTime();
+
+static void BM_RebuildTiles(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Keep the shared fixture untouched.
+	AdjacencyTable adjacency = fixture.adjacency;
+	std::vector<int32_t> tiles(1);
+
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		// A Raise, Lower or Expand ability touches a single tile.
+		tiles[0] = fixture.queries[queryIndex++ % fixture.queries.size()].destination;
+		adjacency.RebuildTiles(tiles);
+
+		benchmark::DoNotOptimize(adjacency.GetLinks(tiles[0]).passableMask);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(settings.ToString());
+}
+BENCHMARK(BM_RebuildTiles)->Apply(MapArguments);
+
+static void BM_DistanceFieldBuild(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	DistanceField field;
+	field.Initialize(&fixture.adjacency);
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Same rules UPlayerAI::GetPositionToMove reads the field with.
+		const PathRequest request = AStarSearch::MakePathRequest(InvalidIndex, InvalidIndex, query.elementColor, true, true);
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		field.Build({ query.destination }, request.pathColor, request.nodeBlockTest);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = field.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += field.GetDistance(query.start) != INT32_MAX;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_DistanceFieldBuild)->Apply(MapArguments);
+
+static void BM_DistanceFieldRepair(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Keep the shared fixture untouched.
+	HexMap map = *fixture.map;
+	AdjacencyTable adjacency;
+	adjacency.Build(&map);
+
+	const PathQuery& goalQuery = fixture.queries[0];
+	const PathRequest request = AStarSearch::MakePathRequest(InvalidIndex, InvalidIndex, goalQuery.elementColor, true, true);
+
+	DistanceField field;
+	field.Initialize(&adjacency);
+	field.Build({ goalQuery.destination }, request.pathColor, request.nodeBlockTest);
+
+	// Change tiles the field reaches, others rarely matter.
+	std::vector<int32_t> reachedTiles;
+
+	for (int32_t tile = 0; tile < adjacency.GetTileCount(); ++tile)
+	{
+		if (field.GetDistance(tile) != INT32_MAX)
+		{
+			reachedTiles.push_back(tile);
+		}
+	}
+
+	std::vector<int32_t> tiles(1);
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const size_t index = queryIndex++;
+
+		// A Raise ability, then a Lower one on the same tile the next time around.
+		tiles[0] = reachedTiles[(index / 2 * 7919) % reachedTiles.size()];
+		const int32_t heightChange = index % 2 == 0 ? 1 : -1;
+		map.SetTile(tiles[0], map.GetTileHeight(tiles[0]) + heightChange, map.GetTileColor(tiles[0]), map.IsBlocked(tiles[0]));
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		adjacency.RebuildTiles(tiles);
+		field.Repair(tiles);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = field.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += field.GetDistance(tiles[0]) != INT32_MAX;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_DistanceFieldRepair)->Apply(MapArguments);
+
+// Candidate moves of UPlayerAI::GetPositionToMove, the tiles of the element within a radius wider than a turn so the budget matters.
+static void BM_EvaluateMoves(benchmark::State& state)
+{
+	constexpr int32_t CandidateRadius = 12;
+
+	MapSettings settings;
+	settings.size = static_cast<int32_t>(state.range(0));
+	const MapFixture& fixture = GetFixture(settings);
+
+	WorkerPool workers(static_cast<int32_t>(state.range(1)));
+	const std::chrono::microseconds budget(state.range(2));
+
+	MoveSnapshot snapshot;
+	snapshot.adjacency = &fixture.adjacency;
+	snapshot.tiles = ToSnapshot(*fixture.map);
+
+	DistanceField field;
+	field.Initialize(&fixture.adjacency);
+	DistanceField fallbackField;
+	fallbackField.Initialize(&fixture.adjacency);
+	MoveEvaluator evaluator;
+
+	std::vector<int32_t> candidates;
+	std::vector<int32_t> threats;
+	int64_t candidateNum = 0;
+	int64_t evaluated = 0;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Set up as the AI does on the game thread, outside the budget.
+		state.PauseTiming();
+		candidates.clear();
+
+		for (int32_t tile = 0; tile < fixture.adjacency.GetTileCount(); ++tile)
+		{
+			if ((fixture.adjacency.GetLinks(tile).color & query.elementColor) != 0 && fixture.adjacency.Distance(query.start, tile) <= CandidateRadius)
+			{
+				candidates.push_back(tile);
+			}
+		}
+
+		// The unit's own rules first, the shortest path cleared with shift abilities where they reach nothing.
+		const PathRequest request = AStarSearch::MakePathRequest(InvalidIndex, InvalidIndex, query.elementColor, false, true);
+		field.Build({ query.destination }, request.pathColor, request.nodeBlockTest);
+
+		const PathRequest fallbackRequest = AStarSearch::MakeShortestPathRequest(InvalidIndex, InvalidIndex);
+		fallbackField.Build({ query.destination }, fallbackRequest.pathColor, fallbackRequest.nodeBlockTest);
+
+		threats.clear();
+		threats.push_back(fixture.queries[queryIndex % fixture.queries.size()].start);
+		threats.push_back(fixture.queries[(queryIndex + 1) % fixture.queries.size()].start);
+
+		// A flag next to the first enemy, so the threat counts.
+		const int32_t guardTile = fixture.adjacency.GetLinks(threats[0]).neighbors[0];
+		state.ResumeTiming();
+
+		const int32_t best = evaluator.Evaluate(snapshot, field, fallbackField, query.elementColor, candidates, threats, guardTile, query.destination, budget, [&](int32_t count, const std::function<void(int32_t)>& body)
+		{
+			workers.ParallelFor(count, body);
+		});
+		benchmark::DoNotOptimize(best);
+
+		candidateNum += static_cast<int64_t>(candidates.size());
+		evaluated += evaluator.GetEvaluatedCount();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(settings.ToString());
+	state.counters["candidates"] = static_cast<double>(candidateNum) / state.iterations();
+	state.counters["evaluated"] = static_cast<double>(evaluated) / static_cast<double>(std::max<int64_t>(candidateNum, 1));
+}
+BENCHMARK(BM_EvaluateMoves)->ArgNames({ "size", "workers", "budget_us" })->Args({ 256, 0, 2000 })->Args({ 256, 3, 2000 })->Args({ 256, 0, 50 })->Args({ 256, 3, 50 })->Iterations(256)->UseRealTime();
+
+// A lookahead trying the abilities UPlayerAI::UseShiftAbility would use around a unit, then searching its path on the result.
+static void BM_SpeculativePath(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	const GridSnapshot base = ToSnapshot(*fixture.map);
+	SnapshotGrid grid;
+	grid.Initialize(fixture.map.get(), base);
+
+	AStarSearch search;
+	search.Initialize(&grid.GetAdjacency());
+	std::vector<int32_t> path;
+
+	QueryCounters counters;
+	int64_t rebuilt = 0;
+	int64_t sharedPages = 0;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		// Raise the tiles around the start and expand the unit's element onto them.
+		GridSnapshot edited = base;
+		const TileLinks& links = grid.GetAdjacency().GetLinks(query.start);
+
+		for (int i = 0; i < links.neighborCount; ++i)
+		{
+			edited.SetTile(links.neighbors[i], edited.GetHeight(links.neighbors[i]) + 1, query.elementColor);
+		}
+
+		grid.SetSnapshot(edited);
+		rebuilt += static_cast<int64_t>(grid.GetChangedTiles().size());
+		sharedPages += edited.GetSharedPageCount(base);
+
+		const bool bFound = search.GetPath(query.start, query.destination, path, query.elementColor, true, true);
+
+		// Roll back.
+		grid.SetSnapshot(base);
+
+		counters.expanded += search.GetStats().nodesExpanded;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+	state.counters["rebuilt"] = benchmark::Counter(static_cast<double>(rebuilt), benchmark::Counter::kAvgIterations);
+	state.counters["sharedPages"] = benchmark::Counter(static_cast<double>(sharedPages), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SpeculativePath)->Apply(MapArguments);
+
+// Plans of UPlayerAI::Planning toward the query destinations, within the shift abilities of one or two turns.
+static void BM_PlanShiftAbilities(benchmark::State& state, int32_t abilityBudget)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	const GridSnapshot tiles = ToSnapshot(*fixture.map);
+
+	AbilityPlanner planner;
+	planner.Initialize(&fixture.adjacency);
+	std::vector<PlanStep> plan;
+
+	QueryCounters counters;
+	int64_t abilities = 0;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		const bool bFound = planner.Plan(tiles, query.start, query.destination, query.elementColor, abilityBudget, plan);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = planner.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+		abilities += AbilityPlanner::GetAbilityCount(plan);
+	}
+
+	counters.Report(state, settings);
+	state.counters["abilities"] = benchmark::Counter(static_cast<double>(abilities), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_CAPTURE(BM_PlanShiftAbilities, turn, 3)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_PlanShiftAbilities, two_turns, 6)->Apply(MapArguments);
+
+// A decision of a three on three match, the flags at the two ends of a query and the end zones around them.
+static void BM_MonteCarloDecision(benchmark::State& state)
+{
+	constexpr int32_t UnitsPerTeam = 3;
+	constexpr int32_t EndZoneRadius = 2;
+
+	MapSettings settings;
+	settings.size = static_cast<int32_t>(state.range(0));
+	const MapFixture& fixture = GetFixture(settings);
+
+	WorkerPool workers(static_cast<int32_t>(state.range(1)));
+	const std::chrono::milliseconds budget(state.range(2));
+
+	// The game thread searches too.
+	MonteCarloPlanner planner;
+	planner.Initialize(fixture.map.get(), ToSnapshot(*fixture.map), workers.GetWorkerCount() + 1);
+
+	// Flags as far apart as the queries get.
+	const PathQuery& match = *std::max_element(fixture.queries.begin(), fixture.queries.end(), [&](const PathQuery& lhs, const PathQuery& rhs)
+	{
+		return fixture.adjacency.Distance(lhs.start, lhs.destination) < fixture.adjacency.Distance(rhs.start, rhs.destination);
+	});
+	const int32_t homes[TeamCount] = { match.start, match.destination };
+
+	GameRules rules;
+	rules.adjacency = &fixture.adjacency;
+
+	GameState root;
+
+	for (uint8_t team = 0; team < TeamCount; ++team)
+	{
+		for (int32_t tile = 0; tile < fixture.adjacency.GetTileCount(); ++tile)
+		{
+			if (fixture.adjacency.Distance(tile, homes[team]) <= EndZoneRadius)
+			{
+				rules.endZones[team].push_back(tile);
+			}
+		}
+
+		root.flags[team].home = homes[team];
+		root.flags[team].tile = homes[team];
+		root.nextUnits[team] = static_cast<int32_t>(root.units.size());
+
+		// Units on the query starts closest to the flag.
+		std::vector<PathQuery> starts = fixture.queries;
+		std::partial_sort(starts.begin(), starts.begin() + UnitsPerTeam + 1, starts.end(), [&](const PathQuery& lhs, const PathQuery& rhs)
+		{
+			return fixture.adjacency.Distance(lhs.start, homes[team]) < fixture.adjacency.Distance(rhs.start, homes[team]);
+		});
+
+		for (int32_t i = 0; i <= UnitsPerTeam && root.units.size() < static_cast<size_t>((team + 1) * UnitsPerTeam); ++i)
+		{
+			if (starts[i].start != homes[team])
+			{
+				root.units.push_back({ starts[i].start, starts[i].elementColor, team, false });
+			}
+		}
+	}
+
+	int64_t iterations = 0;
+	int64_t visits = 0;
+	double overrun = 0.0;
+
+	for (auto _ : state)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const MonteCarloDecision decision = planner.Decide(rules, root, budget, [&](int32_t count, const std::function<void(int32_t)>& body)
+		{
+			workers.ParallelFor(count, body);
+		});
+		benchmark::DoNotOptimize(decision.moveTile);
+
+		overrun = std::max(overrun, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start - budget).count());
+		iterations += decision.iterations;
+		visits += decision.visits;
+	}
+
+	state.SetItemsProcessed(iterations);
+	state.SetLabel(settings.ToString());
+	state.counters["rollouts"] = benchmark::Counter(static_cast<double>(iterations), benchmark::Counter::kAvgIterations);
+	state.counters["moveVisits"] = benchmark::Counter(static_cast<double>(visits), benchmark::Counter::kAvgIterations);
+	state.counters["maxOverrun_us"] = overrun;
+}
+BENCHMARK(BM_MonteCarloDecision)->ArgNames({ "size", "workers", "budget_ms" })->Args({ 64, 0, 5 })->Args({ 64, 3, 5 })->Args({ 256, 0, 20 })->Args({ 256, 3, 20 })->Iterations(32)->UseRealTime();
+
+static void BM_ComponentRebuild(benchmark::State& state)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Keep the shared fixture untouched.
+	HexMap map = *fixture.map;
+	AdjacencyTable adjacency;
+	adjacency.Build(&map);
+
+	const PathRequest request = AStarSearch::MakePathRequest(InvalidIndex, InvalidIndex, fixture.queries[0].elementColor, true, true);
+
+	ComponentLabels labels;
+	labels.Build(&adjacency, request.pathColor, request.nodeBlockTest);
+
+	std::vector<int32_t> tiles(1);
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		const size_t index = queryIndex++;
+
+		// A Raise ability, then a Lower one on the same tile the next time around.
+		tiles[0] = static_cast<int32_t>((index / 2 * 7919) % adjacency.GetTileCount());
+		const int32_t heightChange = index % 2 == 0 ? 1 : -1;
+		map.SetTile(tiles[0], map.GetTileHeight(tiles[0]) + heightChange, map.GetTileColor(tiles[0]), map.IsBlocked(tiles[0]));
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		adjacency.RebuildTiles(tiles);
+		labels.RebuildTiles(tiles);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = labels.GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += labels.GetLabel(tiles[0]) != InvalidIndex;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK(BM_ComponentRebuild)->Apply(MapArguments);
+
+static void BM_ReplanAfterEdit(benchmark::State& state, bool bIncremental)
+{
+	const MapSettings settings = ToSettings(state);
+	const MapFixture& fixture = GetFixture(settings);
+
+	// Keep the shared fixture untouched.
+	HexMap map = *fixture.map;
+	AdjacencyTable adjacency;
+	adjacency.Build(&map);
+
+	AStarSearch search;
+	search.Initialize(&adjacency);
+	IncrementalSearch incremental;
+	incremental.Initialize(&adjacency);
+
+	auto FindPath = [&](const PathRequest& request, std::vector<int32_t>& OutPath) -> bool
+	{
+		return bIncremental ? incremental.FindPath(request, OutPath) : search.FindPath(request, OutPath);
+	};
+
+	auto GetStats = [&]() -> SearchStats
+	{
+		return bIncremental ? incremental.GetStats() : search.GetStats();
+	};
+
+	PathRequest request;
+	std::vector<int32_t> path;
+	std::vector<int32_t> tiles(1);
+	bool bRaised = false;
+
+	// Edits far from the path change nothing, so move on to another query now and then.
+	constexpr int32_t ReplansPerQuery = 8;
+	int32_t replansLeft = 0;
+
+	QueryCounters counters;
+	size_t queryIndex = 0;
+
+	for (auto _ : state)
+	{
+		if (path.empty() || replansLeft-- == 0)
+		{
+			// Head for the next destination with a path, not measured.
+			state.PauseTiming();
+			path.clear();
+
+			// Put back the tile of the last query.
+			if (bRaised)
+			{
+				map.SetTile(tiles[0], map.GetTileHeight(tiles[0]) - 1, map.GetTileColor(tiles[0]), map.IsBlocked(tiles[0]));
+				adjacency.RebuildTiles(tiles);
+				incremental.NotifyTilesChanged(tiles);
+				bRaised = false;
+			}
+
+			for (size_t tries = 0; tries < fixture.queries.size() && path.empty(); ++tries)
+			{
+				const PathQuery& query = fixture.queries[queryIndex++ % fixture.queries.size()];
+				request = AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+				FindPath(request, path);
+			}
+
+			replansLeft = ReplansPerQuery - 1;
+			state.ResumeTiming();
+		}
+
+		// Raise a tile halfway along the path, then lower it back, like the AI's shift abilities.
+		if (bRaised == false && path.empty() == false)
+		{
+			tiles[0] = path[path.size() / 2];
+		}
+
+		map.SetTile(tiles[0], map.GetTileHeight(tiles[0]) + (bRaised ? -1 : 1), map.GetTileColor(tiles[0]), map.IsBlocked(tiles[0]));
+		bRaised = bRaised == false;
+
+		const int64_t bytesBefore = GetAllocatedBytes();
+		adjacency.RebuildTiles(tiles);
+
+		if (bIncremental)
+		{
+			incremental.NotifyTilesChanged(tiles);
+		}
+
+		const bool bFound = FindPath(request, path);
+		counters.bytes += GetAllocatedBytes() - bytesBefore;
+
+		const SearchStats stats = GetStats();
+		counters.expanded += stats.nodesExpanded;
+		counters.nodeBytes += stats.nodeBytes;
+		counters.found += bFound;
+	}
+
+	counters.Report(state, settings);
+}
+BENCHMARK_CAPTURE(BM_ReplanAfterEdit, astar, false)->Apply(MapArguments);
+BENCHMARK_CAPTURE(BM_ReplanAfterEdit, incremental, true)->Apply(MapArguments);
+
+#if AK_PATHFINDING_METRICS
+// Same as BENCHMARK_MAIN, then dump what the queries recorded next to the working directory.
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	const SearchMetrics& metrics = SearchMetrics::Get();
+
+	std::ofstream histograms("PathfindingHistograms.csv");
+	metrics.WriteHistograms(histograms);
+
+	std::ofstream slowest("PathfindingSlowestQueries.csv");
+	metrics.WriteSlowestQueries(slowest);
+
+	std::ofstream trace("PathfindingTrace.json");
+	metrics.WriteTrace(trace);
+
+	return 0;
+}
+#else
+BENCHMARK_MAIN();
+#endif
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SyntheticMap.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace AkPathfinding;
+
+namespace AkBenchmark
+{
+	namespace
+	{
+		constexpr uint8_t Elements[] = { ElementMask::Stone, ElementMask::Water, ElementMask::Vine, ElementMask::Fire, ElementMask::Lightning };
+		constexpr int32_t ElementNum = sizeof(Elements) / sizeof(Elements[0]);
+
+		// Tiles per patch seed of ElementMix::Patches.
+		constexpr int32_t PatchArea = 48;
+
+		const char* ToString(ElementMix mix)
+		{
+			switch (mix)
+			{
+			case ElementMix::StoneHeavy:
+				return "stone";
+
+			case ElementMix::Patches:
+				return "patches";
+
+			default:
+				return "uniform";
+			}
+		}
+
+		uint8_t PickElement(ElementMix mix, std::mt19937& random)
+		{
+			if (mix == ElementMix::StoneHeavy && std::uniform_int_distribution<int32_t>(0, 1)(random) == 0)
+			{
+				return ElementMask::Stone;
+			}
+
+			return Elements[std::uniform_int_distribution<int32_t>(0, ElementNum - 1)(random)];
+		}
+
+		std::vector<float> GenerateHeights(const HexMap& map, int32_t heightVariance, std::mt19937& random)
+		{
+			const int32_t tileCount = map.GetTileCount();
+			std::uniform_real_distribution<float> noise(0.f, static_cast<float>(heightVariance));
+
+			std::vector<float> field(tileCount);
+			for (float& value : field)
+			{
+				value = noise(random);
+			}
+
+			// Box blur over hex neighbors to get hills instead of spikes.
+			std::vector<float> blurred(tileCount);
+			for (int pass = 0; pass < 3; ++pass)
+			{
+				for (int32_t tile = 0; tile < tileCount; ++tile)
+				{
+					int32_t neighbors[MaxNeighbors];
+					const int neighborCount = map.GetNeighbors(tile, neighbors);
+
+					float sum = field[tile];
+					for (int i = 0; i < neighborCount; ++i)
+					{
+						sum += field[neighbors[i]];
+					}
+
+					blurred[tile] = sum / static_cast<float>(neighborCount + 1);
+				}
+
+				field.swap(blurred);
+			}
+
+			// Blurring flattens the field, so stretch it back to the full variance.
+			const auto range = std::minmax_element(field.begin(), field.end());
+			const float low = *range.first;
+			const float spread = std::max(*range.second - low, 0.0001f);
+
+			for (float& value : field)
+			{
+				value = (value - low) / spread * static_cast<float>(heightVariance);
+			}
+
+			return field;
+		}
+	}
+
+	std::string MapSettings::ToString() const
+	{
+		return std::to_string(size) + "x" + std::to_string(size)
+			+ " block:" + std::to_string(blockPercent) + "%"
+			+ " height:" + std::to_string(heightVariance)
+			+ " mix:" + AkBenchmark::ToString(mix);
+	}
+
+	std::unique_ptr<HexMap> GenerateMap(const MapSettings& settings)
+	{
+		std::unique_ptr<HexMap> map = std::make_unique<HexMap>(settings.size, settings.size);
+		std::mt19937 random(settings.seed);
+
+		const int32_t tileCount = map->GetTileCount();
+		const std::vector<float> heights = GenerateHeights(*map, settings.heightVariance, random);
+
+		// Colors.
+		std::vector<uint8_t> colors(tileCount);
+
+		if (settings.mix == ElementMix::Patches)
+		{
+			// Nearest patch seed by hex distance. Brute force is fine at benchmark setup time.
+			const int32_t patchNum = std::max(1, tileCount / PatchArea);
+			std::uniform_int_distribution<int32_t> tileDistribution(0, tileCount - 1);
+
+			std::vector<int32_t> seeds(patchNum);
+			std::vector<uint8_t> seedColors(patchNum);
+			for (int32_t i = 0; i < patchNum; ++i)
+			{
+				seeds[i] = tileDistribution(random);
+				seedColors[i] = PickElement(ElementMix::Uniform, random);
+			}
+
+			// Grow patches breadth first from every seed at once instead of comparing distances to all seeds.
+			std::vector<int32_t> frontier(seeds);
+			std::vector<uint8_t> assigned(tileCount, 0);
+			for (int32_t i = 0; i < patchNum; ++i)
+			{
+				assigned[seeds[i]] = 1;
+				colors[seeds[i]] = seedColors[i];
+			}
+
+			for (size_t head = 0; head < frontier.size(); ++head)
+			{
+				const int32_t tile = frontier[head];
+
+				int32_t neighbors[MaxNeighbors];
+				const int neighborCount = map->GetNeighbors(tile, neighbors);
+
+				for (int i = 0; i < neighborCount; ++i)
+				{
+					if (assigned[neighbors[i]] == 0)
+					{
+						assigned[neighbors[i]] = 1;
+						colors[neighbors[i]] = colors[tile];
+						frontier.push_back(neighbors[i]);
+					}
+				}
+			}
+		}
+		else
+		{
+			for (uint8_t& color : colors)
+			{
+				color = PickElement(settings.mix, random);
+			}
+		}
+
+		// Heights and blocks.
+		std::uniform_int_distribution<int32_t> percent(0, 99);
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			const int32_t tileHeight = static_cast<int32_t>(heights[tile] + 0.5f);
+			const bool bBlocked = percent(random) < settings.blockPercent;
+
+			map->SetTile(tile, tileHeight, colors[tile], bBlocked);
+		}
+
+		return map;
+	}
+
+	std::vector<PathQuery> GenerateQueries(const HexMap& map, int32_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<int32_t> tileDistribution(0, map.GetTileCount() - 1);
+
+		const auto pickTile = [&]()
+		{
+			int32_t tile = tileDistribution(random);
+			while (map.IsBlocked(tile))
+			{
+				tile = tileDistribution(random);
+			}
+			return tile;
+		};
+
+		std::vector<PathQuery> queries(count);
+		for (PathQuery& query : queries)
+		{
+			query.start = pickTile();
+			query.destination = pickTile();
+			query.elementColor = map.GetTileColor(query.start);
+		}
+
+		return queries;
+	}
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HexMap.h"
+
+namespace AkBenchmark
+{
+	enum class ElementMix : int32_t
+	{
+		// Every element equally likely, tile by tile.
+		Uniform,
+		// Half of the tiles are stone, the rest split evenly.
+		StoneHeavy,
+		// Large single element regions, like painted battlefields.
+		Patches,
+	};
+
+	struct MapSettings
+	{
+		int32_t size = 64;
+		int32_t blockPercent = 10;
+		int32_t heightVariance = 3;
+		ElementMix mix = ElementMix::Uniform;
+		uint32_t seed = 1;
+
+		std::string ToString() const;
+	};
+
+	/*!
+	 * \brief Build a square map. Same settings always produce the same map.
+	 *
+	 *		  Heights are smoothed noise in [0, heightVariance], so neighboring tiles are mostly passable.
+	 */
+	std::unique_ptr<AkPathfinding::HexMap> GenerateMap(const MapSettings& settings);
+
+	struct PathQuery
+	{
+		int32_t start;
+		int32_t destination;
+		uint8_t elementColor;
+	};
+
+	/*!
+	 * \brief Random queries between unblocked tiles.
+	 *		  Element color of each query is the color of its start tile, like a unit standing on its own element.
+	 */
+	std::vector<PathQuery> GenerateQueries(const AkPathfinding::HexMap& map, int32_t count, uint32_t seed);
+}
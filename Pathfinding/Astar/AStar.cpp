@@ -4,138 +4,270 @@
 #include "AStar.h"
 #include "HexGrid.h"
 
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeRWLock.h"
+
+#include "PathBatch.h"
+
 void UAStar::Initialize(UHexGrid* InHexGrid)
 {
 	HexGrid = InHexGrid;
-	nodePool.HexGrid = HexGrid;
+	GridView = FHexGridView::FindOrCreate(HexGrid);
+	GridStamp = GridView->GetStamp();
+
+	Searches.Initialize(&GridView->GetAdjacency());
+	Incremental.Initialize(&GridView->GetAdjacency());
+	Hierarchical.Initialize(&GridView->GetAdjacency(), GridView->GetGridWidth());
+	Components.Initialize(&GridView->GetAdjacency());
+	Cache.Initialize(&GridView->GetAdjacency());
 }
 
-bool UAStar::GetShortestPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath)
+void UAStar::SetOpenListType(AkPathfinding::OpenListType type)
 {
-	return AstarSearch(start, destination, OutPath, ElementMask::Any, &NodeTester::Test_None);
+	Searches.SetOpenListType(type);
 }
 
-bool UAStar::GetPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination)
+void UAStar::NotifyTilesChanged(const TArray<FIntPoint>& Positions)
 {
-	const uint8 ElementType = ElementMask::MapColor(InElementType);
+	GridView->NotifyTilesChanged(Positions);
+	SyncGrid();
+}
+
+void UAStar::RefreshGrid()
+{
+	GridView->RefreshAdjacency();
+	SyncGrid();
+}
+
+void UAStar::SyncGrid()
+{
+	if (IsInGameThread() == false)
+	{
+		return;
+	}
 
-	// Check destination.
-	if (allowAnyDestination == false)
 	{
-		// Check destination tile type.
-		if (HexGrid->TestTileElement(destination, InElementType) == false &&
-			HexGrid->TestTileElement(destination, EAkElementType::Stone) == false &&
-			(allowWaterType == false || HexGrid->TestTileElement(destination, EAkElementType::Water) == false))
+		FScopeLock Lock(&CacheLock);
+
+		// Paths are valid for the stamp the cache last caught up with.
+		if (Cache.GetVersion() != GridView->GetStamp())
+		{
+			GridView->GetChangedTilesSince(Cache.GetVersion(), CacheChangedTiles);
+			Cache.NotifyTilesChanged(CacheChangedTiles);
+		}
+	}
+
+	{
+		FWriteScopeLock WriteLock(ComponentsLock);
+
+		// Every query returns early on these labels, so they follow the stamp like the cache.
+		if (Components.GetVersion() != GridView->GetStamp())
 		{
-			return false;
+			GridView->GetChangedTilesSince(Components.GetVersion(), ComponentsChangedTiles);
+			Components.NotifyTilesChanged(ComponentsChangedTiles);
 		}
 	}
 
-	if (allowWaterType)
+	if (GridStamp == GridView->GetStamp())
+	{
+		return;
+	}
+
+	GridView->GetChangedTilesSince(GridStamp, GridChangedTiles);
+	GridStamp = GridView->GetStamp();
+
 	{
-		return AstarSearch(start, destination, OutPath, ElementType | ElementMask::Stone | ElementMask::Water, &NodeTester::Test_Height); 
+		FScopeLock Lock(&IncrementalLock);
+		Incremental.NotifyTilesChanged(GridChangedTiles);
 	}
-	
-	return AstarSearch(start, destination, OutPath, ElementType | ElementMask::Stone, &NodeTester::Test_Height);
+
+	FScopeLock Lock(&HierarchicalLock);
+	Hierarchical.NotifyTilesChanged(GridChangedTiles);
 }
 
-bool UAStar::AstarSearch(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, uint8 pathColor, NodeBlockTest nodeBlockTest)
+bool UAStar::GetShortestPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath)
 {
-	SearchKickOff(start, OutPath);
+	return FindPath(AkPathfinding::AStarSearch::MakeShortestPathRequest(GridView->ToIndex(start), GridView->ToIndex(destination)), OutPath);
+}
+
+bool UAStar::GetPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination)
+{
+	return FindPath(AkPathfinding::AStarSearch::MakePathRequest(GridView->ToIndex(start), GridView->ToIndex(destination), ElementMask::MapColor(InElementType), allowWaterType, allowAnyDestination), OutPath);
+}
+
+bool UAStar::GetShortestPathBidirectional(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath)
+{
+	AkPathfinding::PathRequest Request = AkPathfinding::AStarSearch::MakeShortestPathRequest(GridView->ToIndex(start), GridView->ToIndex(destination));
+	Request.bBidirectional = true;
+
+	return FindPath(Request, OutPath);
+}
+
+bool UAStar::GetPathBidirectional(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination)
+{
+	AkPathfinding::PathRequest Request = AkPathfinding::AStarSearch::MakePathRequest(GridView->ToIndex(start), GridView->ToIndex(destination), ElementMask::MapColor(InElementType), allowWaterType, allowAnyDestination);
+	Request.bBidirectional = true;
+
+	return FindPath(Request, OutPath);
+}
+
+bool UAStar::FindPath(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath)
+{
+	AK_PATHFINDING_TRACE_SCOPE(UAStar_FindPath);
+	SyncGrid();
+
+	const AkPathfinding::QueryKey Key = AkPathfinding::QueryKey::MakePathKey(request);
 
-	// Do search.
-	while (openList.Num() > 0)
 	{
-		const int32 currNodeIndex = openList.PopIndex();
-		SearchNode& currNodeUnsafe = nodePool[currNodeIndex];
-		currNodeUnsafe.bIsClosed = true;
-
-		const FIntPoint& currNodePos = currNodeUnsafe.position;
-		
-		// We found destination.
-		if (currNodePos == destination)
-		{
-			while (currNodeUnsafe.position != start)
-			{
-				OutPath.Add(currNodeUnsafe.position);
-				currNodeUnsafe = nodePool[currNodeUnsafe.parentIndex];
-			}
-			
-			return true;
-		}
+		FScopeLock Lock(&CacheLock);
 
-		// Color test must be after destination checking to allow different types of destinations.
-		if ((ElementMask::MapColor(currNodeUnsafe.tileData->TopType) & pathColor) == 0)
+		if (const AkPathfinding::QueryCache::Result* Cached = Cache.Find(Key))
 		{
-			// Not allowed color.
-			continue;
+			GridView->ToPositions(Cached->tiles, OutPath);
+			return Cached->bFound;
 		}
+	}
+
+	if (CanReach(request) == false)
+	{
+		// No search needed.
+		OutPath.Reset();
+		return false;
+	}
+
+	auto Context = Searches.Acquire();
 
-		// Grab neighbors to expand.
-		THexNeighbors neighbors;
-		const int neighborCount = HexGrid->GetNeighbors(currNodePos, neighbors);
+	const bool bFound = Context->search.FindPath(request, Context->tiles);
+	GridView->ToPositions(Context->tiles, OutPath);
 
-		// Check all neighbors.
-		for (int i = 0; i < neighborCount; ++i)
+	FScopeLock Lock(&CacheLock);
+	Context->search.GetVisitedTiles(CacheVisitedTiles);
+	Cache.AddPath(Key, bFound, Context->tiles, CacheVisitedTiles);
+
+	return bFound;
+}
+
+bool UAStar::CanReach(const AkPathfinding::PathRequest& request)
+{
+	{
+		FReadScopeLock ReadLock(ComponentsLock);
+
+		if (const AkPathfinding::ComponentLabels* Labels = Components.FindLabels(request))
 		{
-			const FIntPoint& neighborNodePos = neighbors[i];
-			SearchNode& neighborNode = nodePool.FindOrAdd(neighborNodePos);
-
-			// If it is starting point, it is guaranteed to be passable.
-			if (neighborNodePos != start)
-			{
-				// If it isn't, do test.
-				if ((*nodeBlockTest)(currNodeUnsafe, neighborNode, HexGrid) == false)
-				{
-					// Blocked tile.
-					continue;
-				}
-			}
-			
-			const int32 newCost = currNodeUnsafe.cost + HexGrid->GetCost(currNodePos, neighborNodePos);
-			const int32 newHeuristic = UHexGrid::Distance(neighborNodePos, destination);
-			const int32 newTotalCost = newCost + newHeuristic;
-
-			// If this is not better than previous approach,
-			if (newTotalCost >= neighborNode.totalCost)
-			{
-				// skip.
-				continue;
-			}
-
-			// Fill in.
-			neighborNode.cost = newCost;
-			ensure(newCost > 0);
-			neighborNode.totalCost = newTotalCost;
-			
-			neighborNode.parentPos = currNodePos;
-			neighborNode.parentIndex = currNodeIndex;
-			neighborNode.bIsClosed = false;
-
-			// If this node is not in the open list,
-			if (neighborNode.bIsOpened == false)
-			{
-				// add to the open list.
-				openList.Push(neighborNode);
-			}
+			return AkPathfinding::ComponentIndex::CanReach(*Labels, request);
 		}
 	}
 
-	// No path found.
-	return false;
+	// First query with these rules labels the grid.
+	FWriteScopeLock WriteLock(ComponentsLock);
+	return Components.CanReach(request);
+}
+
+bool UAStar::GetShortestPathIncremental(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath)
+{
+	return FindPathIncremental(AkPathfinding::AStarSearch::MakeShortestPathRequest(GridView->ToIndex(start), GridView->ToIndex(destination)), OutPath);
+}
+
+bool UAStar::GetPathIncremental(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination)
+{
+	return FindPathIncremental(AkPathfinding::AStarSearch::MakePathRequest(GridView->ToIndex(start), GridView->ToIndex(destination), ElementMask::MapColor(InElementType), allowWaterType, allowAnyDestination), OutPath);
+}
+
+bool UAStar::FindPathIncremental(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath)
+{
+	AK_PATHFINDING_TRACE_SCOPE(UAStar_FindPathIncremental);
+	SyncGrid();
+
+	if (CanReach(request) == false)
+	{
+		// Keep the tree for the next query.
+		OutPath.Reset();
+		return false;
+	}
+
+	FScopeLock Lock(&IncrementalLock);
+
+	const bool bFound = Incremental.FindPath(request, IncrementalTiles);
+	GridView->ToPositions(IncrementalTiles, OutPath);
+	return bFound;
+}
+
+bool UAStar::GetShortestPathHierarchical(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath)
+{
+	return FindPathHierarchical(AkPathfinding::AStarSearch::MakeShortestPathRequest(GridView->ToIndex(start), GridView->ToIndex(destination)), OutPath);
+}
+
+bool UAStar::GetPathHierarchical(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination)
+{
+	return FindPathHierarchical(AkPathfinding::AStarSearch::MakePathRequest(GridView->ToIndex(start), GridView->ToIndex(destination), ElementMask::MapColor(InElementType), allowWaterType, allowAnyDestination), OutPath);
+}
+
+bool UAStar::FindPathHierarchical(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath)
+{
+	AK_PATHFINDING_TRACE_SCOPE(UAStar_FindPathHierarchical);
+	SyncGrid();
+
+	if (CanReach(request) == false)
+	{
+		OutPath.Reset();
+		return false;
+	}
+
+	FScopeLock Lock(&HierarchicalLock);
+
+	const bool bFound = Hierarchical.FindPath(request, HierarchicalTiles);
+	GridView->ToPositions(HierarchicalTiles, OutPath);
+	return bFound;
 }
 
-void UAStar::SearchKickOff(const FIntPoint& start, TArray<FIntPoint>& OutPath)
+void UAStar::GetPaths(const TArray<FAkPathQuery>& Queries, TArray<FAkPathResult>& OutResults)
 {
-	// Reset all containers.
-	nodePool.Reset();
-	openList.Reset();
-	OutPath.Reset();
+	AK_PATHFINDING_TRACE_SCOPE(UAStar_GetPaths);
+	SyncGrid();
+
+	std::vector<AkPathfinding::PathRequest> Requests;
+	Requests.reserve(Queries.Num());
 
-	// Push start node and kick off the search.
-	SearchNode& startNode = nodePool.Add(start);
-	startNode.cost = 0;
-	startNode.totalCost = 0;
+	// Only queries that may find a path go to the workers.
+	TArray<int32> QueryIndices;
+	QueryIndices.Reserve(Queries.Num());
+
+	OutResults.SetNum(Queries.Num());
+
+	for (int32 i = 0; i < Queries.Num(); ++i)
+	{
+		const FAkPathQuery& Query = Queries[i];
+		const int32 start = GridView->ToIndex(Query.Start);
+		const int32 destination = GridView->ToIndex(Query.Destination);
 
-	openList.Push(startNode);
+		const AkPathfinding::PathRequest request = Query.bShortestPath
+			? AkPathfinding::AStarSearch::MakeShortestPathRequest(start, destination)
+			: AkPathfinding::AStarSearch::MakePathRequest(start, destination, ElementMask::MapColor(Query.ElementType), Query.bAllowWaterType, Query.bAllowAnyDestination);
+
+		if (CanReach(request) == false)
+		{
+			OutResults[i].bFound = false;
+			OutResults[i].Path.Reset();
+			continue;
+		}
+
+		Requests.push_back(request);
+		QueryIndices.Add(i);
+	}
+
+	std::vector<AkPathfinding::PathResult> Results;
+	AkPathfinding::FindPaths(Searches, Requests, Results, [](int32_t count, const auto& body)
+	{
+		ParallelFor(count, [&body](int32 index)
+		{
+			AK_PATHFINDING_TRACE_SCOPE(UAStar_GetPaths_Query);
+			body(index);
+		});
+	});
+
+	for (int32 i = 0; i < QueryIndices.Num(); ++i)
+	{
+		OutResults[QueryIndices[i]].bFound = Results[i].bFound;
+		GridView->ToPositions(Results[i].tiles, OutResults[QueryIndices[i]].Path);
+	}
 }
@@ -7,12 +7,47 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+
+#include "AStarSearch.h"
+#include "ComponentIndex.h"
+#include "HierarchicalSearch.h"
+#include "IncrementalSearch.h"
+#include "QueryCache.h"
+#include "SearchPool.h"
+
 #include "AStar.generated.h"
 
 class UHexGrid;
 
+// A query of UAStar::GetPaths.
+struct PATHFINDING_API FAkPathQuery
+{
+	FIntPoint Start = FIntPoint::ZeroValue;
+	FIntPoint Destination = FIntPoint::ZeroValue;
+
+	// Search like GetShortestPath, ignoring the rest.
+	bool bShortestPath = false;
+
+	// Arguments of GetPath.
+	EAkElementType ElementType = EAkElementType::Stone;
+	bool bAllowWaterType = true;
+	bool bAllowAnyDestination = true;
+};
+
+struct PATHFINDING_API FAkPathResult
+{
+	bool bFound = false;
+	TArray<FIntPoint> Path;
+};
+
 /**
- * 
+ * Adapter from UHexGrid positions to AkPathfinding::AStarSearch.
+ * Path queries may run on any thread at the same time, each borrows a search context.
+ * Initialize, SetOpenListType, NotifyTilesChanged and RefreshGrid run on the game thread and must not overlap with queries.
+ * Queries on the game thread first catch up with tiles changed through the shared FHexGridView, so they must not overlap with queries on other threads either.
+ * Incremental queries share one search and run one at a time, and so do hierarchical queries.
+ * Every query first checks connected components of the grid, so a query without a path returns without searching.
+ * Results of GetShortestPath and GetPath are kept until a tile their search visited changes, so repeated queries don't search.
  */
 UCLASS()
 class PATHFINDING_API UAStar : public UObject
@@ -22,39 +57,94 @@ class PATHFINDING_API UAStar : public UObject
 public:
 	void Initialize(UHexGrid* InHexGrid);
 
-	bool GetShortestPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath);
-	bool GetPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination);
-	
-private:
-	typedef bool (*NodeBlockTest)(const SearchNode&, const SearchNode&, UHexGrid*);
-	
+	// Binary heap by default. Buckets suit grids with small step costs.
+	void SetOpenListType(AkPathfinding::OpenListType type);
+
+	// Searches use a cached copy of the grid, shared with the other adapters. Pass tiles whose height or type changed.
+	void NotifyTilesChanged(const TArray<FIntPoint>& Positions);
+	// Rebuild the cached grid, when changed tiles are unknown. The incremental search repairs where it differs.
+	void RefreshGrid();
+
 	/*!
 	* \brief Find a path from the given position to the destination.
 	*
-	* \param start
-	*		 Origin position to start the search.
-	*
-	* \param destination
-	*		 Goal of the path.
-	*
 	* \param OutPath
-	*		 All points for the path includes the destination.
+	*		 All points for the path includes the destination, from the destination back to the start.
 	*		 Start position is excluded.
 	*	
 	* \return bool
 	*		  If a path is found, return true.
 	*		  If there is no path, return false.
 	*/
-	bool AstarSearch(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, uint8 pathColor, NodeBlockTest nodeBlockTest);
-	
-	void SearchKickOff(const FIntPoint& start, TArray<FIntPoint>& OutPath);
-	
+	bool GetShortestPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath);
+	bool GetPath(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination);
+
+	/*!
+	* \brief Same as GetShortestPath and GetPath, but the search is kept for the next query (D* Lite).
+	*		  While the destination and rules stay the same, the next query only searches again what changed:
+	*		  tiles passed to NotifyTilesChanged and the move of the start.
+	*/
+	bool GetShortestPathIncremental(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath);
+	bool GetPathIncremental(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination);
+
+	/*!
+	* \brief Same as GetShortestPath and GetPath, but searched over clusters of tiles first (HPA*).
+	*		  Much faster on large grids, but the path may be a little longer than the shortest.
+	*		  Clusters are built per element on first use, and rebuilt where tiles change.
+	*/
+	bool GetShortestPathHierarchical(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath);
+	bool GetPathHierarchical(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination);
+
+	/*!
+	* \brief Same as GetShortestPath and GetPath, but searched from both ends until they meet. The path is as short.
+	*		  Expands about half the nodes where colors or heights make the search wander, like long element paths across the map.
+	*		  On open ground GetShortestPath already heads straight for the destination, and searching from both ends costs more.
+	*/
+	bool GetShortestPathBidirectional(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath);
+	bool GetPathBidirectional(const FIntPoint& start, const FIntPoint& destination, TArray<FIntPoint>& OutPath, EAkElementType InElementType, bool allowWaterType, bool allowAnyDestination);
+
+	/*!
+	* \brief Run all queries on the task graph and fill results of the same index.
+	*		  Paths are in the same order as GetPath.
+	*/
+	void GetPaths(const TArray<FAkPathQuery>& Queries, TArray<FAkPathResult>& OutResults);
+
+private:
+	bool FindPath(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath);
+	bool FindPathIncremental(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath);
+	bool FindPathHierarchical(const AkPathfinding::PathRequest& request, TArray<FIntPoint>& OutPath);
+
+	// Pass tiles changed since their stamps on to the caches and searches. Game thread only.
+	void SyncGrid();
+
+	// False if the request can't find a path. Labels the grid for the rules of the request on first use.
+	bool CanReach(const AkPathfinding::PathRequest& request);
+
 private:
 	UPROPERTY(Transient)
 	UHexGrid* HexGrid = nullptr;
 
-	NodePool nodePool;
-	NodeSorter nodeSorter = NodeSorter(nodePool);
-	OpenList openList = OpenList(nodePool, nodeSorter);
-};
+	TSharedPtr<FHexGridView> GridView;
+	AkPathfinding::SearchPool<AkPathfinding::AStarSearch> Searches;
 
+	// Stamp of the view the searches below last caught up with. The cache and components keep their own.
+	uint32 GridStamp = 0;
+	std::vector<int32_t> GridChangedTiles;
+
+	FCriticalSection CacheLock;
+	AkPathfinding::QueryCache Cache;
+	std::vector<int32_t> CacheVisitedTiles;
+	std::vector<int32_t> CacheChangedTiles;
+
+	FRWLock ComponentsLock;
+	AkPathfinding::ComponentIndex Components;
+	std::vector<int32_t> ComponentsChangedTiles;
+
+	FCriticalSection IncrementalLock;
+	AkPathfinding::IncrementalSearch Incremental;
+	std::vector<int32_t> IncrementalTiles;
+
+	FCriticalSection HierarchicalLock;
+	AkPathfinding::HierarchicalSearch Hierarchical;
+	std::vector<int32_t> HierarchicalTiles;
+};
@@ -0,0 +1,632 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AStarSearch.h"
+
+#include <cassert>
+
+#include "SearchMetrics.h"
+
+namespace AkPathfinding
+{
+	void AStarSearch::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+		nodePool.Initialize(Adjacency);
+
+		bReversePoolInitialized = false;
+		bReverseSearched = false;
+	}
+
+	void AStarSearch::SetOpenListType(OpenListType type)
+	{
+		openList.Reset();
+		openList.SetType(type);
+
+		reverseList.Reset();
+		reverseList.SetType(type);
+	}
+
+	bool AStarSearch::GetShortestPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath)
+	{
+		return FindPath(MakeShortestPathRequest(start, destination), OutPath);
+	}
+
+	bool AStarSearch::GetPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath, uint8_t elementColor, bool allowWaterType, bool allowAnyDestination)
+	{
+		return FindPath(MakePathRequest(start, destination, elementColor, allowWaterType, allowAnyDestination), OutPath);
+	}
+
+	PathRequest AStarSearch::MakeShortestPathRequest(int32_t start, int32_t destination)
+	{
+		PathRequest request;
+		request.start = start;
+		request.destination = destination;
+
+		return request;
+	}
+
+	PathRequest AStarSearch::MakePathRequest(int32_t start, int32_t destination, uint8_t elementColor, bool allowWaterType, bool allowAnyDestination)
+	{
+		uint8_t pathColor = elementColor | ElementMask::Stone;
+
+		if (allowWaterType)
+		{
+			pathColor |= ElementMask::Water;
+		}
+
+		PathRequest request;
+		request.start = start;
+		request.destination = destination;
+		request.pathColor = pathColor;
+		request.destinationColor = allowAnyDestination ? ElementMask::Any : pathColor;
+		request.nodeBlockTest = &NodeTester::Test_Height;
+
+		return request;
+	}
+
+	bool AStarSearch::FindPath(const PathRequest& request, std::vector<int32_t>& OutPath)
+	{
+		// Check destination tile type.
+		if (request.destinationColor != ElementMask::Any && (Adjacency->GetLinks(request.destination).color & request.destinationColor) == 0)
+		{
+			stats.Reset();
+			nodePool.Reset();
+			bReverseSearched = false;
+			OutPath.clear();
+			return false;
+		}
+
+		const int32_t length = Search(request);
+
+		if (length == InvalidIndex)
+		{
+			// No path found.
+			OutPath.clear();
+			return false;
+		}
+
+		// The depth gives the length, so the path is written in place instead of growing.
+		OutPath.resize(length);
+		WritePath(OutPath.data());
+
+		return true;
+	}
+
+	int32_t AStarSearch::FindPath(const PathRequest& request, int32_t* OutTiles, int32_t capacity)
+	{
+		// Check destination tile type.
+		if (request.destinationColor != ElementMask::Any && (Adjacency->GetLinks(request.destination).color & request.destinationColor) == 0)
+		{
+			stats.Reset();
+			nodePool.Reset();
+			bReverseSearched = false;
+			return InvalidIndex;
+		}
+
+		const int32_t length = Search(request);
+
+		if (length != InvalidIndex && length <= capacity)
+		{
+			WritePath(OutTiles);
+		}
+
+		return length;
+	}
+
+	bool AStarSearch::FindPathToAny(const PathRequest& request, const std::vector<int32_t>& Goals, std::vector<int32_t>& OutPath)
+	{
+		stats.Reset();
+		bReverseSearched = false;
+		reversePathNode = InvalidIndex;
+
+		goalSet.Build(Adjacency, Goals, request.destinationColor);
+
+		if (goalSet.IsEmpty())
+		{
+			// No goal of the destination color.
+			nodePool.Reset();
+			OutPath.clear();
+			return false;
+		}
+
+		{
+			AK_PATHFINDING_QUERY_SCOPE(QueryKind::MultiGoalPath, request.start, static_cast<int32_t>(goalSet.GetGoals().size()), stats, &nodePool, &openList);
+
+			pathNode = WithNodeTester(request.nodeBlockTest, [&](auto tester) { return Search(request.start, goalSet, request.pathColor, tester); });
+		}
+
+		if (pathNode == InvalidIndex)
+		{
+			// No path found.
+			OutPath.clear();
+			return false;
+		}
+
+		OutPath.resize(nodePool.depths[pathNode]);
+		WritePath(OutPath.data());
+
+		return true;
+	}
+
+	bool AStarSearch::AstarSearch(int32_t start, int32_t destination, std::vector<int32_t>& OutPath, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		PathRequest request;
+		request.start = start;
+		request.destination = destination;
+		request.pathColor = pathColor;
+		request.nodeBlockTest = nodeBlockTest;
+
+		return FindPath(request, OutPath);
+	}
+
+	int32_t AStarSearch::Search(const PathRequest& request)
+	{
+		stats.Reset();
+
+		reversePathNode = InvalidIndex;
+
+		// A path to the start itself has nothing to meet in the middle.
+		bReverseSearched = request.bBidirectional && request.start != request.destination;
+
+		if (bReverseSearched)
+		{
+			AK_PATHFINDING_QUERY_SCOPE(QueryKind::BidirectionalPath, request.start, request.destination, stats, nullptr, nullptr);
+
+			return WithNodeTester(request.nodeBlockTest, [&](auto tester) { return SearchBidirectional(request.start, request.destination, request.pathColor, tester); });
+		}
+
+		AK_PATHFINDING_QUERY_SCOPE(QueryKind::Path, request.start, request.destination, stats, &nodePool, &openList);
+
+		const SingleGoal goal { Adjacency, request.destination };
+		pathNode = WithNodeTester(request.nodeBlockTest, [&](auto tester) { return Search(request.start, goal, request.pathColor, tester); });
+
+		return pathNode != InvalidIndex ? nodePool.depths[pathNode] : InvalidIndex;
+	}
+
+	void GoalSet::Build(const AdjacencyTable* InAdjacency, const std::vector<int32_t>& Goals, uint8_t destinationColor)
+	{
+		Adjacency = InAdjacency;
+
+		if (static_cast<int32_t>(goalTiles.size()) != Adjacency->GetTileCount())
+		{
+			goalTiles.assign(Adjacency->GetTileCount(), 0);
+		}
+		else
+		{
+			// Clear the goals of the last build only.
+			for (const int32_t goal : goals)
+			{
+				goalTiles[goal] = 0;
+			}
+		}
+
+		goals.clear();
+
+		for (const int32_t goal : Goals)
+		{
+			if (goalTiles[goal] == 0 && (destinationColor == ElementMask::Any || (Adjacency->GetLinks(goal).color & destinationColor) != 0))
+			{
+				goalTiles[goal] = 1;
+				goals.push_back(goal);
+			}
+		}
+
+		// Widen the clusters until few enough hold every goal. The widest radius a grid needs is its diameter.
+		int32_t radius = 0;
+
+		while (TryCluster(radius) == false)
+		{
+			radius = std::max(radius * 2, 1);
+		}
+	}
+
+	bool GoalSet::TryCluster(int32_t radius)
+	{
+		clusters.clear();
+
+		for (const int32_t goal : goals)
+		{
+			bool bClustered = false;
+
+			for (Cluster& cluster : clusters)
+			{
+				const int32_t distance = Adjacency->Distance(cluster.center, goal);
+
+				if (distance <= radius)
+				{
+					// The radius of a cluster is the furthest goal it holds, which may be less than asked.
+					cluster.radius = std::max(cluster.radius, distance);
+					bClustered = true;
+					break;
+				}
+			}
+
+			if (bClustered == false)
+			{
+				if (static_cast<int32_t>(clusters.size()) == MaxClusters)
+				{
+					return false;
+				}
+
+				clusters.push_back({ goal, 0 });
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Goal, typename Tester>
+	int32_t AStarSearch::Search(int32_t start, const Goal& goal, uint8_t pathColor, Tester tester)
+	{
+		SearchKickOff(start);
+
+		// Do search.
+		while (openList.Num() > 0)
+		{
+			const int32_t currNodeIndex = openList.PopIndex();
+			nodePool.SetClosed(currNodeIndex, true);
+
+			const int32_t currTile = nodePool.tiles[currNodeIndex];
+			const int32_t currCost = nodePool.costs[currNodeIndex];
+
+			// We found destination.
+			if (goal.Contains(currTile))
+			{
+				return currNodeIndex;
+			}
+
+			// Color test must be after destination checking to allow different types of destinations.
+			if ((nodePool.colors[currNodeIndex] & pathColor) == 0)
+			{
+				// Not allowed color.
+				continue;
+			}
+
+			++stats.nodesExpanded;
+
+			// Grab neighbors to expand.
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			// Check all neighbors.
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = currLinks.neighbors[i];
+				const int32_t neighborNodeIndex = nodePool.FindOrAdd(neighborTile);
+
+				// Every step costs at least one tile of distance, so the heuristic is consistent
+				// and a closed node already has its shortest cost.
+				if (nodePool.IsClosed(neighborNodeIndex))
+				{
+					// skip.
+					continue;
+				}
+
+				// If it is starting point, it is guaranteed to be passable.
+				if (neighborTile != start)
+				{
+					// If it isn't, do test.
+					if (tester(nodePool, currNodeIndex, neighborNodeIndex, currLinks.IsPassable(i)) == false)
+					{
+						// Blocked tile.
+						continue;
+					}
+				}
+
+				const int32_t newCost = currCost + currLinks.costs[i];
+				const int32_t oldCost = nodePool.costs[neighborNodeIndex];
+
+				// If this is not better than previous approach,
+				if (newCost >= oldCost)
+				{
+					// skip.
+					continue;
+				}
+
+				const bool bIsOpened = nodePool.IsOpened(neighborNodeIndex);
+
+				// The heuristic of a tile never changes, so compute it only on the first visit.
+				const int32_t heuristic = bIsOpened ? nodePool.totalCosts[neighborNodeIndex] - oldCost : goal.Estimate(neighborTile);
+
+				// Fill in.
+				nodePool.costs[neighborNodeIndex] = newCost;
+				assert(newCost > 0);
+				nodePool.totalCosts[neighborNodeIndex] = newCost + heuristic;
+				nodePool.parents[neighborNodeIndex] = currNodeIndex;
+				nodePool.depths[neighborNodeIndex] = nodePool.depths[currNodeIndex] + 1;
+
+				// If this node is not in the open list,
+				if (bIsOpened == false)
+				{
+					// add to the open list.
+					openList.Push(neighborNodeIndex);
+				}
+				else
+				{
+					// otherwise move it up to its new place.
+					openList.Update(neighborNodeIndex);
+				}
+			}
+		}
+
+		// No path found.
+		return InvalidIndex;
+	}
+
+	template <typename Tester>
+	int32_t AStarSearch::SearchBidirectional(int32_t start, int32_t destination, uint8_t pathColor, Tester tester)
+	{
+		SearchKickOff(start);
+		ReverseSearchKickOff(destination);
+
+		bestCost = INT32_MAX;
+		pathNode = InvalidIndex;
+		reversePathNode = InvalidIndex;
+
+		// Nodes a side closes can't improve the best meeting, so once a side runs out the other can't either.
+		while (openList.Num() > 0 && reverseList.Num() > 0)
+		{
+			if (openList.Num() <= reverseList.Num())
+			{
+				ExpandForward(start, destination, pathColor, tester);
+			}
+			else
+			{
+				ExpandBackward(start, destination, pathColor, tester);
+			}
+		}
+
+		if (pathNode == InvalidIndex)
+		{
+			// No path found.
+			return InvalidIndex;
+		}
+
+		return nodePool.depths[pathNode] + reversePool.depths[reversePathNode];
+	}
+
+	template <typename Tester>
+	void AStarSearch::ExpandForward(int32_t start, int32_t destination, uint8_t pathColor, Tester tester)
+	{
+		const int32_t currNodeIndex = openList.PopIndex();
+		nodePool.SetClosed(currNodeIndex, true);
+
+		const int32_t currTile = nodePool.tiles[currNodeIndex];
+		const int32_t currCost = nodePool.costs[currNodeIndex];
+
+		// A path through the node costs at least its total cost, and at least the lowest total cost backwards
+		// less the backwards heuristic of the node. Either way it can't beat the best, so close it.
+		if (nodePool.totalCosts[currNodeIndex] >= bestCost
+			|| currCost + reversePool.totalCosts[reverseList.TopIndex()] - Adjacency->Distance(start, currTile) >= bestCost)
+		{
+			return;
+		}
+
+		// The destination ends the path, the backwards side goes on from there.
+		// Color test must be after destination checking to allow different types of destinations.
+		if (currTile == destination || (nodePool.colors[currNodeIndex] & pathColor) == 0)
+		{
+			return;
+		}
+
+		++stats.nodesExpanded;
+
+		const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+		for (int i = 0; i < currLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = currLinks.neighbors[i];
+			const int32_t neighborNodeIndex = nodePool.FindOrAdd(neighborTile);
+
+			if (nodePool.IsClosed(neighborNodeIndex))
+			{
+				// skip.
+				continue;
+			}
+
+			// If it is starting point, it is guaranteed to be passable.
+			if (neighborTile != start)
+			{
+				if (tester(nodePool, currNodeIndex, neighborNodeIndex, currLinks.IsPassable(i)) == false)
+				{
+					// Blocked tile.
+					continue;
+				}
+			}
+
+			const int32_t newCost = currCost + currLinks.costs[i];
+			const int32_t oldCost = nodePool.costs[neighborNodeIndex];
+
+			if (newCost >= oldCost)
+			{
+				// skip.
+				continue;
+			}
+
+			const bool bIsOpened = nodePool.IsOpened(neighborNodeIndex);
+			const int32_t heuristic = bIsOpened ? nodePool.totalCosts[neighborNodeIndex] - oldCost : Adjacency->Distance(neighborTile, destination);
+
+			// Fill in.
+			nodePool.costs[neighborNodeIndex] = newCost;
+			assert(newCost > 0);
+			nodePool.totalCosts[neighborNodeIndex] = newCost + heuristic;
+			nodePool.parents[neighborNodeIndex] = currNodeIndex;
+			nodePool.depths[neighborNodeIndex] = nodePool.depths[currNodeIndex] + 1;
+
+			if (bIsOpened == false)
+			{
+				openList.Push(neighborNodeIndex);
+			}
+			else
+			{
+				openList.Update(neighborNodeIndex);
+			}
+
+			// The backwards side only reaches tiles a path may go through, and the destination.
+			const int32_t reverseNodeIndex = reversePool.Find(neighborTile);
+
+			if (reverseNodeIndex != InvalidIndex && reversePool.costs[reverseNodeIndex] != INT32_MAX && newCost + reversePool.costs[reverseNodeIndex] < bestCost)
+			{
+				bestCost = newCost + reversePool.costs[reverseNodeIndex];
+				pathNode = neighborNodeIndex;
+				reversePathNode = reverseNodeIndex;
+			}
+		}
+	}
+
+	template <typename Tester>
+	void AStarSearch::ExpandBackward(int32_t start, int32_t destination, uint8_t pathColor, Tester tester)
+	{
+		const int32_t currNodeIndex = reverseList.PopIndex();
+		reversePool.SetClosed(currNodeIndex, true);
+
+		const int32_t currTile = reversePool.tiles[currNodeIndex];
+		const int32_t currCost = reversePool.costs[currNodeIndex];
+
+		// Same bounds as forwards, the other way around.
+		if (reversePool.totalCosts[currNodeIndex] >= bestCost
+			|| currCost + nodePool.totalCosts[openList.TopIndex()] - Adjacency->Distance(currTile, destination) >= bestCost)
+		{
+			return;
+		}
+
+		// A shortest path doesn't come back to the start.
+		if (currTile == start)
+		{
+			return;
+		}
+
+		++stats.nodesExpanded;
+
+		// Links of the tile hold the steps from its neighbors onto it as well.
+		const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+		for (int i = 0; i < currLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = currLinks.neighbors[i];
+			const int32_t neighborNodeIndex = reversePool.FindOrAdd(neighborTile);
+
+			if (reversePool.IsClosed(neighborNodeIndex))
+			{
+				// skip.
+				continue;
+			}
+
+			// Every tile before the destination is passed through, so it must be of the path color.
+			if ((reversePool.colors[neighborNodeIndex] & pathColor) == 0)
+			{
+				// Not allowed color.
+				continue;
+			}
+
+			// The step goes from the neighbor onto the tile, tested as forwards would.
+			if (tester(reversePool, neighborNodeIndex, currNodeIndex, currLinks.IsReversePassable(i)) == false)
+			{
+				// Blocked tile.
+				continue;
+			}
+
+			const int32_t newCost = currCost + currLinks.reverseCosts[i];
+			const int32_t oldCost = reversePool.costs[neighborNodeIndex];
+
+			if (newCost >= oldCost)
+			{
+				// skip.
+				continue;
+			}
+
+			const bool bIsOpened = reversePool.IsOpened(neighborNodeIndex);
+			const int32_t heuristic = bIsOpened ? reversePool.totalCosts[neighborNodeIndex] - oldCost : Adjacency->Distance(start, neighborTile);
+
+			// Fill in.
+			reversePool.costs[neighborNodeIndex] = newCost;
+			assert(newCost > 0);
+			reversePool.totalCosts[neighborNodeIndex] = newCost + heuristic;
+			reversePool.parents[neighborNodeIndex] = currNodeIndex;
+			reversePool.depths[neighborNodeIndex] = reversePool.depths[currNodeIndex] + 1;
+
+			if (bIsOpened == false)
+			{
+				reverseList.Push(neighborNodeIndex);
+			}
+			else
+			{
+				reverseList.Update(neighborNodeIndex);
+			}
+
+			const int32_t forwardNodeIndex = nodePool.Find(neighborTile);
+
+			if (forwardNodeIndex != InvalidIndex && nodePool.costs[forwardNodeIndex] != INT32_MAX && newCost + nodePool.costs[forwardNodeIndex] < bestCost)
+			{
+				bestCost = newCost + nodePool.costs[forwardNodeIndex];
+				pathNode = forwardNodeIndex;
+				reversePathNode = neighborNodeIndex;
+			}
+		}
+	}
+
+	void AStarSearch::GetVisitedTiles(std::vector<int32_t>& OutTiles) const
+	{
+		OutTiles.assign(nodePool.tiles.begin(), nodePool.tiles.begin() + nodePool.Num());
+
+		if (bReverseSearched)
+		{
+			OutTiles.insert(OutTiles.end(), reversePool.tiles.begin(), reversePool.tiles.begin() + reversePool.Num());
+		}
+	}
+
+	void AStarSearch::SearchKickOff(int32_t start)
+	{
+		// Reset all containers, stats were reset by the caller.
+		nodePool.Reset();
+		openList.Reset();
+
+		// Push start node and kick off the search.
+		const int32_t startNodeIndex = nodePool.Add(start);
+		nodePool.costs[startNodeIndex] = 0;
+		nodePool.totalCosts[startNodeIndex] = 0;
+		nodePool.depths[startNodeIndex] = 0;
+
+		openList.Push(startNodeIndex);
+	}
+
+	void AStarSearch::ReverseSearchKickOff(int32_t destination)
+	{
+		if (bReversePoolInitialized == false)
+		{
+			reversePool.Initialize(Adjacency);
+			bReversePoolInitialized = true;
+		}
+
+		reversePool.Reset();
+		reverseList.Reset();
+
+		const int32_t destinationNodeIndex = reversePool.Add(destination);
+		reversePool.costs[destinationNodeIndex] = 0;
+		reversePool.totalCosts[destinationNodeIndex] = 0;
+		reversePool.depths[destinationNodeIndex] = 0;
+
+		reverseList.Push(destinationNodeIndex);
+	}
+
+	void AStarSearch::WritePath(int32_t* OutTiles) const
+	{
+		// Backwards part first, parents lead from where the sides met to the destination.
+		if (reversePathNode != InvalidIndex)
+		{
+			const int32_t reverseDepth = reversePool.depths[reversePathNode];
+			int32_t* reverseTile = OutTiles + reverseDepth;
+
+			for (int32_t nodeIndex = reversePool.parents[reversePathNode]; nodeIndex != InvalidIndex; nodeIndex = reversePool.parents[nodeIndex])
+			{
+				*--reverseTile = reversePool.tiles[nodeIndex];
+			}
+
+			OutTiles += reverseDepth;
+		}
+
+		for (int32_t nodeIndex = pathNode; nodePool.depths[nodeIndex] > 0; nodeIndex = nodePool.parents[nodeIndex])
+		{
+			*OutTiles++ = nodePool.tiles[nodeIndex];
+		}
+	}
+}
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	// Everything a path query needs, so queries can be queued and run in batches.
+	struct PathRequest
+	{
+		int32_t start = InvalidIndex;
+		int32_t destination = InvalidIndex;
+
+		// ElementMask of tiles the path may go through.
+		uint8_t pathColor = ElementMask::Any;
+		// ElementMask the destination must match. Any accepts tiles without a color as well.
+		uint8_t destinationColor = ElementMask::Any;
+
+		NodeBlockTest nodeBlockTest = &NodeTester::Test_None;
+
+		// Search from both ends until they meet. Same cost as from the start alone, fewer nodes on long queries.
+		bool bBidirectional = false;
+	};
+
+	// Goal of a search to one destination.
+	struct SingleGoal
+	{
+		const AdjacencyTable* Adjacency;
+		int32_t destination;
+
+		bool Contains(int32_t tile) const { return tile == destination; }
+		int32_t Estimate(int32_t tile) const { return Adjacency->Distance(tile, destination); }
+	};
+
+	/*!
+	 * \brief Goals of a search to the nearest of several tiles, like an end zone.
+	 *
+	 *		  The heuristic is the distance to the nearest goal, but a goal set may be a whole element of the map.
+	 *		  So goals are grouped into a few clusters, each a center with every goal within a radius of it,
+	 *		  and the heuristic is the lowest distance to a center less its radius.
+	 *		  Hex distance is a metric, so that never overestimates the distance to a goal,
+	 *		  and it changes by at most one per step, so the heuristic stays consistent.
+	 */
+	class GoalSet
+	{
+	public:
+		// Goals not matching the color are left out. Any accepts tiles without a color as well.
+		void Build(const AdjacencyTable* InAdjacency, const std::vector<int32_t>& Goals, uint8_t destinationColor);
+
+		bool IsEmpty() const { return goals.empty(); }
+		const std::vector<int32_t>& GetGoals() const { return goals; }
+
+		bool Contains(int32_t tile) const { return goalTiles[tile] != 0; }
+
+		int32_t Estimate(int32_t tile) const
+		{
+			int32_t estimate = INT32_MAX;
+
+			for (const Cluster& cluster : clusters)
+			{
+				estimate = std::min(estimate, Adjacency->Distance(tile, cluster.center) - cluster.radius);
+			}
+
+			return std::max(estimate, 0);
+		}
+
+		// Clusters the heuristic checks per node.
+		static constexpr int32_t MaxClusters = 8;
+
+	private:
+		struct Cluster
+		{
+			int32_t center;
+			int32_t radius;
+		};
+
+		// False if the goals need more clusters than MaxClusters at the radius.
+		bool TryCluster(int32_t radius);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+
+		std::vector<int32_t> goals;
+		std::vector<Cluster> clusters;
+
+		// One per grid tile, set for goals.
+		std::vector<uint8_t> goalTiles;
+	};
+
+	/*!
+	 * \brief Engine independent implementation behind UAStar.
+	 */
+	class AStarSearch
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		// Binary heap by default. Buckets suit grids with small step costs.
+		void SetOpenListType(OpenListType type);
+
+		bool GetShortestPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath);
+		bool GetPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath, uint8_t elementColor, bool allowWaterType, bool allowAnyDestination);
+
+		// Requests GetShortestPath and GetPath run.
+		static PathRequest MakeShortestPathRequest(int32_t start, int32_t destination);
+		static PathRequest MakePathRequest(int32_t start, int32_t destination, uint8_t elementColor, bool allowWaterType, bool allowAnyDestination);
+
+		// Check the destination color, then search from the start, or both ends if the request asks.
+		bool FindPath(const PathRequest& request, std::vector<int32_t>& OutPath);
+
+		/*!
+		 * \brief FindPath writing into storage of the caller, like an array on the stack, so the query never allocates.
+		 *
+		 * \param OutTiles
+		 *		  Tiles of the path in the same order as FindPath. Left as it was if the path doesn't fit.
+		 *
+		 * \return int32_t
+		 *		   Number of tiles of the path, known from the depth of the destination before anything is written.
+		 *		   More than the capacity if it doesn't fit. InvalidIndex if there is no path.
+		 */
+		int32_t FindPath(const PathRequest& request, int32_t* OutTiles, int32_t capacity);
+
+		/*!
+		 * \brief Cheapest path to any of the goals, in one search instead of one per goal.
+		 *
+		 * \param request
+		 *		  Rules of the path. The destination is ignored, the destination color filters the goals.
+		 *
+		 * \param OutPath
+		 *		  Same as FindPath, so the goal reached comes first. Empty if the start is a goal.
+		 */
+		bool FindPathToAny(const PathRequest& request, const std::vector<int32_t>& Goals, std::vector<int32_t>& OutPath);
+
+		/*!
+		* \brief Find a path from the given tile to the destination.
+		*
+		* \param start
+		*		 Origin tile to start the search.
+		*
+		* \param destination
+		*		 Goal of the path.
+		*
+		* \param OutPath
+		*		 All tiles for the path includes the destination, from the destination back to the start.
+		*		 Start tile is excluded.
+		*
+		* \param pathColor
+		*		 ElementMask of tiles the path may go through. Destination is exempt.
+		*	
+		* \return bool
+		*		  If a path is found, return true.
+		*		  If there is no path, return false.
+		*/
+		bool AstarSearch(int32_t start, int32_t destination, std::vector<int32_t>& OutPath, uint8_t pathColor, NodeBlockTest nodeBlockTest);
+
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = nodePool.GetNodeBytes() + (bReverseSearched ? reversePool.GetNodeBytes() : 0);
+			return result;
+		}
+
+		// Tiles the last search read. Its result can only change when one of them does.
+		void GetVisitedTiles(std::vector<int32_t>& OutTiles) const;
+
+	private:
+		// Number of tiles of the path, or InvalidIndex if there is no path. WritePath writes it.
+		int32_t Search(const PathRequest& request);
+
+		// Search compiled for the tester, to a SingleGoal or the GoalSet. Node of the goal reached, or InvalidIndex if there is no path.
+		template <typename Goal, typename Tester>
+		int32_t Search(int32_t start, const Goal& goal, uint8_t pathColor, Tester tester);
+
+		/*!
+		 * \brief A* forwards from the start and backwards from the destination, growing the side with fewer open nodes (NBA*).
+		 *
+		 *		  Backwards steps read the reverse cost and height rule of TileLinks, so one way steps are searched the right way.
+		 *		  A node is closed without expanding when a path through it can't beat the best meeting found,
+		 *		  by its own heuristic or by the lowest total cost of the other side. Once either side runs out, the best is the shortest.
+		 *
+		 * \return int32_t
+		 *		   Number of tiles of the path, or InvalidIndex if there is no path.
+		 */
+		template <typename Tester>
+		int32_t SearchBidirectional(int32_t start, int32_t destination, uint8_t pathColor, Tester tester);
+
+		// Expand the top node of one side, and keep the best meeting of the sides.
+		template <typename Tester>
+		void ExpandForward(int32_t start, int32_t destination, uint8_t pathColor, Tester tester);
+		template <typename Tester>
+		void ExpandBackward(int32_t start, int32_t destination, uint8_t pathColor, Tester tester);
+
+		void SearchKickOff(int32_t start);
+		void ReverseSearchKickOff(int32_t destination);
+
+		// Write the path of the last search, from the destination back to the start. Start tile is excluded.
+		void WritePath(int32_t* OutTiles) const;
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		NodePool nodePool;
+		NodeSorter nodeSorter = NodeSorter(nodePool, NodeSortKey::TotalCost);
+		OpenList openList = OpenList(nodePool, nodeSorter);
+
+		GoalSet goalSet;
+
+		// Backwards side of bidirectional searches, from the destination. The pool is initialized on first use.
+		NodePool reversePool;
+		NodeSorter reverseSorter = NodeSorter(reversePool, NodeSortKey::TotalCost);
+		OpenList reverseList = OpenList(reversePool, reverseSorter);
+		bool bReversePoolInitialized = false;
+		bool bReverseSearched = false;
+
+		// Node the path of the last search ends at. For a bidirectional search, where the sides met,
+		// with the node of the same tile on the backwards side and the cost of the path through it.
+		int32_t pathNode = InvalidIndex;
+		int32_t reversePathNode = InvalidIndex;
+		int32_t bestCost = INT32_MAX;
+	};
+}
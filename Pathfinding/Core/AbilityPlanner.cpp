@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AbilityPlanner.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace AkPathfinding
+{
+	void AbilityPlanner::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+
+		nodes.reserve(SearchPolicy::NodePoolSize);
+	}
+
+	bool AbilityPlanner::Plan(const GridSnapshot& Tiles, int32_t start, int32_t goal, uint8_t elementColor, int32_t abilityBudget, std::vector<PlanStep>& OutPlan)
+	{
+		stats.Reset();
+		nodes.clear();
+		openList.Reset();
+		bestCosts.clear();
+		OutPlan.clear();
+
+		if (start == InvalidIndex || goal == InvalidIndex)
+		{
+			return false;
+		}
+
+		abilityBudget = std::min(abilityBudget, MaxAbilityBudget);
+
+		Node root;
+		root.tile = start;
+		root.height = static_cast<int8_t>(Tiles.GetHeight(start));
+
+		Memoize(root);
+		Push(std::move(root), goal);
+
+		// Closest to the goal so far, the plan if the goal is out of reach.
+		int32_t closest = 0;
+		int32_t closestDistance = Adjacency->Distance(start, goal);
+
+		while (openList.Num() > 0 && stats.nodesExpanded < settings.maxExpansions)
+		{
+			const int32_t index = openList.Pop();
+
+			// Copy, pushing may move the nodes.
+			const Node node = nodes[index];
+
+			// Reached again with fewer abilities or for less since it was pushed.
+			if (IsDominated(node))
+			{
+				continue;
+			}
+
+			++stats.nodesExpanded;
+
+			if (node.tile == goal)
+			{
+				closest = index;
+				closestDistance = 0;
+				break;
+			}
+
+			const int32_t distance = Adjacency->Distance(node.tile, goal);
+
+			if (distance < closestDistance || (distance == closestDistance && node.cost < nodes[closest].cost))
+			{
+				closest = index;
+				closestDistance = distance;
+			}
+
+			const TileLinks& links = Adjacency->GetLinks(node.tile);
+			const int32_t parentTile = node.parent != InvalidIndex ? nodes[node.parent].tile : InvalidIndex;
+
+			for (int i = 0; i < links.neighborCount; ++i)
+			{
+				const int32_t neighbor = links.neighbors[i];
+
+				// skip.
+				if (neighbor == parentTile || Adjacency->GetLinks(neighbor).bBlocked)
+				{
+					continue;
+				}
+
+				int32_t height;
+				uint8_t color;
+				ReadTile(Tiles, node, neighbor, height, color);
+
+				Node next = node;
+				next.tile = neighbor;
+				next.parent = index;
+				next.previousHeight = node.height;
+				next.edit = PlanAction::Walk;
+				next.editCount = 0;
+				next.editTile = InvalidIndex;
+				next.bExpand = false;
+
+				const int32_t heightDifference = height - node.height;
+				int32_t abilities = 0;
+
+				if (color & elementColor)
+				{
+					// Lower or raise the next tile until it is one apart.
+					if (std::abs(heightDifference) > 1)
+					{
+						abilities = std::abs(heightDifference) - 1;
+						height = node.height + (heightDifference > 0 ? 1 : -1);
+
+						next.edit = heightDifference > 0 ? PlanAction::Lower : PlanAction::Raise;
+						next.editTile = neighbor;
+						AddEdit(next, neighbor, height, color);
+					}
+				}
+				else
+				{
+					if (heightDifference != 0)
+					{
+						// Raise or lower the current tile to the height of the next, as long as the tile before still reaches it.
+						if (node.previousHeight != NoHeight && std::abs(node.previousHeight - height) > 1)
+						{
+							continue;
+						}
+
+						int32_t currentHeight;
+						uint8_t currentColor;
+						ReadTile(Tiles, node, node.tile, currentHeight, currentColor);
+
+						abilities = std::abs(heightDifference);
+
+						next.edit = heightDifference > 0 ? PlanAction::Raise : PlanAction::Lower;
+						next.editTile = node.tile;
+						next.previousHeight = static_cast<int8_t>(height);
+						AddEdit(next, node.tile, height, currentColor);
+					}
+
+					// Then expand onto the next.
+					abilities += 1;
+					next.bExpand = true;
+					AddEdit(next, neighbor, height, elementColor);
+				}
+
+				if (node.abilities + abilities > abilityBudget)
+				{
+					continue;
+				}
+
+				next.height = static_cast<int8_t>(height);
+				next.abilities = static_cast<uint8_t>(node.abilities + abilities);
+				next.editCount = static_cast<uint8_t>(abilities - (next.bExpand ? 1 : 0));
+				next.cost = node.cost + settings.stepCost + settings.abilityCost * abilities;
+
+				if (Memoize(next))
+				{
+					Push(std::move(next), goal);
+				}
+			}
+		}
+
+		stats.nodeBytes = static_cast<int64_t>(nodes.size() * sizeof(Node));
+
+		WritePlan(closest, OutPlan);
+
+		return closestDistance == 0;
+	}
+
+	void AbilityPlanner::Apply(const std::vector<PlanStep>& Plan, uint8_t elementColor, GridSnapshot& OutTiles)
+	{
+		for (const PlanStep& step : Plan)
+		{
+			switch (step.action)
+			{
+			case PlanAction::Raise:
+				OutTiles.SetHeight(step.tile, OutTiles.GetHeight(step.tile) + 1);
+				break;
+
+			case PlanAction::Lower:
+				OutTiles.SetHeight(step.tile, OutTiles.GetHeight(step.tile) - 1);
+				break;
+
+			case PlanAction::Expand:
+				OutTiles.SetColor(step.tile, elementColor);
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	int32_t AbilityPlanner::GetAbilityCount(const std::vector<PlanStep>& Plan)
+	{
+		return static_cast<int32_t>(std::count_if(Plan.begin(), Plan.end(), [](const PlanStep& step) { return step.action != PlanAction::Walk; }));
+	}
+
+	void AbilityPlanner::ReadTile(const GridSnapshot& Tiles, const Node& node, int32_t tile, int32_t& OutHeight, uint8_t& OutColor) const
+	{
+		for (int32_t i = 0; i < node.tileEditCount; ++i)
+		{
+			if (node.tileEdits[i].tile == tile)
+			{
+				OutHeight = node.tileEdits[i].height;
+				OutColor = node.tileEdits[i].color;
+				return;
+			}
+		}
+
+		OutHeight = Tiles.GetHeight(tile);
+		OutColor = Tiles.GetColor(tile);
+	}
+
+	void AbilityPlanner::AddEdit(Node& node, int32_t tile, int32_t height, uint8_t color)
+	{
+		for (int32_t i = 0; i < node.tileEditCount; ++i)
+		{
+			if (node.tileEdits[i].tile == tile)
+			{
+				node.tileEdits[i].height = static_cast<int8_t>(height);
+				node.tileEdits[i].color = color;
+				return;
+			}
+		}
+
+		// Every edit takes an ability, so the budget bounds them.
+		node.tileEdits[node.tileEditCount++] = { tile, static_cast<int8_t>(height), color };
+	}
+
+	uint64_t AbilityPlanner::GetStateKey(const Node& node)
+	{
+		return static_cast<uint64_t>(static_cast<uint32_t>(node.tile)) << 16
+			| static_cast<uint64_t>(static_cast<uint8_t>(node.height)) << 8
+			| static_cast<uint64_t>(static_cast<uint8_t>(node.previousHeight));
+	}
+
+	bool AbilityPlanner::Memoize(const Node& node)
+	{
+		StateCosts& state = bestCosts[GetStateKey(node)];
+
+		for (int32_t abilities = 0; abilities <= node.abilities; ++abilities)
+		{
+			if (state.costs[abilities] <= node.cost)
+			{
+				return false;
+			}
+		}
+
+		state.costs[node.abilities] = node.cost;
+		return true;
+	}
+
+	bool AbilityPlanner::IsDominated(const Node& node) const
+	{
+		const StateCosts& state = bestCosts.find(GetStateKey(node))->second;
+
+		for (int32_t abilities = 0; abilities < node.abilities; ++abilities)
+		{
+			if (state.costs[abilities] <= node.cost)
+			{
+				return true;
+			}
+		}
+
+		return state.costs[node.abilities] < node.cost;
+	}
+
+	void AbilityPlanner::Push(Node&& node, int32_t goal)
+	{
+		const int32_t estimate = node.cost + settings.stepCost * Adjacency->Distance(node.tile, goal);
+
+		nodes.push_back(std::move(node));
+		openList.Push(static_cast<int32_t>(nodes.size()) - 1, estimate);
+	}
+
+	void AbilityPlanner::WritePlan(int32_t node, std::vector<PlanStep>& OutPlan) const
+	{
+		OutPlan.clear();
+
+		// Backwards from the last node, turned around at the end.
+		for (; nodes[node].parent != InvalidIndex; node = nodes[node].parent)
+		{
+			const Node& step = nodes[node];
+
+			OutPlan.push_back({ PlanAction::Walk, step.tile });
+
+			if (step.bExpand)
+			{
+				OutPlan.push_back({ PlanAction::Expand, step.tile });
+			}
+
+			for (int32_t i = 0; i < step.editCount; ++i)
+			{
+				OutPlan.push_back({ step.edit, step.editTile });
+			}
+		}
+
+		std::reverse(OutPlan.begin(), OutPlan.end());
+	}
+}
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "GridSnapshot.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	enum class PlanAction : uint8_t
+	{
+		// Step onto the tile, which is of the unit's element and at most one apart in height.
+		Walk,
+		// Raise or Lower the tile by one.
+		Raise,
+		Lower,
+		// Turn the top of the tile into the unit's element. Heights must be the same.
+		Expand,
+	};
+
+	struct PlanStep
+	{
+		PlanAction action = PlanAction::Walk;
+		int32_t tile = InvalidIndex;
+	};
+
+	struct AbilityPlanSettings
+	{
+		int32_t stepCost = 1;
+		// A turn moves four tiles and uses three abilities, so an ability is worth a bit more than a step.
+		int32_t abilityCost = 2;
+
+		// Expanded states before the best plan so far is returned.
+		int32_t maxExpansions = 1 << 15;
+	};
+
+	/*!
+	 * \brief Plans the walk of a unit toward a goal together with the shift abilities clearing the way.
+	 *
+	 *		  States are (tile, abilities used, height of the tile, height of the tile before), searched with A*
+	 *		  on steps plus abilities, with the hex distance to the goal as heuristic.
+	 *		  The steps mirror UPlayerAI::UseShiftAbility: a tile of the element too far up or down is lowered or raised,
+	 *		  a tile of another element is expanded onto once the current tile is raised or lowered to its height,
+	 *		  as long as the tile before still reaches the current one.
+	 *
+	 *		  Every state keeps the few edits on its way, on top of the snapshot, so tiles read as the plan left them.
+	 *		  A state is dropped if the same tile, heights and fewer or as many abilities were reached for no more cost.
+	 *		  Plans never use more abilities than the budget. If the goal is out of reach within it,
+	 *		  the plan ends at the tile closest to the goal.
+	 */
+	class AbilityPlanner
+	{
+	public:
+		static constexpr int32_t MaxAbilityBudget = 8;
+
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		/*!
+		 * \brief Plan from start toward goal, within the ability budget.
+		 *
+		 * \param Tiles
+		 *		  Heights and colors of the grid. Neighbors and blocking come from the adjacency.
+		 *
+		 * \param OutPlan
+		 *		  Steps in order, abilities before the walk onto their tile.
+		 *
+		 * \return bool
+		 *		   True if the plan reaches the goal.
+		 */
+		bool Plan(const GridSnapshot& Tiles, int32_t start, int32_t goal, uint8_t elementColor, int32_t abilityBudget, std::vector<PlanStep>& OutPlan);
+
+		// Apply the abilities of a plan to a snapshot, to look further ahead from where it leaves the grid.
+		static void Apply(const std::vector<PlanStep>& Plan, uint8_t elementColor, GridSnapshot& OutTiles);
+
+		static int32_t GetAbilityCount(const std::vector<PlanStep>& Plan);
+
+		SearchStats GetStats() const { return stats; }
+
+		AbilityPlanSettings settings;
+
+	private:
+		struct Node
+		{
+			int32_t tile = InvalidIndex;
+			int32_t parent = InvalidIndex;
+			int32_t cost = 0;
+
+			int8_t height = 0;
+			// Height of the tile before, NoHeight at the start.
+			int8_t previousHeight = NoHeight;
+			uint8_t abilities = 0;
+
+			// Abilities used to step here from the parent.
+			PlanAction edit = PlanAction::Walk;
+			uint8_t editCount = 0;
+			int32_t editTile = InvalidIndex;
+			bool bExpand = false;
+
+			uint8_t tileEditCount = 0;
+			TileEdit tileEdits[MaxAbilityBudget];
+		};
+
+		static constexpr int8_t NoHeight = INT8_MIN;
+
+		void ReadTile(const GridSnapshot& Tiles, const Node& node, int32_t tile, int32_t& OutHeight, uint8_t& OutColor) const;
+		static void AddEdit(Node& node, int32_t tile, int32_t height, uint8_t color);
+
+		// Tile and heights of the state. Abilities are compared for dominance instead.
+		static uint64_t GetStateKey(const Node& node);
+
+		// Keep the cost of the state. False if a state with no more abilities got here for no more cost.
+		bool Memoize(const Node& node);
+		// Whether a state with fewer abilities or less cost was kept since the node was pushed.
+		bool IsDominated(const Node& node) const;
+
+		void Push(Node&& node, int32_t goal);
+		void WritePlan(int32_t node, std::vector<PlanStep>& OutPlan) const;
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+
+		std::vector<Node> nodes;
+		BucketQueue openList;
+
+		// Least cost of a state per ability count, so dominance takes a single lookup.
+		struct StateCosts
+		{
+			int32_t costs[MaxAbilityBudget + 1];
+
+			StateCosts() { std::fill(std::begin(costs), std::end(costs), INT32_MAX); }
+		};
+
+		std::unordered_map<uint64_t, StateCosts> bestCosts;
+
+		SearchStats stats;
+	};
+}
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AdjacencyTable.h"
+
+namespace AkPathfinding
+{
+	bool TileLinks::operator==(const TileLinks& other) const
+	{
+		if (neighborCount != other.neighborCount
+			|| passableMask != other.passableMask
+			|| reversePassableMask != other.reversePassableMask
+			|| color != other.color
+			|| bBlocked != other.bBlocked)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < neighborCount; ++i)
+		{
+			if (neighbors[i] != other.neighbors[i] || costs[i] != other.costs[i] || reverseCosts[i] != other.reverseCosts[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void AdjacencyTable::Build(const IPathGrid* InGrid)
+	{
+		Grid = InGrid;
+
+		const int32_t tileCount = Grid->GetTileCount();
+		links.assign(tileCount, TileLinks());
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			BuildTile(tile);
+		}
+
+		bitboards.Build(*this);
+
+		coords.clear();
+
+		if (bitboards.IsValid())
+		{
+			coords.resize(tileCount);
+
+			for (int32_t tile = 0; tile < tileCount; ++tile)
+			{
+				// Rows of the shifted parity sit half a tile right.
+				const int32_t x = tile % bitboards.GetWidth();
+				const int32_t y = tile / bitboards.GetWidth();
+
+				coords[tile] = { x - (y + 1 - bitboards.GetShiftedParity()) / 2, y };
+			}
+		}
+
+		++version;
+	}
+
+	void AdjacencyTable::RebuildTiles(const std::vector<int32_t>& Tiles)
+	{
+		for (const int32_t tile : Tiles)
+		{
+			BuildTile(tile);
+
+			// Neighbors keep the steps into this tile as well.
+			const TileLinks& tileLinks = links[tile];
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				BuildTile(tileLinks.neighbors[i]);
+			}
+		}
+
+		bitboards.RebuildTiles(*this, Tiles);
+
+		if (Tiles.empty() == false)
+		{
+			++version;
+		}
+	}
+
+	void AdjacencyTable::Refresh(std::vector<int32_t>& OutChangedTiles)
+	{
+		OutChangedTiles.clear();
+
+		const int32_t tileCount = GetTileCount();
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			const TileLinks oldLinks = links[tile];
+			BuildTile(tile);
+
+			if (links[tile] != oldLinks)
+			{
+				OutChangedTiles.push_back(tile);
+			}
+		}
+
+		bitboards.RebuildTiles(*this, OutChangedTiles);
+
+		if (OutChangedTiles.empty() == false)
+		{
+			++version;
+		}
+	}
+
+	void AdjacencyTable::BuildTile(int32_t tile)
+	{
+		TileLinks& tileLinks = links[tile];
+
+		tileLinks.neighborCount = static_cast<uint8_t>(Grid->GetNeighbors(tile, tileLinks.neighbors));
+		tileLinks.passableMask = 0;
+		tileLinks.reversePassableMask = 0;
+		tileLinks.color = Grid->GetTileColor(tile);
+		tileLinks.bBlocked = Grid->IsBlocked(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = tileLinks.neighbors[i];
+
+			tileLinks.costs[i] = Grid->GetCost(tile, neighborTile);
+			tileLinks.reverseCosts[i] = Grid->GetCost(neighborTile, tile);
+
+			if (Grid->IsPassable(tile, neighborTile))
+			{
+				tileLinks.passableMask |= 1 << i;
+			}
+
+			if (Grid->IsPassable(neighborTile, tile))
+			{
+				tileLinks.reversePassableMask |= 1 << i;
+			}
+		}
+	}
+}
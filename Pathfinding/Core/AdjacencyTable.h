@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "HexBitboards.h"
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	// Everything a search needs about a tile and the steps around it.
+	struct TileLinks
+	{
+		int32_t neighbors[MaxNeighbors];
+
+		// Step from the tile to the neighbor.
+		int32_t costs[MaxNeighbors];
+		// Step from the neighbor back to the tile, for backwards searches.
+		int32_t reverseCosts[MaxNeighbors];
+
+		uint8_t neighborCount = 0;
+
+		// Bit i is set when the step to neighbors[i] passes the height rule.
+		uint8_t passableMask = 0;
+		// Bit i is set when the step from neighbors[i] passes the height rule.
+		uint8_t reversePassableMask = 0;
+
+		uint8_t color = ElementMask::None;
+		bool bBlocked = false;
+
+		bool IsPassable(int slot) const { return (passableMask >> slot) & 1; }
+		bool IsReversePassable(int slot) const { return (reversePassableMask >> slot) & 1; }
+
+		bool operator==(const TileLinks& other) const;
+		bool operator!=(const TileLinks& other) const { return (*this == other) == false; }
+	};
+
+	/*!
+	 * \brief Cached adjacency of an IPathGrid, so searches walk plain arrays instead of calling into the grid.
+	 *
+	 *		  The cache doesn't notice changes of the grid.
+	 *		  Whoever changes heights or types of tiles must pass them to RebuildTiles.
+	 */
+	class AdjacencyTable
+	{
+	public:
+		void Build(const IPathGrid* InGrid);
+
+		// Refresh tiles whose height, type or blocking changed, and the steps into them from their neighbors.
+		void RebuildTiles(const std::vector<int32_t>& Tiles);
+
+		/*!
+		 * \brief Rebuild every tile, when changed tiles are unknown, and find out which ones changed.
+		 *		  The tile count of the grid must be the same as when built.
+		 *
+		 * \param OutChangedTiles
+		 *		  Tiles whose links differ from before, so they can be passed on like tiles of RebuildTiles.
+		 */
+		void Refresh(std::vector<int32_t>& OutChangedTiles);
+
+		int32_t GetTileCount() const { return static_cast<int32_t>(links.size()); }
+		const TileLinks& GetLinks(int32_t tile) const { return links[tile]; }
+
+		// Hex distance from axial coordinates of the offset rows the bitboards found. Asks the grid only if the layout is something else.
+		int32_t Distance(int32_t from, int32_t to) const
+		{
+			if (coords.empty())
+			{
+				return Grid->Distance(from, to);
+			}
+
+			const int32_t dq = coords[from].q - coords[to].q;
+			const int32_t dr = coords[from].r - coords[to].r;
+
+			return (std::abs(dq) + std::abs(dr) + std::abs(dq + dr)) / 2;
+		}
+
+		// Goes up by one with every build, and every rebuild which touched tiles, so results kept from an older version can be told apart.
+		uint32_t GetVersion() const { return version; }
+
+		// Bit planes of the tiles, kept up to date with the links. Null if the grid isn't laid out in offset hex rows.
+		const HexBitboards* GetBitboards() const { return bitboards.IsValid() ? &bitboards : nullptr; }
+
+	private:
+		struct AxialCoord
+		{
+			int32_t q;
+			int32_t r;
+		};
+
+		void BuildTile(int32_t tile);
+
+	private:
+		const IPathGrid* Grid = nullptr;
+		std::vector<TileLinks> links;
+		// Per tile, empty if the grid isn't laid out in offset rows. Geometry never changes after the build.
+		std::vector<AxialCoord> coords;
+		HexBitboards bitboards;
+		uint32_t version = 0;
+	};
+}
@@ -0,0 +1,581 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ComponentIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AkPathfinding
+{
+	namespace
+	{
+		// Label of tiles a build hasn't reached yet.
+		constexpr int32_t PendingLabel = INT32_MAX;
+	}
+
+	void ComponentLabels::Build(const AdjacencyTable* InAdjacency, uint8_t InPathColor, NodeBlockTest InNodeBlockTest)
+	{
+		Adjacency = InAdjacency;
+		pathColor = InPathColor;
+		nodeBlockTest = InNodeBlockTest;
+
+		stats.Reset();
+
+		const int32_t tileCount = Adjacency->GetTileCount();
+
+		// Add every tile in order, so node index is tile index.
+		tilePool.Initialize(Adjacency);
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			tilePool.Add(tile);
+		}
+
+		labels.resize(tileCount);
+		linkMasks.resize(tileCount);
+		visitMarks.assign(tileCount, 0);
+		pendingMarks.assign(tileCount, 0);
+		visitMark = 0;
+		pendingMark = 0;
+
+		componentSizes.clear();
+		freeLabels.clear();
+
+		// Links need to know which neighbors a path can go through.
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			labels[tile] = IsThrough(tile) ? PendingLabel : InvalidIndex;
+		}
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			linkMasks[tile] = GetLinkMask(tile);
+		}
+
+		// Nothing is pending.
+		++pendingMark;
+		pendingCount = 0;
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			if (labels[tile] != PendingLabel)
+			{
+				continue;
+			}
+
+			VisitComponent(tile, INT32_MAX);
+
+			const int32_t label = NewLabel();
+
+			for (const int32_t visitedTile : visitedTiles)
+			{
+				SetLabel(visitedTile, label);
+			}
+		}
+	}
+
+	void ComponentLabels::RebuildTiles(const std::vector<int32_t>& Tiles)
+	{
+		stats.Reset();
+
+		// Links around a tile depend on the tile and its neighbors.
+		++visitMark;
+		changedTiles.clear();
+
+		for (const int32_t tile : Tiles)
+		{
+			tilePool.RefreshTileData(tile);
+		}
+
+		for (const int32_t tile : Tiles)
+		{
+			if (visitMarks[tile] != visitMark)
+			{
+				visitMarks[tile] = visitMark;
+				changedTiles.push_back(tile);
+			}
+
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = tileLinks.neighbors[i];
+
+				if (visitMarks[neighborTile] != visitMark)
+				{
+					visitMarks[neighborTile] = visitMark;
+					changedTiles.push_back(neighborTile);
+				}
+			}
+		}
+
+		// A new tile to go through is a component of its own until its links merge it.
+		for (const int32_t tile : changedTiles)
+		{
+			const bool bThrough = IsThrough(tile);
+
+			if (bThrough && labels[tile] == InvalidIndex)
+			{
+				SetLabel(tile, NewLabel());
+			}
+			else if (bThrough == false && labels[tile] != InvalidIndex)
+			{
+				SetLabel(tile, InvalidIndex);
+			}
+		}
+
+		splitTiles.clear();
+		mergeTiles.clear();
+
+		for (const int32_t tile : changedTiles)
+		{
+			const uint8_t linkMask = GetLinkMask(tile);
+			const uint8_t changedMask = linkMask ^ linkMasks[tile];
+
+			if (changedMask == 0)
+			{
+				continue;
+			}
+
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				if (((changedMask >> i) & 1) == 0)
+				{
+					continue;
+				}
+
+				const int32_t neighborTile = tileLinks.neighbors[i];
+				const bool bLinked = ((linkMask >> i) & 1) != 0;
+
+				if (bLinked)
+				{
+					mergeTiles.push_back(tile);
+					mergeTiles.push_back(neighborTile);
+				}
+				else
+				{
+					splitTiles.push_back(tile);
+					splitTiles.push_back(neighborTile);
+				}
+
+				// Links are the same from both sides, so the neighbor doesn't report it again.
+				const TileLinks& neighborLinks = Adjacency->GetLinks(neighborTile);
+
+				for (int j = 0; j < neighborLinks.neighborCount; ++j)
+				{
+					if (neighborLinks.neighbors[j] == tile)
+					{
+						linkMasks[neighborTile] = static_cast<uint8_t>(bLinked ? linkMasks[neighborTile] | (1 << j) : linkMasks[neighborTile] & ~(1 << j));
+						break;
+					}
+				}
+			}
+
+			linkMasks[tile] = linkMask;
+		}
+
+		SplitAround(splitTiles);
+
+		for (size_t i = 0; i < mergeTiles.size(); i += 2)
+		{
+			MergeAcross(mergeTiles[i], mergeTiles[i + 1]);
+		}
+	}
+
+	bool ComponentLabels::CanReach(int32_t start, int32_t destination) const
+	{
+		// Already there.
+		if (start == destination)
+		{
+			return true;
+		}
+
+		// Labels of the tiles the first step may go to.
+		int32_t startLabels[MaxNeighbors];
+		int startLabelCount = 0;
+
+		const TileLinks& startLinks = Adjacency->GetLinks(start);
+
+		for (int i = 0; i < startLinks.neighborCount; ++i)
+		{
+			if (CanStep(start, i) == false)
+			{
+				continue;
+			}
+
+			const int32_t neighborTile = startLinks.neighbors[i];
+
+			if (neighborTile == destination)
+			{
+				return true;
+			}
+
+			if (labels[neighborTile] != InvalidIndex)
+			{
+				startLabels[startLabelCount++] = labels[neighborTile];
+			}
+		}
+
+		// Then the last step has to come from one of their components.
+		const TileLinks& destinationLinks = Adjacency->GetLinks(destination);
+
+		for (int i = 0; i < destinationLinks.neighborCount && startLabelCount > 0; ++i)
+		{
+			const int32_t label = labels[destinationLinks.neighbors[i]];
+
+			if (label == InvalidIndex || CanStepBack(destination, i) == false)
+			{
+				continue;
+			}
+
+			for (int j = 0; j < startLabelCount; ++j)
+			{
+				if (startLabels[j] == label)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool ComponentLabels::CanStep(int32_t tile, int slot) const
+	{
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+		return CanLeave(tile) && (*nodeBlockTest)(tilePool, tile, tileLinks.neighbors[slot], tileLinks.IsPassable(slot));
+	}
+
+	bool ComponentLabels::CanStepBack(int32_t tile, int slot) const
+	{
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+		const int32_t neighborTile = tileLinks.neighbors[slot];
+		return CanLeave(neighborTile) && (*nodeBlockTest)(tilePool, neighborTile, tile, tileLinks.IsReversePassable(slot));
+	}
+
+	bool ComponentLabels::IsThrough(int32_t tile) const
+	{
+		if (CanLeave(tile) == false)
+		{
+			return false;
+		}
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			if (CanStepBack(tile, i))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint8_t ComponentLabels::GetLinkMask(int32_t tile) const
+	{
+		if (labels[tile] == InvalidIndex)
+		{
+			return 0;
+		}
+
+		uint8_t linkMask = 0;
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			if (labels[tileLinks.neighbors[i]] == InvalidIndex)
+			{
+				continue;
+			}
+
+			if (CanStep(tile, i) || CanStepBack(tile, i))
+			{
+				linkMask |= 1 << i;
+			}
+		}
+
+		return linkMask;
+	}
+
+	ComponentLabels::VisitResult ComponentLabels::VisitComponent(int32_t origin, int32_t limit)
+	{
+		++visitMark;
+		visitedTiles.clear();
+
+		const int32_t label = labels[origin];
+
+		visitMarks[origin] = visitMark;
+		visitedTiles.push_back(origin);
+
+		int32_t foundCount = pendingMarks[origin] == pendingMark ? 1 : 0;
+
+		// Visited tiles are the queue as well.
+		for (size_t visitIndex = 0; visitIndex < visitedTiles.size(); ++visitIndex)
+		{
+			const int32_t currTile = visitedTiles[visitIndex];
+			const uint8_t linkMask = linkMasks[currTile];
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = currLinks.neighbors[i];
+
+				if (((linkMask >> i) & 1) == 0 || visitMarks[neighborTile] == visitMark || labels[neighborTile] != label)
+				{
+					// skip.
+					continue;
+				}
+
+				visitMarks[neighborTile] = visitMark;
+				visitedTiles.push_back(neighborTile);
+
+				if (pendingMarks[neighborTile] == pendingMark && ++foundCount == pendingCount)
+				{
+					stats.nodesExpanded += static_cast<int32_t>(visitedTiles.size());
+					return VisitResult::FoundPending;
+				}
+			}
+
+			if (static_cast<int32_t>(visitedTiles.size()) >= limit)
+			{
+				stats.nodesExpanded += static_cast<int32_t>(visitedTiles.size());
+				return VisitResult::GaveUp;
+			}
+		}
+
+		stats.nodesExpanded += static_cast<int32_t>(visitedTiles.size());
+		return VisitResult::Complete;
+	}
+
+	void ComponentLabels::SetLabel(int32_t tile, int32_t label)
+	{
+		const int32_t oldLabel = labels[tile];
+
+		if (oldLabel == label)
+		{
+			return;
+		}
+
+		if (oldLabel != InvalidIndex && oldLabel != PendingLabel && --componentSizes[oldLabel] == 0)
+		{
+			freeLabels.push_back(oldLabel);
+		}
+
+		labels[tile] = label;
+
+		if (label != InvalidIndex)
+		{
+			++componentSizes[label];
+		}
+	}
+
+	int32_t ComponentLabels::NewLabel()
+	{
+		if (freeLabels.empty() == false)
+		{
+			const int32_t label = freeLabels.back();
+			freeLabels.pop_back();
+			return label;
+		}
+
+		componentSizes.push_back(0);
+		return static_cast<int32_t>(componentSizes.size()) - 1;
+	}
+
+	void ComponentLabels::SplitAround(std::vector<int32_t>& Tiles)
+	{
+		// Tiles that lost their label went with their links.
+		Tiles.erase(std::remove_if(Tiles.begin(), Tiles.end(), [this](int32_t tile) { return labels[tile] == InvalidIndex; }), Tiles.end());
+
+		// Each component on its own.
+		std::sort(Tiles.begin(), Tiles.end(), [this](int32_t tile, int32_t otherTile)
+		{
+			return labels[tile] < labels[otherTile] || (labels[tile] == labels[otherTile] && tile < otherTile);
+		});
+		Tiles.erase(std::unique(Tiles.begin(), Tiles.end()), Tiles.end());
+
+		std::vector<int32_t> pendingTiles;
+
+		for (size_t groupBegin = 0; groupBegin < Tiles.size(); )
+		{
+			size_t groupEnd = groupBegin + 1;
+
+			while (groupEnd < Tiles.size() && labels[Tiles[groupEnd]] == labels[Tiles[groupBegin]])
+			{
+				++groupEnd;
+			}
+
+			pendingTiles.assign(Tiles.begin() + groupBegin, Tiles.begin() + groupEnd);
+			groupBegin = groupEnd;
+
+			// Each part the component broke into has one of the tiles. The last part keeps the label.
+			while (pendingTiles.size() > 1)
+			{
+				++pendingMark;
+				pendingCount = static_cast<int32_t>(pendingTiles.size());
+
+				for (const int32_t tile : pendingTiles)
+				{
+					pendingMarks[tile] = pendingMark;
+				}
+
+				// A small part runs out before the limit from any of its tiles, so try them all.
+				VisitResult result = VisitResult::GaveUp;
+
+				for (size_t pendingIndex = 0; pendingIndex < pendingTiles.size() && result == VisitResult::GaveUp; ++pendingIndex)
+				{
+					result = VisitComponent(pendingTiles[pendingIndex], LocalSearchLimit);
+				}
+
+				if (result == VisitResult::FoundPending)
+				{
+					// Still in one piece.
+					break;
+				}
+
+				if (result == VisitResult::GaveUp)
+				{
+					// Too large to walk around, label every part from scratch.
+					++pendingMark;
+					pendingCount = 0;
+
+					for (bool bFirst = true; pendingTiles.empty() == false; bFirst = false)
+					{
+						VisitComponent(pendingTiles[0], INT32_MAX);
+
+						if (bFirst == false)
+						{
+							const int32_t label = NewLabel();
+
+							for (const int32_t visitedTile : visitedTiles)
+							{
+								SetLabel(visitedTile, label);
+							}
+						}
+
+						pendingTiles.erase(std::remove_if(pendingTiles.begin(), pendingTiles.end(), [this](int32_t tile) { return visitMarks[tile] == visitMark; }), pendingTiles.end());
+					}
+
+					break;
+				}
+
+				// A part broke off.
+				const int32_t label = NewLabel();
+
+				for (const int32_t visitedTile : visitedTiles)
+				{
+					SetLabel(visitedTile, label);
+				}
+
+				pendingTiles.erase(std::remove_if(pendingTiles.begin(), pendingTiles.end(), [this](int32_t tile) { return visitMarks[tile] == visitMark; }), pendingTiles.end());
+			}
+		}
+	}
+
+	void ComponentLabels::MergeAcross(int32_t tile, int32_t otherTile)
+	{
+		int32_t label = labels[tile];
+		int32_t otherLabel = labels[otherTile];
+
+		if (label == otherLabel)
+		{
+			return;
+		}
+
+		// Relabel the smaller one.
+		if (componentSizes[label] > componentSizes[otherLabel])
+		{
+			std::swap(tile, otherTile);
+			std::swap(label, otherLabel);
+		}
+
+		++pendingMark;
+		pendingCount = 0;
+
+		VisitComponent(tile, INT32_MAX);
+
+		for (const int32_t visitedTile : visitedTiles)
+		{
+			SetLabel(visitedTile, otherLabel);
+		}
+	}
+
+	void ComponentIndex::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+
+		// Labels are built for the grid.
+		labelSets.clear();
+		version = Adjacency->GetVersion();
+	}
+
+	const ComponentLabels& ComponentIndex::GetLabels(const PathRequest& request)
+	{
+		// The adjacency changed without telling which tiles.
+		if (version != Adjacency->GetVersion())
+		{
+			labelSets.clear();
+			version = Adjacency->GetVersion();
+		}
+
+		if (const ComponentLabels* labels = FindLabels(request))
+		{
+			return *labels;
+		}
+
+		labelSets.emplace_back(new ComponentLabels());
+		labelSets.back()->Build(Adjacency, request.pathColor, request.nodeBlockTest);
+		return *labelSets.back();
+	}
+
+	const ComponentLabels* ComponentIndex::FindLabels(const PathRequest& request) const
+	{
+		if (version != Adjacency->GetVersion())
+		{
+			return nullptr;
+		}
+
+		for (const std::unique_ptr<ComponentLabels>& labels : labelSets)
+		{
+			if (labels->Matches(request.pathColor, request.nodeBlockTest))
+			{
+				return labels.get();
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool ComponentIndex::CanReach(const ComponentLabels& Labels, const PathRequest& request)
+	{
+		// Check destination tile type.
+		if (request.destinationColor != ElementMask::Any && (Labels.GetTileColor(request.destination) & request.destinationColor) == 0)
+		{
+			return false;
+		}
+
+		return Labels.CanReach(request.start, request.destination);
+	}
+
+	void ComponentIndex::NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles)
+	{
+		version = Adjacency->GetVersion();
+
+		// Relabeling every tile locally costs more than building again on next use.
+		if (static_cast<int32_t>(ChangedTiles.size()) >= Adjacency->GetTileCount())
+		{
+			labelSets.clear();
+			return;
+		}
+
+		for (const std::unique_ptr<ComponentLabels>& labels : labelSets)
+		{
+			labels->RebuildTiles(ChangedTiles);
+		}
+	}
+}
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "AStarSearch.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Connected components of the grid for one path color and tester, to reject queries that can't find a path.
+	 *
+	 *		  Only tiles a path can go through are labeled: tiles of the path color with a step into them.
+	 *		  Two labeled tiles are linked when a step between them passes either way,
+	 *		  so a path always stays in one component between its start and destination.
+	 *		  With one way steps, the same component doesn't promise a path.
+	 *
+	 *		  Tile changes relabel locally: a removed link only splits a component
+	 *		  when a bounded search can't walk around it.
+	 */
+	class ComponentLabels
+	{
+	public:
+		void Build(const AdjacencyTable* InAdjacency, uint8_t InPathColor, NodeBlockTest InNodeBlockTest);
+
+		// Call after the adjacency was rebuilt for the given tiles.
+		void RebuildTiles(const std::vector<int32_t>& Tiles);
+
+		/*!
+		 * \brief False when no path with the rules of the labels goes from start to destination, like AStarSearch::AstarSearch.
+		 *		  Checks the steps around both tiles and compares labels, so it doesn't depend on the size of the grid.
+		 */
+		bool CanReach(int32_t start, int32_t destination) const;
+
+		bool Matches(uint8_t InPathColor, NodeBlockTest InNodeBlockTest) const { return pathColor == InPathColor && nodeBlockTest == InNodeBlockTest; }
+
+		int32_t GetLabel(int32_t tile) const { return labels[tile]; }
+		uint8_t GetTileColor(int32_t tile) const { return tilePool.colors[tile]; }
+		int32_t GetComponentCount() const { return static_cast<int32_t>(componentSizes.size() - freeLabels.size()); }
+
+		// Tiles visited by the last build or rebuild.
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = tilePool.GetNodeBytes() + static_cast<int64_t>(labels.size()) * (sizeof(int32_t) * 3 + sizeof(uint8_t));
+			return result;
+		}
+
+		// Walking around a removed link gives up after this many tiles and relabels the whole component.
+		static constexpr int32_t LocalSearchLimit = 1024;
+
+	private:
+		enum class VisitResult
+		{
+			// Every linked tile of the label was visited.
+			Complete,
+			// Every pending tile was found before that.
+			FoundPending,
+			// Hit the limit.
+			GaveUp,
+		};
+
+		bool CanLeave(int32_t tile) const { return (tilePool.colors[tile] & pathColor) != 0; }
+		bool CanStep(int32_t tile, int slot) const;
+		bool CanStepBack(int32_t tile, int slot) const;
+		bool IsThrough(int32_t tile) const;
+		uint8_t GetLinkMask(int32_t tile) const;
+
+		/*!
+		 * \brief Visit tiles of the label linked to the origin, marked with a new visit mark, into visitedTiles.
+		 *
+		 * \param limit
+		 *		  Give up after this many tiles. INT32_MAX for the whole component.
+		 */
+		VisitResult VisitComponent(int32_t origin, int32_t limit);
+
+		void SetLabel(int32_t tile, int32_t label);
+		int32_t NewLabel();
+
+		// Split components where links were removed, then merge them where links were added.
+		void SplitAround(std::vector<int32_t>& Tiles);
+		void MergeAcross(int32_t tile, int32_t otherTile);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		uint8_t pathColor = ElementMask::Any;
+		NodeBlockTest nodeBlockTest = &NodeTester::Test_None;
+
+		// Every tile, node index is tile index, for testers outside of searches.
+		NodePool tilePool;
+
+		// InvalidIndex for tiles a path can't go through.
+		std::vector<int32_t> labels;
+		// Bit i is set when the tile is linked to its neighbor i.
+		std::vector<uint8_t> linkMasks;
+
+		std::vector<int32_t> componentSizes;
+		std::vector<int32_t> freeLabels;
+
+		std::vector<uint32_t> visitMarks;
+		std::vector<uint32_t> pendingMarks;
+		uint32_t visitMark = 0;
+		// Tiles marked with pendingMark, for VisitComponent to look for.
+		uint32_t pendingMark = 0;
+		int32_t pendingCount = 0;
+
+		// Scratch buffers of builds and rebuilds.
+		std::vector<int32_t> visitedTiles;
+		std::vector<int32_t> changedTiles;
+		std::vector<int32_t> splitTiles;
+		std::vector<int32_t> mergeTiles;
+	};
+
+	/*!
+	 * \brief ComponentLabels for any rules, built per path color and tester on first use.
+	 *
+	 *		  Labels are valid for the adjacency version the index last caught up with, see GetVersion.
+	 *		  If the adjacency was rebuilt without telling the index, its version differs and every label set is dropped.
+	 */
+	class ComponentIndex
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		// Labels of the rules of the request, built if there are none yet.
+		const ComponentLabels& GetLabels(const PathRequest& request);
+		// Null if not built yet, or built for an older version of the adjacency.
+		const ComponentLabels* FindLabels(const PathRequest& request) const;
+
+		// False when AStarSearch::FindPath can't find a path for the request.
+		bool CanReach(const PathRequest& request) { return CanReach(GetLabels(request), request); }
+		static bool CanReach(const ComponentLabels& Labels, const PathRequest& request);
+
+		// Call with every tile the adjacency rebuilt since GetVersion, like FHexGridView::GetChangedTilesSince gives.
+		void NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles);
+
+		// Adjacency version the labels are valid for.
+		uint32_t GetVersion() const { return version; }
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		std::vector<std::unique_ptr<ComponentLabels>> labelSets;
+		uint32_t version = 0;
+	};
+}
@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AkPathfinding
+{
+	void DistanceField::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+		nodePool.Initialize(Adjacency);
+	}
+
+	void DistanceField::Build(const std::vector<int32_t>& InGoals, uint8_t InPathColor, NodeBlockTest InNodeBlockTest)
+	{
+		goals = InGoals;
+		pathColor = InPathColor;
+		nodeBlockTest = InNodeBlockTest;
+
+		Rebuild();
+	}
+
+	void DistanceField::Rebuild()
+	{
+		stats.Reset();
+
+		// Reset all containers.
+		nodePool.Reset();
+		openList.Reset();
+
+		const int32_t tileCount = Adjacency->GetTileCount();
+
+		// Add every tile in order, so node index is tile index.
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			nodePool.Add(tile);
+		}
+
+		isGoal.assign(tileCount, 0);
+		isInvalid.assign(tileCount, 0);
+
+		// Push goal nodes and kick off the search.
+		for (const int32_t goal : goals)
+		{
+			if (goal == InvalidIndex || isGoal[goal])
+			{
+				continue;
+			}
+
+			isGoal[goal] = 1;
+			nodePool.costs[goal] = 0;
+			openList.Push(goal);
+		}
+
+		Propagate();
+	}
+
+	void DistanceField::Repair(const std::vector<int32_t>& ChangedTiles)
+	{
+		stats.Reset();
+		invalidTiles.clear();
+
+		for (const int32_t tile : ChangedTiles)
+		{
+			nodePool.RefreshTileData(tile);
+
+			if (isInvalid[tile] == 0)
+			{
+				isInvalid[tile] = 1;
+				invalidTiles.push_back(tile);
+			}
+		}
+
+		// Whatever steps into an invalid tile on its way to a goal is invalid too.
+		for (size_t invalidIndex = 0; invalidIndex < invalidTiles.size(); ++invalidIndex)
+		{
+			const int32_t invalidTile = invalidTiles[invalidIndex];
+			const TileLinks& invalidLinks = Adjacency->GetLinks(invalidTile);
+
+			for (int i = 0; i < invalidLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = invalidLinks.neighbors[i];
+
+				if (nodePool.parents[neighborTile] == invalidTile && isInvalid[neighborTile] == 0)
+				{
+					isInvalid[neighborTile] = 1;
+					invalidTiles.push_back(neighborTile);
+				}
+			}
+		}
+
+		for (const int32_t tile : invalidTiles)
+		{
+			// Goals keep their cost, but their steps may have changed, so expand them again.
+			if (isGoal[tile])
+			{
+				openList.Push(tile);
+				continue;
+			}
+
+			nodePool.costs[tile] = INT32_MAX;
+			nodePool.parents[tile] = InvalidIndex;
+		}
+
+		for (const int32_t tile : invalidTiles)
+		{
+			if (isGoal[tile] == 0)
+			{
+				PullCost(tile);
+			}
+		}
+
+		for (const int32_t tile : invalidTiles)
+		{
+			isInvalid[tile] = 0;
+		}
+
+		Propagate();
+	}
+
+	bool DistanceField::GetPath(int32_t start, std::vector<int32_t>& OutPath) const
+	{
+		OutPath.clear();
+
+		if (nodePool.costs[start] == INT32_MAX)
+		{
+			return false;
+		}
+
+		for (int32_t tile = nodePool.parents[start]; tile != InvalidIndex; tile = nodePool.parents[tile])
+		{
+			OutPath.push_back(tile);
+		}
+
+		std::reverse(OutPath.begin(), OutPath.end());
+		return true;
+	}
+
+	bool DistanceField::Matches(const std::vector<int32_t>& InGoals, uint8_t InPathColor, NodeBlockTest InNodeBlockTest) const
+	{
+		return pathColor == InPathColor
+			&& nodeBlockTest == InNodeBlockTest
+			&& goals == InGoals;
+	}
+
+	void DistanceField::PullCost(int32_t tile)
+	{
+		if (CanLeave(tile) == false)
+		{
+			return;
+		}
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = tileLinks.neighbors[i];
+
+			// Costs of other invalid tiles are not settled yet, they push theirs when they are.
+			if (nodePool.costs[neighborTile] == INT32_MAX || (isInvalid[neighborTile] && isGoal[neighborTile] == 0))
+			{
+				continue;
+			}
+
+			if ((*nodeBlockTest)(nodePool, tile, neighborTile, tileLinks.IsPassable(i)) == false)
+			{
+				// Blocked.
+				continue;
+			}
+
+			const int32_t newCost = nodePool.costs[neighborTile] + tileLinks.costs[i];
+
+			if (newCost < nodePool.costs[tile])
+			{
+				nodePool.costs[tile] = newCost;
+				nodePool.parents[tile] = neighborTile;
+			}
+		}
+
+		if (nodePool.costs[tile] != INT32_MAX)
+		{
+			openList.Push(tile);
+		}
+	}
+
+	void DistanceField::Propagate()
+	{
+		while (openList.Num() > 0)
+		{
+			const int32_t currTile = openList.PopIndex();
+			const int32_t currCost = nodePool.costs[currTile];
+
+			++stats.nodesExpanded;
+
+			// Grab neighbors to expand.
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			// Check all neighbors, walking the step backwards.
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = currLinks.neighbors[i];
+
+				// The path leaves the neighbor, so it must have the path color.
+				if (CanLeave(neighborTile) == false)
+				{
+					continue;
+				}
+
+				if ((*nodeBlockTest)(nodePool, neighborTile, currTile, currLinks.IsReversePassable(i)) == false)
+				{
+					// Blocked.
+					continue;
+				}
+
+				const int32_t newCost = currCost + currLinks.reverseCosts[i];
+
+				// If this is not better than previous approach,
+				if (newCost >= nodePool.costs[neighborTile])
+				{
+					// skip.
+					continue;
+				}
+
+				// Fill in.
+				nodePool.costs[neighborTile] = newCost;
+				assert(newCost > 0);
+				nodePool.parents[neighborTile] = currTile;
+
+				// If this node is not in the open list,
+				if (nodePool.IsOpened(neighborTile) == false)
+				{
+					// add to the open list.
+					openList.Push(neighborTile);
+				}
+				else
+				{
+					// otherwise move it up to its new place.
+					openList.Update(neighborTile);
+				}
+			}
+		}
+	}
+
+	void DistanceFieldCache::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+
+		// Fields are sized for the grid.
+		entries.clear();
+	}
+
+	void DistanceFieldCache::SetCapacity(int32_t InCapacity)
+	{
+		capacity = std::max(InCapacity, 1);
+
+		while (static_cast<int32_t>(entries.size()) > capacity)
+		{
+			const auto oldest = std::min_element(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return lhs.lastUse < rhs.lastUse; });
+			entries.erase(oldest);
+		}
+	}
+
+	const DistanceField& DistanceFieldCache::GetField(const std::vector<int32_t>& Goals, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		for (Entry& entry : entries)
+		{
+			if (entry.field->Matches(Goals, pathColor, nodeBlockTest))
+			{
+				entry.lastUse = ++useCount;
+				return *entry.field;
+			}
+		}
+
+		Entry* entry = nullptr;
+
+		if (static_cast<int32_t>(entries.size()) < capacity)
+		{
+			entries.push_back(Entry());
+			entry = &entries.back();
+			entry->field.reset(new DistanceField());
+			entry->field->Initialize(Adjacency);
+		}
+		else
+		{
+			// Reuse the storage of the one unused the longest.
+			entry = &*std::min_element(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return lhs.lastUse < rhs.lastUse; });
+		}
+
+		entry->lastUse = ++useCount;
+		entry->field->Build(Goals, pathColor, nodeBlockTest);
+
+		return *entry->field;
+	}
+
+	void DistanceFieldCache::Repair(const std::vector<int32_t>& ChangedTiles)
+	{
+		for (Entry& entry : entries)
+		{
+			entry.field->Repair(ChangedTiles);
+		}
+	}
+
+	void DistanceFieldCache::Rebuild()
+	{
+		for (Entry& entry : entries)
+		{
+			entry.field->Rebuild();
+		}
+	}
+
+	void DistanceFieldCache::Clear()
+	{
+		entries.clear();
+	}
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Cost from every tile of the grid to the closest tile of a goal set, and the next step toward it.
+	 *
+	 *		  Built by a single Dijkstra run backwards from all goals at once.
+	 *		  Paths follow the rules of AStarSearch::FindPath with the same path color and tester:
+	 *		  every tile but the goal must have the path color, and every step must pass the tester.
+	 *
+	 *		  Nodes cover the whole grid and node index is tile index, so lookups are O(1).
+	 *		  After tiles change, Repair() fixes only the tiles whose path went through them.
+	 */
+	class DistanceField
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		void Build(const std::vector<int32_t>& InGoals, uint8_t InPathColor, NodeBlockTest InNodeBlockTest);
+
+		// Build again with the same goals and rules, for when the whole grid may have changed.
+		void Rebuild();
+
+		/*!
+		 * \brief Update the field after the adjacency was rebuilt for the given tiles.
+		 *
+		 *		  Tiles whose next steps lead through a changed tile lose their cost
+		 *		  and pull it again from the tiles around them.
+		 *		  Cheaper paths opened by the change spread from the changed tiles.
+		 */
+		void Repair(const std::vector<int32_t>& ChangedTiles);
+
+		// INT32_MAX if no goal can be reached from the tile.
+		int32_t GetDistance(int32_t tile) const { return nodePool.costs[tile]; }
+
+		// InvalidIndex on goals and on tiles which can't reach one.
+		int32_t GetNextStep(int32_t tile) const { return nodePool.parents[tile]; }
+
+		/*!
+		 * \brief Path from the tile to the closest goal, in the same order as AStarSearch:
+		 *		  goal first, the tile itself excluded.
+		 *
+		 * \return false if no goal can be reached from the tile.
+		 */
+		bool GetPath(int32_t start, std::vector<int32_t>& OutPath) const;
+
+		bool Matches(const std::vector<int32_t>& InGoals, uint8_t InPathColor, NodeBlockTest InNodeBlockTest) const;
+
+		// Counters of the last Build() or Repair().
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = nodePool.GetNodeBytes();
+			return result;
+		}
+
+	private:
+		// Cheapest step from the tile onto a tile which keeps its cost.
+		void PullCost(int32_t tile);
+		void Propagate();
+
+		bool CanLeave(int32_t tile) const { return isGoal[tile] == 0 && (nodePool.colors[tile] & pathColor) != 0; }
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		std::vector<int32_t> goals;
+		uint8_t pathColor = ElementMask::Any;
+		NodeBlockTest nodeBlockTest = &NodeTester::Test_None;
+
+		NodePool nodePool;
+		NodeSorter nodeSorter = NodeSorter(nodePool);
+		OpenList openList = OpenList(nodePool, nodeSorter);
+
+		std::vector<uint8_t> isGoal;
+
+		// Tiles Repair() took the cost from.
+		std::vector<int32_t> invalidTiles;
+		std::vector<uint8_t> isInvalid;
+	};
+
+	/*!
+	 * \brief Distance fields of the goal sets queried recently, kept up to date as tiles change.
+	 *
+	 *		  A field is built the first time its goals and rules are asked for.
+	 *		  When more than the capacity are kept, the one unused the longest is dropped.
+	 */
+	class DistanceFieldCache
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		void SetCapacity(int32_t InCapacity);
+
+		// Goals are compared in the given order, so keep it stable between calls.
+		const DistanceField& GetField(const std::vector<int32_t>& Goals, uint8_t pathColor, NodeBlockTest nodeBlockTest);
+
+		// Repair every field after the adjacency was rebuilt for the given tiles.
+		void Repair(const std::vector<int32_t>& ChangedTiles);
+
+		// Rebuild every field after the adjacency was rebuilt as a whole.
+		void Rebuild();
+
+		void Clear();
+
+		int32_t Num() const { return static_cast<int32_t>(entries.size()); }
+
+	private:
+		struct Entry
+		{
+			std::unique_ptr<DistanceField> field;
+			uint64_t lastUse = 0;
+		};
+
+		const AdjacencyTable* Adjacency = nullptr;
+		std::vector<Entry> entries;
+
+		int32_t capacity = 16;
+		uint64_t useCount = 0;
+	};
+}
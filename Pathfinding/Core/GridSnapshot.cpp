@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GridSnapshot.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+namespace AkPathfinding
+{
+	void GridSnapshot::Initialize(int32_t InTileCount)
+	{
+		tileCount = InTileCount;
+		pages.clear();
+
+		for (int32_t first = 0; first < tileCount; first += PageSize)
+		{
+			const std::shared_ptr<Page> page = std::make_shared<Page>();
+			std::fill(std::begin(page->heights), std::end(page->heights), int8_t(0));
+			std::fill(std::begin(page->colors), std::end(page->colors), ElementMask::None);
+
+			pages.push_back(page);
+		}
+	}
+
+	void GridSnapshot::SetTile(int32_t tile, int32_t height, uint8_t color)
+	{
+		Page& page = GetPageForWrite(tile);
+		page.heights[tile & PageMask] = static_cast<int8_t>(height);
+		page.colors[tile & PageMask] = color;
+	}
+
+	void GridSnapshot::SetHeight(int32_t tile, int32_t height)
+	{
+		GetPageForWrite(tile).heights[tile & PageMask] = static_cast<int8_t>(height);
+	}
+
+	void GridSnapshot::SetColor(int32_t tile, uint8_t color)
+	{
+		GetPageForWrite(tile).colors[tile & PageMask] = color;
+	}
+
+	void GridSnapshot::GetChangedTiles(const GridSnapshot& Other, std::vector<int32_t>& OutTiles) const
+	{
+		OutTiles.clear();
+
+		for (size_t i = 0; i < pages.size(); ++i)
+		{
+			const Page* page = pages[i].get();
+			const Page* otherPage = Other.pages[i].get();
+
+			// Shared, nothing changed.
+			if (page == otherPage)
+			{
+				continue;
+			}
+
+			const int32_t first = static_cast<int32_t>(i) << PageBits;
+			const int32_t count = std::min(PageSize, tileCount - first);
+
+			for (int32_t j = 0; j < count; ++j)
+			{
+				if (page->heights[j] != otherPage->heights[j] || page->colors[j] != otherPage->colors[j])
+				{
+					OutTiles.push_back(first + j);
+				}
+			}
+		}
+	}
+
+	int32_t GridSnapshot::GetSharedPageCount(const GridSnapshot& Other) const
+	{
+		int32_t count = 0;
+
+		for (size_t i = 0; i < pages.size() && i < Other.pages.size(); ++i)
+		{
+			count += pages[i] == Other.pages[i];
+		}
+
+		return count;
+	}
+
+	GridSnapshot::Page& GridSnapshot::GetPageForWrite(int32_t tile)
+	{
+		std::shared_ptr<Page>& page = pages[tile >> PageBits];
+
+		if (page.use_count() > 1)
+		{
+			page = std::make_shared<Page>(*page);
+		}
+
+		return *page;
+	}
+
+	void SnapshotGrid::Initialize(const IPathGrid* InBaseGrid, const GridSnapshot& InSnapshot)
+	{
+		BaseGrid = InBaseGrid;
+		snapshot = InSnapshot;
+		changedTiles.clear();
+		editedTiles.clear();
+
+		blocked.resize(snapshot.GetTileCount());
+
+		for (int32_t tile = 0; tile < snapshot.GetTileCount(); ++tile)
+		{
+			blocked[tile] = BaseGrid->IsBlocked(tile);
+		}
+
+		adjacency.Build(this);
+	}
+
+	void SnapshotGrid::SetSnapshot(const GridSnapshot& InSnapshot)
+	{
+		InSnapshot.GetChangedTiles(snapshot, changedTiles);
+		snapshot = InSnapshot;
+
+		// Blocked tiles not rebuilt yet.
+		if (editedTiles.empty() == false)
+		{
+			changedTiles.insert(changedTiles.end(), editedTiles.begin(), editedTiles.end());
+			editedTiles.clear();
+
+			std::sort(changedTiles.begin(), changedTiles.end());
+			changedTiles.erase(std::unique(changedTiles.begin(), changedTiles.end()), changedTiles.end());
+		}
+
+		adjacency.RebuildTiles(changedTiles);
+	}
+
+	void SnapshotGrid::SetTile(int32_t tile, int32_t height, uint8_t color)
+	{
+		// skip.
+		if (snapshot.GetHeight(tile) == height && snapshot.GetColor(tile) == color)
+		{
+			return;
+		}
+
+		snapshot.SetTile(tile, height, color);
+		editedTiles.push_back(tile);
+	}
+
+	void SnapshotGrid::SetBlocked(int32_t tile, bool bBlocked)
+	{
+		// skip.
+		if ((blocked[tile] != 0) == bBlocked)
+		{
+			return;
+		}
+
+		blocked[tile] = bBlocked;
+		editedTiles.push_back(tile);
+	}
+
+	void SnapshotGrid::RebuildEditedTiles()
+	{
+		// A tile set back and forth is rebuilt once.
+		std::sort(editedTiles.begin(), editedTiles.end());
+		editedTiles.erase(std::unique(editedTiles.begin(), editedTiles.end()), editedTiles.end());
+
+		changedTiles.swap(editedTiles);
+		editedTiles.clear();
+
+		adjacency.RebuildTiles(changedTiles);
+	}
+
+	int32_t SnapshotGrid::GetTileCount() const
+	{
+		return snapshot.GetTileCount();
+	}
+
+	int SnapshotGrid::GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[MaxNeighbors]) const
+	{
+		return BaseGrid->GetNeighbors(tile, OutNeighbors);
+	}
+
+	int32_t SnapshotGrid::GetCost(int32_t from, int32_t to) const
+	{
+		return BaseGrid->GetCost(from, to);
+	}
+
+	bool SnapshotGrid::IsPassable(int32_t from, int32_t to) const
+	{
+		return std::abs(snapshot.GetHeight(from) - snapshot.GetHeight(to)) <= 1;
+	}
+
+	bool SnapshotGrid::IsBlocked(int32_t tile) const
+	{
+		return blocked[tile] != 0;
+	}
+
+	uint8_t SnapshotGrid::GetTileColor(int32_t tile) const
+	{
+		return snapshot.GetColor(tile);
+	}
+
+	int32_t SnapshotGrid::Distance(int32_t from, int32_t to) const
+	{
+		return BaseGrid->Distance(from, to);
+	}
+}
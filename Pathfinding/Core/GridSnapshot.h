@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	// Height and color a lookahead gave a tile, kept on top of a snapshot instead of copying it.
+	struct TileEdit
+	{
+		int32_t tile;
+		int8_t height;
+		uint8_t color;
+	};
+
+	/*!
+	 * \brief Height and color of every tile, in pages shared between copies.
+	 *
+	 *		  Copying only copies the page pointers, and a page is copied the first time one of its tiles is set
+	 *		  while another snapshot still shares it. So a lookahead can copy the state, try a few edits
+	 *		  and throw the copy away, or keep the original to roll back to, thousands of times a turn.
+	 *		  A snapshot must not be set while another thread copies or reads it.
+	 */
+	class GridSnapshot
+	{
+	public:
+		static constexpr int32_t PageBits = 8;
+		static constexpr int32_t PageSize = 1 << PageBits;
+
+		// Tiles of height 0 without a color.
+		void Initialize(int32_t InTileCount);
+
+		int32_t GetTileCount() const { return tileCount; }
+
+		int32_t GetHeight(int32_t tile) const { return pages[tile >> PageBits]->heights[tile & PageMask]; }
+		uint8_t GetColor(int32_t tile) const { return pages[tile >> PageBits]->colors[tile & PageMask]; }
+
+		void SetTile(int32_t tile, int32_t height, uint8_t color);
+		void SetHeight(int32_t tile, int32_t height);
+		void SetColor(int32_t tile, uint8_t color);
+
+		/*!
+		 * \brief Tiles whose height or color differ from the other snapshot, in order.
+		 *		  Pages both share are skipped. Tile counts must be the same.
+		 */
+		void GetChangedTiles(const GridSnapshot& Other, std::vector<int32_t>& OutTiles) const;
+
+		// Pages this snapshot shares with the other one.
+		int32_t GetSharedPageCount(const GridSnapshot& Other) const;
+
+	private:
+		static constexpr int32_t PageMask = PageSize - 1;
+
+		struct Page
+		{
+			int8_t heights[PageSize];
+			uint8_t colors[PageSize];
+		};
+
+		// Copy the page of the tile if another snapshot shares it.
+		Page& GetPageForWrite(int32_t tile);
+
+	private:
+		std::vector<std::shared_ptr<Page>> pages;
+		int32_t tileCount = 0;
+	};
+
+	/*!
+	 * \brief Grid with the neighbors and costs of another grid, and the heights and colors of a snapshot.
+	 *
+	 *		  A step is passable if the height difference is at most one, as Raise, Lower and Expand abilities reason about it.
+	 *		  The grid keeps its own adjacency, so searches initialized with GetAdjacency run on the snapshot
+	 *		  without touching the grid it was made from. Switching snapshots only rebuilds the tiles they differ in.
+	 *		  Blocked tiles start as those of the other grid and may be changed, such as where a simulated unit stands.
+	 *		  Searches must not run while the snapshot is switched or edited.
+	 */
+	class SnapshotGrid : public IPathGrid
+	{
+	public:
+		// Build the adjacency of the snapshot. The base grid must outlive this one.
+		void Initialize(const IPathGrid* InBaseGrid, const GridSnapshot& InSnapshot);
+
+		// Switch to another snapshot of the same tiles, such as an edited copy of the current one or the one before it.
+		void SetSnapshot(const GridSnapshot& InSnapshot);
+
+		/*!
+		 * \brief Change a tile in place instead of switching snapshots, for lookahead keeping its own edits.
+		 *		  Pages the snapshot shares are copied the first time only. The adjacency follows at RebuildEditedTiles().
+		 */
+		void SetTile(int32_t tile, int32_t height, uint8_t color);
+		void SetBlocked(int32_t tile, bool bBlocked);
+
+		// Rebuild the adjacency of the tiles SetTile and SetBlocked changed since the last call.
+		void RebuildEditedTiles();
+
+		const GridSnapshot& GetSnapshot() const { return snapshot; }
+		const AdjacencyTable& GetAdjacency() const { return adjacency; }
+
+		// Tiles the last SetSnapshot or RebuildEditedTiles rebuilt.
+		const std::vector<int32_t>& GetChangedTiles() const { return changedTiles; }
+
+		virtual int32_t GetTileCount() const override;
+		virtual int GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[MaxNeighbors]) const override;
+		virtual int32_t GetCost(int32_t from, int32_t to) const override;
+		virtual bool IsPassable(int32_t from, int32_t to) const override;
+		virtual bool IsBlocked(int32_t tile) const override;
+		virtual uint8_t GetTileColor(int32_t tile) const override;
+		virtual int32_t Distance(int32_t from, int32_t to) const override;
+
+	private:
+		const IPathGrid* BaseGrid = nullptr;
+		GridSnapshot snapshot;
+		AdjacencyTable adjacency;
+		std::vector<uint8_t> blocked;
+		std::vector<int32_t> changedTiles;
+		std::vector<int32_t> editedTiles;
+	};
+}
@@ -0,0 +1,444 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HexBitboards.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "AdjacencyTable.h"
+
+namespace AkPathfinding
+{
+	bool HexBitboards::Build(const AdjacencyTable& Adjacency)
+	{
+		width = 0;
+		words.clear();
+
+		const int32_t tileCount = Adjacency.GetTileCount();
+
+		if (tileCount < 2)
+		{
+			return false;
+		}
+
+		// The first tile steps down a row to the width, or one past it.
+		const TileLinks& firstLinks = Adjacency.GetLinks(0);
+
+		for (int i = 0; i < firstLinks.neighborCount && IsValid() == false; ++i)
+		{
+			for (const int32_t candidateWidth : { firstLinks.neighbors[i], firstLinks.neighbors[i] - 1 })
+			{
+				if (candidateWidth < 2 || tileCount % candidateWidth != 0)
+				{
+					continue;
+				}
+
+				for (const int32_t candidateParity : { 0, 1 })
+				{
+					if (MatchesLayout(Adjacency, candidateWidth, candidateParity))
+					{
+						width = candidateWidth;
+						height = tileCount / candidateWidth;
+						shiftedParity = candidateParity;
+						break;
+					}
+				}
+
+				if (IsValid())
+				{
+					break;
+				}
+			}
+		}
+
+		if (IsValid() == false)
+		{
+			return false;
+		}
+
+		wordsPerRow = (width + 63) / 64;
+		words.assign(static_cast<size_t>(PlaneCount) * height * wordsPerRow, 0);
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			SetTile(Adjacency, tile);
+		}
+
+		return true;
+	}
+
+	void HexBitboards::RebuildTiles(const AdjacencyTable& Adjacency, const std::vector<int32_t>& Tiles)
+	{
+		if (IsValid() == false)
+		{
+			return;
+		}
+
+		for (const int32_t tile : Tiles)
+		{
+			SetTile(Adjacency, tile);
+
+			// Neighbors keep the steps into this tile as well.
+			const TileLinks& tileLinks = Adjacency.GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				SetTile(Adjacency, tileLinks.neighbors[i]);
+			}
+		}
+	}
+
+	void HexBitboards::GetWindow(int32_t tile, int32_t radius, uint8_t leaveColor, uint8_t destinationColor, Window& OutWindow) const
+	{
+		assert(radius >= 0 && radius <= MaxRadius);
+
+		OutWindow.centerX = tile % width;
+		OutWindow.centerY = tile / width;
+		OutWindow.radius = radius;
+		OutWindow.rowCount = radius * 2 + 1;
+
+		const uint64_t windowMask = (uint64_t(1) << OutWindow.rowCount) - 1;
+		const int32_t firstX = OutWindow.centerX - radius;
+
+		// Columns of the window in the grid.
+		const int32_t firstBit = std::max(0, -firstX);
+		const int32_t endBit = std::min(OutWindow.rowCount, width - firstX);
+		const uint64_t columnMask = (windowMask >> firstBit << firstBit) & ((uint64_t(1) << endBit) - 1);
+
+		for (int32_t row = 0; row < OutWindow.rowCount; ++row)
+		{
+			const int32_t y = OutWindow.centerY - radius + row;
+
+			OutWindow.bShifted[row] = (y & 1) == shiftedParity;
+
+			if (y < 0 || y >= height)
+			{
+				// Out of the grid.
+				OutWindow.tiles[row] = 0;
+				OutWindow.open[row] = 0;
+				OutWindow.uniform[row] = 0;
+				OutWindow.leave[row] = 0;
+				OutWindow.destination[row] = 0;
+
+				for (int direction = 0; direction < DirectionCount; ++direction)
+				{
+					OutWindow.passable[direction][row] = 0;
+				}
+
+				continue;
+			}
+
+			uint64_t planes[PlaneCount];
+			ReadRow(y, firstX, planes);
+
+			OutWindow.tiles[row] = columnMask;
+			OutWindow.open[row] = planes[OpenPlane] & windowMask;
+			OutWindow.uniform[row] = planes[UniformPlane] & windowMask;
+
+			uint64_t leave = 0;
+			uint64_t destination = 0;
+
+			for (int colorBit = 0; colorBit < 8; ++colorBit)
+			{
+				// All ones when the color is in the mask.
+				leave |= planes[ColorPlane + colorBit] & (0 - uint64_t(leaveColor >> colorBit & 1));
+				destination |= planes[ColorPlane + colorBit] & (0 - uint64_t(destinationColor >> colorBit & 1));
+			}
+
+			OutWindow.leave[row] = leave & windowMask;
+			OutWindow.destination[row] = destination & windowMask;
+
+			for (int direction = 0; direction < DirectionCount; ++direction)
+			{
+				OutWindow.passable[direction][row] = planes[PassablePlane + direction] & windowMask;
+			}
+		}
+	}
+
+	void HexBitboards::StepForward(const Window& InWindow, const uint64_t* From, uint64_t* OutRows)
+	{
+		const int32_t rowCount = InWindow.rowCount;
+
+		for (int32_t row = 0; row < rowCount; ++row)
+		{
+			OutRows[row] = 0;
+		}
+
+		for (int32_t row = 0; row < rowCount; ++row)
+		{
+			const uint64_t bits = From[row];
+
+			if (bits == 0)
+			{
+				continue;
+			}
+
+			// A shifted row steps up and down to the same column and the one right of it, others to the one left of it.
+			const int shift = InWindow.bShifted[row] ? 1 : 0;
+
+			OutRows[row] |= (bits & InWindow.passable[East][row]) << 1 | (bits & InWindow.passable[West][row]) >> 1;
+
+			if (row > 0)
+			{
+				OutRows[row - 1] |= (bits & InWindow.passable[NorthEast][row]) << shift | (bits & InWindow.passable[NorthWest][row]) >> (1 - shift);
+			}
+
+			if (row + 1 < rowCount)
+			{
+				OutRows[row + 1] |= (bits & InWindow.passable[SouthEast][row]) << shift | (bits & InWindow.passable[SouthWest][row]) >> (1 - shift);
+			}
+		}
+	}
+
+	void HexBitboards::StepBackward(const Window& InWindow, const uint64_t* To, uint64_t* OutRows)
+	{
+		const int32_t rowCount = InWindow.rowCount;
+
+		for (int32_t row = 0; row < rowCount; ++row)
+		{
+			// Bring the tiles of To back onto the tiles stepping into them, then keep the passable steps.
+			const int shift = InWindow.bShifted[row] ? 1 : 0;
+			const uint64_t above = row > 0 ? To[row - 1] : 0;
+			const uint64_t below = row + 1 < rowCount ? To[row + 1] : 0;
+
+			OutRows[row] = (To[row] >> 1 & InWindow.passable[East][row])
+				| (To[row] << 1 & InWindow.passable[West][row])
+				| (above >> shift & InWindow.passable[NorthEast][row])
+				| (above << (1 - shift) & InWindow.passable[NorthWest][row])
+				| (below >> shift & InWindow.passable[SouthEast][row])
+				| (below << (1 - shift) & InWindow.passable[SouthWest][row]);
+		}
+	}
+
+	void HexBitboards::GetNeighbors(const Window& InWindow, const uint64_t* From, uint64_t* OutRows)
+	{
+		for (int32_t row = 0; row < InWindow.rowCount; ++row)
+		{
+			OutRows[row] = 0;
+		}
+
+		for (int direction = 0; direction < DirectionCount; ++direction)
+		{
+			Move(InWindow, From, static_cast<Direction>(direction), OutRows);
+		}
+
+		for (int32_t row = 0; row < InWindow.rowCount; ++row)
+		{
+			OutRows[row] &= InWindow.tiles[row];
+		}
+	}
+
+	void HexBitboards::Move(const Window& InWindow, const uint64_t* Rows, Direction direction, uint64_t* OutRows)
+	{
+		const int32_t rowCount = InWindow.rowCount;
+
+		for (int32_t row = 0; row < rowCount; ++row)
+		{
+			const uint64_t bits = Rows[row];
+
+			if (bits == 0)
+			{
+				continue;
+			}
+
+			// A shifted row steps up and down to the same column and the one right of it, others to the one left of it.
+			const uint64_t right = InWindow.bShifted[row] ? bits << 1 : bits;
+			const uint64_t left = InWindow.bShifted[row] ? bits : bits >> 1;
+
+			switch (direction)
+			{
+			case East:
+				OutRows[row] |= bits << 1;
+				break;
+			case West:
+				OutRows[row] |= bits >> 1;
+				break;
+			case NorthEast:
+				if (row > 0)
+				{
+					OutRows[row - 1] |= right;
+				}
+				break;
+			case NorthWest:
+				if (row > 0)
+				{
+					OutRows[row - 1] |= left;
+				}
+				break;
+			case SouthEast:
+				if (row + 1 < rowCount)
+				{
+					OutRows[row + 1] |= right;
+				}
+				break;
+			case SouthWest:
+				if (row + 1 < rowCount)
+				{
+					OutRows[row + 1] |= left;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	bool HexBitboards::MatchesLayout(const AdjacencyTable& Adjacency, int32_t InWidth, int32_t InShiftedParity) const
+	{
+		const int32_t tileCount = Adjacency.GetTileCount();
+		const int32_t gridHeight = tileCount / InWidth;
+
+		int32_t expected[MaxNeighbors];
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			const TileLinks& tileLinks = Adjacency.GetLinks(tile);
+			const int expectedCount = GetExpectedNeighbors(tile, InWidth, gridHeight, InShiftedParity, expected);
+
+			if (expectedCount != tileLinks.neighborCount)
+			{
+				return false;
+			}
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				bool bFound = false;
+
+				for (int j = 0; j < expectedCount && bFound == false; ++j)
+				{
+					bFound = expected[j] == tileLinks.neighbors[i];
+				}
+
+				if (bFound == false)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	int HexBitboards::GetExpectedNeighbors(int32_t tile, int32_t InWidth, int32_t InHeight, int32_t InShiftedParity, int32_t (&OutNeighbors)[MaxNeighbors]) const
+	{
+		const int32_t x = tile % InWidth;
+		const int32_t y = tile / InWidth;
+
+		// Up and down steps of a shifted row go to the same column and the one right of it.
+		const int32_t verticalX = (y & 1) == InShiftedParity ? x : x - 1;
+
+		const int32_t offsets[MaxNeighbors][2] =
+		{
+			{ x + 1, y }, { x - 1, y },
+			{ verticalX, y - 1 }, { verticalX + 1, y - 1 },
+			{ verticalX, y + 1 }, { verticalX + 1, y + 1 },
+		};
+
+		int neighborCount = 0;
+
+		for (const auto& offset : offsets)
+		{
+			if (offset[0] >= 0 && offset[0] < InWidth && offset[1] >= 0 && offset[1] < InHeight)
+			{
+				OutNeighbors[neighborCount++] = offset[1] * InWidth + offset[0];
+			}
+		}
+
+		return neighborCount;
+	}
+
+	HexBitboards::Direction HexBitboards::GetDirection(int32_t tile, int32_t neighborTile) const
+	{
+		const int32_t x = tile % width;
+		const int32_t y = tile / width;
+		const int32_t neighborX = neighborTile % width;
+		const int32_t neighborY = neighborTile / width;
+
+		if (neighborY == y)
+		{
+			return neighborX > x ? East : West;
+		}
+
+		// Column of the west one of the two tiles up or down.
+		const int32_t verticalX = (y & 1) == shiftedParity ? x : x - 1;
+		const bool bEast = neighborX != verticalX;
+
+		if (neighborY < y)
+		{
+			return bEast ? NorthEast : NorthWest;
+		}
+
+		return bEast ? SouthEast : SouthWest;
+	}
+
+	void HexBitboards::SetTile(const AdjacencyTable& Adjacency, int32_t tile)
+	{
+		const TileLinks& tileLinks = Adjacency.GetLinks(tile);
+
+		SetBit(OpenPlane, tile, tileLinks.bBlocked == false);
+
+		for (int colorBit = 0; colorBit < 8; ++colorBit)
+		{
+			SetBit(static_cast<Plane>(ColorPlane + colorBit), tile, (tileLinks.color >> colorBit & 1) != 0);
+		}
+
+		bool bUniform = true;
+
+		for (int direction = 0; direction < DirectionCount; ++direction)
+		{
+			SetBit(static_cast<Plane>(PassablePlane + direction), tile, false);
+		}
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			bUniform = bUniform && tileLinks.costs[i] == 1;
+
+			if (tileLinks.IsPassable(i))
+			{
+				SetBit(static_cast<Plane>(PassablePlane + GetDirection(tile, tileLinks.neighbors[i])), tile, true);
+			}
+		}
+
+		SetBit(UniformPlane, tile, bUniform);
+	}
+
+	void HexBitboards::SetBit(Plane plane, int32_t tile, bool bSet)
+	{
+		const int32_t x = tile % width;
+		const int32_t y = tile / width;
+
+		uint64_t& word = words[(static_cast<size_t>(y) * wordsPerRow + x / 64) * PlaneCount + plane];
+		const uint64_t bit = uint64_t(1) << (x % 64);
+
+		word = bSet ? word | bit : word & ~bit;
+	}
+
+	void HexBitboards::ReadRow(int32_t y, int32_t x, uint64_t (&OutPlanes)[PlaneCount]) const
+	{
+		// The window starts at most MaxRadius columns left of the grid, and never right of it.
+		assert(x > -64 && x < width);
+
+		const int32_t wordIndex = x < 0 ? 0 : x / 64;
+		const int32_t offset = x < 0 ? 0 : x % 64;
+		const uint64_t* low = &words[(static_cast<size_t>(y) * wordsPerRow + wordIndex) * PlaneCount];
+		const uint64_t* high = wordIndex + 1 < wordsPerRow ? low + PlaneCount : nullptr;
+
+		for (int plane = 0; plane < PlaneCount; ++plane)
+		{
+			if (x < 0)
+			{
+				// Columns left of the grid are clear.
+				OutPlanes[plane] = low[plane] << -x;
+			}
+			else if (offset != 0 && high != nullptr)
+			{
+				OutPlanes[plane] = low[plane] >> offset | high[plane] << (64 - offset);
+			}
+			else
+			{
+				OutPlanes[plane] = low[plane] >> offset;
+			}
+		}
+	}
+}
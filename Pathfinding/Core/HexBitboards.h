@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	class AdjacencyTable;
+
+	/*!
+	 * \brief Tiles of a grid laid out in offset hex rows, as bit planes.
+	 *
+	 *		  Each row is a run of 64 bit words, one bit per tile. A small area is copied into a Window,
+	 *		  one word per row, so a flood moves every tile of a row in a single shift and mask per direction.
+	 *		  The layout is found from the adjacency. If it isn't offset rows there are no planes, see IsValid.
+	 */
+	class HexBitboards
+	{
+	public:
+		enum Direction
+		{
+			East,
+			West,
+			NorthEast,
+			NorthWest,
+			SouthEast,
+			SouthWest,
+			DirectionCount,
+		};
+
+		// A window is a square of rows around a tile, each fitting in a word.
+		static constexpr int32_t MaxRadius = 31;
+		static constexpr int32_t MaxWindowRows = MaxRadius * 2 + 1;
+
+		/*!
+		 * \brief Bit b of row r is the tile in column centerX - radius + b of row centerY - radius + r.
+		 *		  Bits out of the grid are clear in every plane.
+		 */
+		struct Window
+		{
+			int32_t centerX = 0;
+			int32_t centerY = 0;
+			int32_t radius = 0;
+			int32_t rowCount = 0;
+
+			// Tiles of the grid.
+			uint64_t tiles[MaxWindowRows];
+			// Tiles which aren't blocked.
+			uint64_t open[MaxWindowRows];
+			// Tiles whose steps all cost one.
+			uint64_t uniform[MaxWindowRows];
+			// Tiles with a color of the masks GetWindow was given.
+			uint64_t leave[MaxWindowRows];
+			uint64_t destination[MaxWindowRows];
+			// Steps that pass the height rule, at the tile they leave.
+			uint64_t passable[DirectionCount][MaxWindowRows];
+			// Odd or even rows are shifted half a tile right.
+			bool bShifted[MaxWindowRows];
+		};
+
+		// Find the layout and fill the planes. False if the adjacency isn't laid out in offset rows.
+		bool Build(const AdjacencyTable& Adjacency);
+
+		// Refresh the tiles and their neighbors, after the adjacency was rebuilt for the tiles.
+		void RebuildTiles(const AdjacencyTable& Adjacency, const std::vector<int32_t>& Tiles);
+
+		bool IsValid() const { return width > 0; }
+
+		// Layout found by Build: tiles per row, and whether odd or even rows are shifted.
+		int32_t GetWidth() const { return width; }
+		int32_t GetShiftedParity() const { return shiftedParity; }
+
+		// Copy the planes around the tile. Radius must not be more than MaxRadius.
+		void GetWindow(int32_t tile, int32_t radius, uint8_t leaveColor, uint8_t destinationColor, Window& OutWindow) const;
+
+		// Lowest set bit, bits must not be zero.
+		static int32_t FirstBit(uint64_t bits)
+		{
+#if defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanForward64(&bit, bits);
+			return static_cast<int32_t>(bit);
+#else
+			return __builtin_ctzll(bits);
+#endif
+		}
+
+		int32_t ToTile(const Window& InWindow, int32_t row, int32_t bit) const
+		{
+			return (InWindow.centerY - InWindow.radius + row) * width + InWindow.centerX - InWindow.radius + bit;
+		}
+
+		// Tiles one passable step away from the tiles of From, whatever blocks them.
+		static void StepForward(const Window& InWindow, const uint64_t* From, uint64_t* OutRows);
+		// Tiles with a passable step onto the tiles of To.
+		static void StepBackward(const Window& InWindow, const uint64_t* To, uint64_t* OutRows);
+		// Tiles of the grid next to the tiles of From.
+		static void GetNeighbors(const Window& InWindow, const uint64_t* From, uint64_t* OutRows);
+
+	private:
+		enum Plane
+		{
+			OpenPlane,
+			UniformPlane,
+			// One per ElementMask bit.
+			ColorPlane,
+			PassablePlane = ColorPlane + 8,
+			PlaneCount = PassablePlane + DirectionCount,
+		};
+
+		// Every tile in offset rows of the width, with odd or even rows shifted.
+		bool MatchesLayout(const AdjacencyTable& Adjacency, int32_t InWidth, int32_t InShiftedParity) const;
+		int GetExpectedNeighbors(int32_t tile, int32_t InWidth, int32_t InHeight, int32_t InShiftedParity, int32_t (&OutNeighbors)[MaxNeighbors]) const;
+		Direction GetDirection(int32_t tile, int32_t neighborTile) const;
+
+		void SetTile(const AdjacencyTable& Adjacency, int32_t tile);
+		void SetBit(Plane plane, int32_t tile, bool bSet);
+
+		// 64 bits of every plane of the row, starting at column x. Clear out of the grid.
+		void ReadRow(int32_t y, int32_t x, uint64_t (&OutPlanes)[PlaneCount]) const;
+
+		// Move every bit of the rows one tile in the direction, into OutRows.
+		static void Move(const Window& InWindow, const uint64_t* Rows, Direction direction, uint64_t* OutRows);
+
+	private:
+		int32_t width = 0;
+		int32_t height = 0;
+		int32_t shiftedParity = 0;
+		int32_t wordsPerRow = 0;
+
+		// Row major, then word, then plane, so a row of a window is read from one place.
+		std::vector<uint64_t> words;
+	};
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HexMap.h"
+
+#include <cstdlib>
+
+namespace AkPathfinding
+{
+	namespace
+	{
+		// Neighbor offsets of odd-r rows, indexed by row parity.
+		constexpr int32_t NeighborOffsets[2][MaxNeighbors][2] =
+		{
+			{ { 1, 0 }, { 0, -1 }, { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, 1 } },
+			{ { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 1 } },
+		};
+	}
+
+	HexMap::HexMap(int32_t InWidth, int32_t InHeight)
+			: width(InWidth), height(InHeight),
+			  heights(InWidth * InHeight, 0), colors(InWidth * InHeight, ElementMask::Stone), blocked(InWidth * InHeight, 0)
+	{}
+
+	void HexMap::SetTile(int32_t tile, int32_t tileHeight, uint8_t color, bool bBlocked)
+	{
+		heights[tile] = static_cast<int8_t>(tileHeight);
+		colors[tile] = color;
+		blocked[tile] = bBlocked;
+	}
+
+	int32_t HexMap::GetTileCount() const
+	{
+		return width * height;
+	}
+
+	int HexMap::GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[MaxNeighbors]) const
+	{
+		const int32_t x = GetX(tile);
+		const int32_t y = GetY(tile);
+		int neighborCount = 0;
+
+		for (const auto& offset : NeighborOffsets[y & 1])
+		{
+			const int32_t neighborX = x + offset[0];
+			const int32_t neighborY = y + offset[1];
+
+			if (neighborX >= 0 && neighborX < width && neighborY >= 0 && neighborY < height)
+			{
+				OutNeighbors[neighborCount++] = ToIndex(neighborX, neighborY);
+			}
+		}
+
+		return neighborCount;
+	}
+
+	int32_t HexMap::GetCost(int32_t, int32_t) const
+	{
+		return 1;
+	}
+
+	bool HexMap::IsPassable(int32_t from, int32_t to) const
+	{
+		return std::abs(heights[from] - heights[to]) <= 1;
+	}
+
+	bool HexMap::IsBlocked(int32_t tile) const
+	{
+		return blocked[tile] != 0;
+	}
+
+	uint8_t HexMap::GetTileColor(int32_t tile) const
+	{
+		return colors[tile];
+	}
+
+	int32_t HexMap::Distance(int32_t from, int32_t to) const
+	{
+		// Convert to axial coordinates first.
+		const int32_t fromY = GetY(from);
+		const int32_t toY = GetY(to);
+		const int32_t fromQ = GetX(from) - (fromY - (fromY & 1)) / 2;
+		const int32_t toQ = GetX(to) - (toY - (toY & 1)) / 2;
+
+		const int32_t dq = fromQ - toQ;
+		const int32_t dr = fromY - toY;
+
+		return (std::abs(dq) + std::abs(dr) + std::abs(dq + dr)) / 2;
+	}
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Standalone hex grid for headless runs (benchmarks, tools).
+	 *
+	 *		  Rows are offset "odd-r" style: odd rows are shoved right by half a tile.
+	 *		  Tile index is y * width + x.
+	 *		  A step is passable if the height difference is at most one, and always costs one.
+	 */
+	class HexMap : public IPathGrid
+	{
+	public:
+		HexMap(int32_t InWidth, int32_t InHeight);
+
+		int32_t GetWidth() const { return width; }
+		int32_t GetHeight() const { return height; }
+
+		int32_t ToIndex(int32_t x, int32_t y) const { return y * width + x; }
+		int32_t GetX(int32_t tile) const { return tile % width; }
+		int32_t GetY(int32_t tile) const { return tile / width; }
+
+		void SetTile(int32_t tile, int32_t tileHeight, uint8_t color, bool bBlocked);
+		int32_t GetTileHeight(int32_t tile) const { return heights[tile]; }
+
+		virtual int32_t GetTileCount() const override;
+		virtual int GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[MaxNeighbors]) const override;
+		virtual int32_t GetCost(int32_t from, int32_t to) const override;
+		virtual bool IsPassable(int32_t from, int32_t to) const override;
+		virtual bool IsBlocked(int32_t tile) const override;
+		virtual uint8_t GetTileColor(int32_t tile) const override;
+		virtual int32_t Distance(int32_t from, int32_t to) const override;
+
+	private:
+		int32_t width;
+		int32_t height;
+
+		std::vector<int8_t> heights;
+		std::vector<uint8_t> colors;
+		std::vector<uint8_t> blocked;
+	};
+}
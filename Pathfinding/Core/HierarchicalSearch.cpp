@@ -0,0 +1,668 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HierarchicalSearch.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AkPathfinding
+{
+	void ClusterGraph::Build(const AdjacencyTable* InAdjacency, int32_t InGridWidth, int32_t InClusterSize, uint8_t InPathColor, NodeBlockTest InNodeBlockTest)
+	{
+		Adjacency = InAdjacency;
+		gridWidth = InGridWidth;
+		clusterSize = InClusterSize;
+		pathColor = InPathColor;
+		nodeBlockTest = InNodeBlockTest;
+
+		const int32_t tileCount = Adjacency->GetTileCount();
+		const int32_t gridHeight = tileCount / gridWidth;
+
+		clustersPerRow = (gridWidth + clusterSize - 1) / clusterSize;
+		const int32_t clusterCount = clustersPerRow * ((gridHeight + clusterSize - 1) / clusterSize);
+
+		clusterOfTiles.resize(tileCount);
+		clusterTiles.assign(clusterCount, std::vector<int32_t>());
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			const int32_t cluster = (tile / gridWidth / clusterSize) * clustersPerRow + (tile % gridWidth) / clusterSize;
+
+			clusterOfTiles[tile] = cluster;
+			clusterTiles[cluster].push_back(tile);
+		}
+
+		// Add every tile in order, so node index is tile index.
+		tilePool.Initialize(Adjacency);
+
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			tilePool.Add(tile);
+		}
+
+		localPool.Initialize(Adjacency);
+		abstractPool.Initialize(Adjacency);
+
+		clusterEntrances.assign(clusterCount, std::vector<int32_t>());
+		nodeOfTiles.assign(tileCount, InvalidIndex);
+		nodeEdges.clear();
+		freeNodes.clear();
+
+		for (int32_t cluster = 0; cluster < clusterCount; ++cluster)
+		{
+			RebuildEntrances(cluster);
+		}
+
+		for (int32_t cluster = 0; cluster < clusterCount; ++cluster)
+		{
+			RebuildEdges(cluster);
+		}
+	}
+
+	void ClusterGraph::RebuildTiles(const std::vector<int32_t>& Tiles)
+	{
+		std::vector<int32_t> dirtyClusters;
+
+		for (const int32_t tile : Tiles)
+		{
+			tilePool.RefreshTileData(tile);
+			dirtyClusters.push_back(clusterOfTiles[tile]);
+		}
+
+		std::sort(dirtyClusters.begin(), dirtyClusters.end());
+		dirtyClusters.erase(std::unique(dirtyClusters.begin(), dirtyClusters.end()), dirtyClusters.end());
+
+		// Borders of a dirty cluster move entrances of the clusters on the other side as well.
+		std::vector<int32_t> affectedClusters = dirtyClusters;
+
+		for (const int32_t cluster : dirtyClusters)
+		{
+			GetNeighborClusters(cluster, neighborClusters);
+			affectedClusters.insert(affectedClusters.end(), neighborClusters.begin(), neighborClusters.end());
+		}
+
+		std::sort(affectedClusters.begin(), affectedClusters.end());
+		affectedClusters.erase(std::unique(affectedClusters.begin(), affectedClusters.end()), affectedClusters.end());
+
+		for (const int32_t cluster : affectedClusters)
+		{
+			RebuildEntrances(cluster);
+		}
+
+		for (const int32_t cluster : affectedClusters)
+		{
+			RebuildEdges(cluster);
+		}
+	}
+
+	bool ClusterGraph::FindPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath)
+	{
+		stats.Reset();
+		OutPath.clear();
+
+		// Already there.
+		if (start == destination)
+		{
+			return true;
+		}
+
+		const int32_t startCluster = clusterOfTiles[start];
+		const int32_t destinationCluster = clusterOfTiles[destination];
+
+		// Link the start to the entrances of its cluster, and to the destination if it is in the same one.
+		SearchCluster(start, startCluster, false, InvalidIndex);
+		startEdges.clear();
+
+		for (const int32_t tile : clusterEntrances[startCluster])
+		{
+			const int32_t localNodeIndex = localPool.Find(tile);
+
+			if (tile != start && localNodeIndex != InvalidIndex && localPool.costs[localNodeIndex] != INT32_MAX)
+			{
+				startEdges.push_back({ tile, localPool.costs[localNodeIndex] });
+			}
+		}
+
+		if (destinationCluster == startCluster)
+		{
+			const int32_t localNodeIndex = localPool.Find(destination);
+
+			if (localNodeIndex != InvalidIndex && localPool.costs[localNodeIndex] != INT32_MAX)
+			{
+				startEdges.push_back({ destination, localPool.costs[localNodeIndex] });
+			}
+		}
+
+		// Link the entrances of the destination cluster to the destination.
+		SearchCluster(destination, destinationCluster, true, InvalidIndex);
+		destinationEdges.clear();
+
+		for (const int32_t tile : clusterEntrances[destinationCluster])
+		{
+			const int32_t localNodeIndex = localPool.Find(tile);
+
+			if (localNodeIndex != InvalidIndex && localPool.costs[localNodeIndex] != INT32_MAX)
+			{
+				destinationEdges.push_back({ tile, localPool.costs[localNodeIndex] });
+			}
+		}
+
+		// A* over the entrances.
+		abstractPool.Reset();
+		abstractList.Reset();
+
+		const int32_t startNodeIndex = abstractPool.Add(start);
+		abstractPool.costs[startNodeIndex] = 0;
+		abstractPool.totalCosts[startNodeIndex] = 0;
+
+		abstractList.Push(startNodeIndex);
+
+		int32_t destinationNodeIndex = InvalidIndex;
+
+		while (abstractList.Num() > 0)
+		{
+			const int32_t currNodeIndex = abstractList.PopIndex();
+			abstractPool.SetClosed(currNodeIndex, true);
+
+			const int32_t currTile = abstractPool.tiles[currNodeIndex];
+
+			++stats.nodesExpanded;
+
+			// We found destination.
+			if (currTile == destination)
+			{
+				destinationNodeIndex = currNodeIndex;
+				break;
+			}
+
+			if (currTile == start)
+			{
+				for (const Edge& edge : startEdges)
+				{
+					RelaxAbstract(currNodeIndex, edge.tile, edge.cost, destination);
+				}
+			}
+
+			// The start may be an entrance too, with steps out of its cluster.
+			if (nodeOfTiles[currTile] != InvalidIndex)
+			{
+				for (const Edge& edge : nodeEdges[nodeOfTiles[currTile]])
+				{
+					RelaxAbstract(currNodeIndex, edge.tile, edge.cost, destination);
+				}
+			}
+
+			if (clusterOfTiles[currTile] == destinationCluster)
+			{
+				for (const Edge& edge : destinationEdges)
+				{
+					if (edge.tile == currTile)
+					{
+						RelaxAbstract(currNodeIndex, destination, edge.cost, destination);
+					}
+				}
+			}
+		}
+
+		if (destinationNodeIndex == InvalidIndex)
+		{
+			// No path found.
+			return false;
+		}
+
+		// Entrances from the destination back to the start.
+		abstractPath.clear();
+
+		for (int32_t nodeIndex = destinationNodeIndex; nodeIndex != InvalidIndex; nodeIndex = abstractPool.parents[nodeIndex])
+		{
+			abstractPath.push_back(abstractPool.tiles[nodeIndex]);
+		}
+
+		// Refine each abstract step into tiles, keeping the order of AStarSearch.
+		for (size_t i = 0; i + 1 < abstractPath.size(); ++i)
+		{
+			const int32_t stepEnd = abstractPath[i];
+			const int32_t stepBegin = abstractPath[i + 1];
+			const int32_t cluster = clusterOfTiles[stepBegin];
+
+			// Steps between clusters are single steps.
+			if (clusterOfTiles[stepEnd] != cluster)
+			{
+				OutPath.push_back(stepEnd);
+				continue;
+			}
+
+			SearchCluster(stepBegin, cluster, false, stepEnd);
+
+			const int32_t endNodeIndex = localPool.Find(stepEnd);
+
+			if (endNodeIndex == InvalidIndex || localPool.costs[endNodeIndex] == INT32_MAX)
+			{
+				// The graph is out of date.
+				OutPath.clear();
+				return false;
+			}
+
+			for (int32_t nodeIndex = endNodeIndex; localPool.tiles[nodeIndex] != stepBegin; nodeIndex = localPool.parents[nodeIndex])
+			{
+				OutPath.push_back(localPool.tiles[nodeIndex]);
+			}
+		}
+
+		return true;
+	}
+
+	void ClusterGraph::RebuildEntrances(int32_t cluster)
+	{
+		std::vector<int32_t> entrances;
+
+		GetNeighborClusters(cluster, neighborClusters);
+
+		for (const int32_t otherCluster : neighborClusters)
+		{
+			GetTransitions(cluster, otherCluster, transitions);
+
+			for (const Transition& transition : transitions)
+			{
+				entrances.push_back(cluster < otherCluster ? transition.firstTile : transition.secondTile);
+			}
+		}
+
+		std::sort(entrances.begin(), entrances.end());
+		entrances.erase(std::unique(entrances.begin(), entrances.end()), entrances.end());
+
+		// Free nodes of tiles which are no longer entrances.
+		for (const int32_t tile : clusterEntrances[cluster])
+		{
+			if (std::binary_search(entrances.begin(), entrances.end(), tile) == false)
+			{
+				const int32_t nodeIndex = nodeOfTiles[tile];
+
+				nodeEdges[nodeIndex].clear();
+				freeNodes.push_back(nodeIndex);
+				nodeOfTiles[tile] = InvalidIndex;
+			}
+		}
+
+		for (const int32_t tile : entrances)
+		{
+			if (nodeOfTiles[tile] != InvalidIndex)
+			{
+				continue;
+			}
+
+			if (freeNodes.empty())
+			{
+				nodeOfTiles[tile] = static_cast<int32_t>(nodeEdges.size());
+				nodeEdges.emplace_back();
+			}
+			else
+			{
+				nodeOfTiles[tile] = freeNodes.back();
+				freeNodes.pop_back();
+			}
+		}
+
+		clusterEntrances[cluster] = std::move(entrances);
+	}
+
+	void ClusterGraph::RebuildEdges(int32_t cluster)
+	{
+		const std::vector<int32_t>& entrances = clusterEntrances[cluster];
+
+		// Cheapest paths inside the cluster.
+		for (const int32_t tile : entrances)
+		{
+			std::vector<Edge>& edges = nodeEdges[nodeOfTiles[tile]];
+			edges.clear();
+
+			SearchCluster(tile, cluster, false, InvalidIndex);
+
+			for (const int32_t otherTile : entrances)
+			{
+				const int32_t localNodeIndex = localPool.Find(otherTile);
+
+				if (otherTile != tile && localNodeIndex != InvalidIndex && localPool.costs[localNodeIndex] != INT32_MAX)
+				{
+					edges.push_back({ otherTile, localPool.costs[localNodeIndex] });
+				}
+			}
+		}
+
+		// Steps over the borders.
+		GetNeighborClusters(cluster, neighborClusters);
+
+		for (const int32_t otherCluster : neighborClusters)
+		{
+			GetTransitions(cluster, otherCluster, transitions);
+
+			for (const Transition& transition : transitions)
+			{
+				const int32_t fromTile = cluster < otherCluster ? transition.firstTile : transition.secondTile;
+				const int32_t toTile = cluster < otherCluster ? transition.secondTile : transition.firstTile;
+
+				const TileLinks& fromLinks = Adjacency->GetLinks(fromTile);
+
+				for (int i = 0; i < fromLinks.neighborCount; ++i)
+				{
+					if (fromLinks.neighbors[i] == toTile && CanStep(fromTile, i))
+					{
+						nodeEdges[nodeOfTiles[fromTile]].push_back({ toTile, fromLinks.costs[i] });
+					}
+				}
+			}
+		}
+	}
+
+	void ClusterGraph::GetTransitions(int32_t cluster, int32_t otherCluster, std::vector<Transition>& OutTransitions) const
+	{
+		OutTransitions.clear();
+
+		const int32_t firstCluster = std::min(cluster, otherCluster);
+		const int32_t secondCluster = std::max(cluster, otherCluster);
+
+		struct Crossing
+		{
+			Transition transition;
+			// Bit 0 for the step into the second cluster, bit 1 for the step back.
+			uint8_t directions;
+		};
+
+		// Crossable step pairs in row order of the first cluster.
+		std::vector<Crossing> crossings;
+
+		for (const int32_t tile : clusterTiles[firstCluster])
+		{
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				if (clusterOfTiles[tileLinks.neighbors[i]] != secondCluster)
+				{
+					continue;
+				}
+
+				const uint8_t directions = (CanStep(tile, i) ? 1 : 0) | (CanStepBack(tile, i) ? 2 : 0);
+
+				if (directions != 0)
+				{
+					crossings.push_back({ { tile, tileLinks.neighbors[i] }, directions });
+				}
+			}
+		}
+
+		// Split into runs a unit can walk along on both sides, so one crossing of a run stands for all of it.
+		size_t runBegin = 0;
+
+		for (size_t i = 1; i <= crossings.size(); ++i)
+		{
+			if (i < crossings.size())
+			{
+				const Crossing& crossing = crossings[i];
+				const Crossing& prevCrossing = crossings[i - 1];
+
+				if (crossing.directions == prevCrossing.directions
+					&& CanStepBothWays(crossing.transition.firstTile, prevCrossing.transition.firstTile)
+					&& CanStepBothWays(crossing.transition.secondTile, prevCrossing.transition.secondTile))
+				{
+					continue;
+				}
+			}
+
+			const size_t runLength = i - runBegin;
+
+			OutTransitions.push_back(crossings[runBegin + runLength / 2].transition);
+
+			if (runLength >= static_cast<size_t>(LongRunLength))
+			{
+				OutTransitions.push_back(crossings[runBegin].transition);
+				OutTransitions.push_back(crossings[i - 1].transition);
+			}
+
+			runBegin = i;
+		}
+	}
+
+	void ClusterGraph::GetNeighborClusters(int32_t cluster, std::vector<int32_t>& OutClusters) const
+	{
+		OutClusters.clear();
+
+		for (const int32_t tile : clusterTiles[cluster])
+		{
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				const int32_t neighborCluster = clusterOfTiles[tileLinks.neighbors[i]];
+
+				if (neighborCluster != cluster && std::find(OutClusters.begin(), OutClusters.end(), neighborCluster) == OutClusters.end())
+				{
+					OutClusters.push_back(neighborCluster);
+				}
+			}
+		}
+	}
+
+	bool ClusterGraph::CanStep(int32_t tile, int slot) const
+	{
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		return CanLeave(tile)
+			&& (*nodeBlockTest)(tilePool, tile, tileLinks.neighbors[slot], tileLinks.IsPassable(slot));
+	}
+
+	bool ClusterGraph::CanStepBack(int32_t tile, int slot) const
+	{
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+		const int32_t neighborTile = tileLinks.neighbors[slot];
+
+		return CanLeave(neighborTile)
+			&& (*nodeBlockTest)(tilePool, neighborTile, tile, tileLinks.IsReversePassable(slot));
+	}
+
+	bool ClusterGraph::CanStepBothWays(int32_t tile, int32_t otherTile) const
+	{
+		if (tile == otherTile)
+		{
+			return true;
+		}
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			if (tileLinks.neighbors[i] == otherTile)
+			{
+				return CanStep(tile, i) && CanStepBack(tile, i);
+			}
+		}
+
+		return false;
+	}
+
+	void ClusterGraph::SearchCluster(int32_t origin, int32_t cluster, bool bBackwards, int32_t target)
+	{
+		// Reset all containers.
+		localPool.Reset();
+		localList.Reset();
+
+		const int32_t originNodeIndex = localPool.Add(origin);
+		localPool.costs[originNodeIndex] = 0;
+
+		localList.Push(originNodeIndex);
+
+		while (localList.Num() > 0)
+		{
+			const int32_t currNodeIndex = localList.PopIndex();
+			localPool.SetClosed(currNodeIndex, true);
+
+			const int32_t currTile = localPool.tiles[currNodeIndex];
+			const int32_t currCost = localPool.costs[currNodeIndex];
+
+			++stats.nodesExpanded;
+
+			if (currTile == target)
+			{
+				return;
+			}
+
+			// Going forwards, the path leaves this tile.
+			if (bBackwards == false && CanLeave(currTile) == false)
+			{
+				continue;
+			}
+
+			// Grab neighbors to expand.
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			// Check neighbors inside the cluster.
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = currLinks.neighbors[i];
+
+				if (clusterOfTiles[neighborTile] != cluster)
+				{
+					continue;
+				}
+
+				// Going backwards, the path leaves the neighbor.
+				if (bBackwards && CanLeave(neighborTile) == false)
+				{
+					continue;
+				}
+
+				const int32_t neighborNodeIndex = localPool.FindOrAdd(neighborTile);
+
+				const bool bAllowed = bBackwards
+					? (*nodeBlockTest)(localPool, neighborNodeIndex, currNodeIndex, currLinks.IsReversePassable(i))
+					: (*nodeBlockTest)(localPool, currNodeIndex, neighborNodeIndex, currLinks.IsPassable(i));
+
+				if (bAllowed == false)
+				{
+					// Blocked.
+					continue;
+				}
+
+				const int32_t newCost = currCost + (bBackwards ? currLinks.reverseCosts[i] : currLinks.costs[i]);
+
+				// If this is not better than previous approach,
+				if (newCost >= localPool.costs[neighborNodeIndex])
+				{
+					// skip.
+					continue;
+				}
+
+				// Fill in.
+				localPool.costs[neighborNodeIndex] = newCost;
+				assert(newCost > 0);
+				localPool.parents[neighborNodeIndex] = currNodeIndex;
+
+				// If this node is not in the open list,
+				if (localPool.IsOpened(neighborNodeIndex) == false)
+				{
+					// add to the open list.
+					localList.Push(neighborNodeIndex);
+				}
+				else
+				{
+					// otherwise move it up to its new place.
+					localList.Update(neighborNodeIndex);
+				}
+			}
+		}
+	}
+
+	void ClusterGraph::RelaxAbstract(int32_t fromNode, int32_t tile, int32_t stepCost, int32_t destination)
+	{
+		const int32_t nodeIndex = abstractPool.FindOrAdd(tile);
+
+		// Abstract steps cost at least their tile distance, so the heuristic stays consistent.
+		if (abstractPool.IsClosed(nodeIndex))
+		{
+			// skip.
+			return;
+		}
+
+		const int32_t newCost = abstractPool.costs[fromNode] + stepCost;
+		const int32_t oldCost = abstractPool.costs[nodeIndex];
+
+		// If this is not better than previous approach,
+		if (newCost >= oldCost)
+		{
+			// skip.
+			return;
+		}
+
+		const bool bIsOpened = abstractPool.IsOpened(nodeIndex);
+		const int32_t heuristic = bIsOpened ? abstractPool.totalCosts[nodeIndex] - oldCost : Adjacency->Distance(tile, destination);
+
+		// Fill in.
+		abstractPool.costs[nodeIndex] = newCost;
+		abstractPool.totalCosts[nodeIndex] = newCost + heuristic;
+		abstractPool.parents[nodeIndex] = fromNode;
+
+		// If this node is not in the open list,
+		if (bIsOpened == false)
+		{
+			// add to the open list.
+			abstractList.Push(nodeIndex);
+		}
+		else
+		{
+			// otherwise move it up to its new place.
+			abstractList.Update(nodeIndex);
+		}
+	}
+
+	void HierarchicalSearch::Initialize(const AdjacencyTable* InAdjacency, int32_t InGridWidth, int32_t InClusterSize)
+	{
+		Adjacency = InAdjacency;
+		gridWidth = InGridWidth;
+		clusterSize = InClusterSize;
+
+		// Graphs are built for the grid.
+		graphs.clear();
+		lastGraph = nullptr;
+	}
+
+	bool HierarchicalSearch::FindPath(const PathRequest& request, std::vector<int32_t>& OutPath)
+	{
+		lastGraph = nullptr;
+
+		// Check destination tile type.
+		if (request.destinationColor != ElementMask::Any && (Adjacency->GetLinks(request.destination).color & request.destinationColor) == 0)
+		{
+			OutPath.clear();
+			return false;
+		}
+
+		ClusterGraph* graph = nullptr;
+
+		for (const std::unique_ptr<ClusterGraph>& candidate : graphs)
+		{
+			if (candidate->Matches(request.pathColor, request.nodeBlockTest))
+			{
+				graph = candidate.get();
+				break;
+			}
+		}
+
+		if (graph == nullptr)
+		{
+			graphs.emplace_back(new ClusterGraph());
+			graph = graphs.back().get();
+			graph->Build(Adjacency, gridWidth, clusterSize, request.pathColor, request.nodeBlockTest);
+		}
+
+		lastGraph = graph;
+		return graph->FindPath(request.start, request.destination, OutPath);
+	}
+
+	void HierarchicalSearch::NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles)
+	{
+		for (const std::unique_ptr<ClusterGraph>& graph : graphs)
+		{
+			graph->RebuildTiles(ChangedTiles);
+		}
+	}
+}
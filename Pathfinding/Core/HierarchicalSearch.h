@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "AStarSearch.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Abstract graph over square clusters of tiles, for hierarchical path search (HPA*).
+	 *
+	 *		  Where a run of tiles along the border of two clusters can be crossed, the middle of the run
+	 *		  and both ends of a long run become entrances. Entrances of a cluster are linked by the cost
+	 *		  of the cheapest path inside it, so a query searches entrances instead of tiles
+	 *		  and then refines each abstract step by a search inside a single cluster.
+	 *		  Paths only cross clusters at entrances, so they can be a little longer than the shortest.
+	 *
+	 *		  Which steps can be taken depends on the element, so a graph holds for one path color and tester.
+	 *		  Tiles must be laid out in rows of the given width, like HexMap and FHexGridView.
+	 */
+	class ClusterGraph
+	{
+	public:
+		void Build(const AdjacencyTable* InAdjacency, int32_t InGridWidth, int32_t InClusterSize, uint8_t InPathColor, NodeBlockTest InNodeBlockTest);
+
+		// Rebuild clusters of the tiles and the clusters around them, after the adjacency was rebuilt for the tiles.
+		void RebuildTiles(const std::vector<int32_t>& Tiles);
+
+		// Same output as AStarSearch::FindPath, with the path color and tester of the graph.
+		bool FindPath(int32_t start, int32_t destination, std::vector<int32_t>& OutPath);
+
+		bool Matches(uint8_t InPathColor, NodeBlockTest InNodeBlockTest) const { return pathColor == InPathColor && nodeBlockTest == InNodeBlockTest; }
+
+		int32_t GetEntranceCount() const { return static_cast<int32_t>(nodeEdges.size() - freeNodes.size()); }
+
+		// Counters of the last query, tiles and entrances together.
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = localPool.GetNodeBytes() + abstractPool.GetNodeBytes();
+			return result;
+		}
+
+		// A run of crossable border tiles at least this long gets entrances at both ends too.
+		static constexpr int32_t LongRunLength = 6;
+
+	private:
+		// Step of the abstract graph.
+		struct Edge
+		{
+			int32_t tile;
+			int32_t cost;
+		};
+
+		// Crossable step pair along a border, firstTile in the lower cluster.
+		struct Transition
+		{
+			int32_t firstTile;
+			int32_t secondTile;
+		};
+
+		void RebuildEntrances(int32_t cluster);
+		void RebuildEdges(int32_t cluster);
+
+		// Same result whichever side asks, so both clusters agree on their entrances.
+		void GetTransitions(int32_t cluster, int32_t otherCluster, std::vector<Transition>& OutTransitions) const;
+		void GetNeighborClusters(int32_t cluster, std::vector<int32_t>& OutClusters) const;
+
+		bool CanLeave(int32_t tile) const { return (tilePool.colors[tile] & pathColor) != 0; }
+		bool CanStep(int32_t tile, int slot) const;
+		bool CanStepBack(int32_t tile, int slot) const;
+		// True for the same tile as well.
+		bool CanStepBothWays(int32_t tile, int32_t otherTile) const;
+
+		/*!
+		 * \brief Dijkstra inside the cluster, results in localPool.
+		 *
+		 * \param bBackwards
+		 *		  Find costs from the tiles of the cluster to the origin instead of from the origin.
+		 *
+		 * \param target
+		 *		  Stop once it is settled. InvalidIndex to search the whole cluster.
+		 */
+		void SearchCluster(int32_t origin, int32_t cluster, bool bBackwards, int32_t target);
+
+		// Relax the abstract step from the node, for the A* over entrances.
+		void RelaxAbstract(int32_t fromNode, int32_t tile, int32_t stepCost, int32_t destination);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		uint8_t pathColor = ElementMask::Any;
+		NodeBlockTest nodeBlockTest = &NodeTester::Test_None;
+
+		int32_t gridWidth = 0;
+		int32_t clusterSize = 0;
+		int32_t clustersPerRow = 0;
+
+		std::vector<int32_t> clusterOfTiles;
+		std::vector<std::vector<int32_t>> clusterTiles;
+		std::vector<std::vector<int32_t>> clusterEntrances;
+
+		// Abstract nodes, one per entrance tile. Indices are reused through freeNodes.
+		std::vector<int32_t> nodeOfTiles;
+		std::vector<std::vector<Edge>> nodeEdges;
+		std::vector<int32_t> freeNodes;
+
+		// Every tile, node index is tile index, for testers outside of searches.
+		NodePool tilePool;
+
+		NodePool localPool;
+		NodeSorter localSorter = NodeSorter(localPool);
+		OpenList localList = OpenList(localPool, localSorter);
+
+		NodePool abstractPool;
+		NodeSorter abstractSorter = NodeSorter(abstractPool, NodeSortKey::TotalCost);
+		OpenList abstractList = OpenList(abstractPool, abstractSorter);
+
+		// Scratch buffers of queries and rebuilds.
+		std::vector<Edge> startEdges;
+		std::vector<Edge> destinationEdges;
+		std::vector<int32_t> abstractPath;
+		std::vector<Transition> transitions;
+		std::vector<int32_t> neighborClusters;
+	};
+
+	/*!
+	 * \brief Hierarchical path queries for any rules, with a ClusterGraph built per path color and tester on first use.
+	 */
+	class HierarchicalSearch
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency, int32_t InGridWidth, int32_t InClusterSize = DefaultClusterSize);
+
+		// Same rules and output as AStarSearch::FindPath, but the path may be a little longer than the shortest.
+		bool FindPath(const PathRequest& request, std::vector<int32_t>& OutPath);
+
+		// Call after the adjacency was rebuilt for the given tiles.
+		void NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles);
+
+		// Counters of the last query.
+		SearchStats GetStats() const { return lastGraph != nullptr ? lastGraph->GetStats() : SearchStats(); }
+
+		static constexpr int32_t DefaultClusterSize = 16;
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		int32_t gridWidth = 0;
+		int32_t clusterSize = DefaultClusterSize;
+
+		std::vector<std::unique_ptr<ClusterGraph>> graphs;
+		const ClusterGraph* lastGraph = nullptr;
+	};
+}
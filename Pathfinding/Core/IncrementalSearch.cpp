@@ -0,0 +1,375 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IncrementalSearch.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AkPathfinding
+{
+	void IncrementalSearch::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+		nodePool.Initialize(Adjacency);
+		bStarted = false;
+	}
+
+	bool IncrementalSearch::FindPath(const PathRequest& InRequest, std::vector<int32_t>& OutPath)
+	{
+		stats.Reset();
+		OutPath.clear();
+
+		// Check destination tile type.
+		if (InRequest.destinationColor != ElementMask::Any && (Adjacency->GetLinks(InRequest.destination).color & InRequest.destinationColor) == 0)
+		{
+			return false;
+		}
+
+		// Already there.
+		if (InRequest.start == InRequest.destination)
+		{
+			return true;
+		}
+
+		if (bStarted == false
+			|| InRequest.destination != request.destination
+			|| InRequest.pathColor != request.pathColor
+			|| InRequest.nodeBlockTest != request.nodeBlockTest)
+		{
+			StartOver(InRequest);
+		}
+		else if (InRequest.start != lastStart)
+		{
+			// Queued keys were computed from the old start, which was at most this much closer to them.
+			keyModifier += Adjacency->Distance(lastStart, InRequest.start);
+			lastStart = InRequest.start;
+		}
+
+		request.start = InRequest.start;
+
+		ComputeShortestPath();
+
+		if (rhs[request.start] == INT32_MAX)
+		{
+			// No path found.
+			return false;
+		}
+
+		// Walk down the costs. A path never visits a tile twice.
+		const size_t maxLength = rhs.size();
+
+		for (int32_t tile = request.start; tile != request.destination; )
+		{
+			tile = GetNextTile(tile);
+
+			if (tile == InvalidIndex || OutPath.size() == maxLength)
+			{
+				OutPath.clear();
+				return false;
+			}
+
+			OutPath.push_back(tile);
+		}
+
+		// From the destination back to the start, like AStarSearch.
+		std::reverse(OutPath.begin(), OutPath.end());
+		return true;
+	}
+
+	void IncrementalSearch::NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles)
+	{
+		if (bStarted == false)
+		{
+			return;
+		}
+
+		for (const int32_t tile : ChangedTiles)
+		{
+			nodePool.RefreshTileData(tile);
+		}
+
+		// Steps from the tiles and into them changed.
+		for (const int32_t tile : ChangedTiles)
+		{
+			UpdateTile(tile);
+
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				UpdateTile(tileLinks.neighbors[i]);
+			}
+		}
+	}
+
+	void IncrementalSearch::StartOver(const PathRequest& InRequest)
+	{
+		request = InRequest;
+		bStarted = true;
+
+		lastStart = request.start;
+		keyModifier = 0;
+
+		// Reset all containers.
+		nodePool.Reset();
+		heap.clear();
+
+		const int32_t tileCount = Adjacency->GetTileCount();
+
+		// Add every tile in order, so node index is tile index.
+		for (int32_t tile = 0; tile < tileCount; ++tile)
+		{
+			nodePool.Add(tile);
+		}
+
+		rhs.assign(tileCount, INT32_MAX);
+		keys.assign(tileCount, Key());
+
+		// Push destination node and kick off the search.
+		rhs[request.destination] = 0;
+		keys[request.destination] = CalculateKey(request.destination);
+		Push(request.destination);
+	}
+
+	void IncrementalSearch::ComputeShortestPath()
+	{
+		const int32_t start = request.start;
+
+		while (heap.empty() == false)
+		{
+			const int32_t currTile = heap.front();
+			const Key oldKey = keys[currTile];
+
+			// The start has its shortest cost once nothing queued can lower it.
+			if ((oldKey < CalculateKey(start)) == false && rhs[start] <= nodePool.costs[start])
+			{
+				return;
+			}
+
+			++stats.nodesExpanded;
+
+			const Key newKey = CalculateKey(currTile);
+
+			// Queued before the start moved, so look at it again when its turn really comes.
+			if (oldKey < newKey)
+			{
+				keys[currTile] = newKey;
+				Update(currTile);
+				continue;
+			}
+
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			if (nodePool.costs[currTile] > rhs[currTile])
+			{
+				// Got cheaper, settle it.
+				nodePool.costs[currTile] = rhs[currTile];
+				Remove(currTile);
+			}
+			else
+			{
+				// Got more expensive, so it and every tile stepping into it have to look around again.
+				nodePool.costs[currTile] = INT32_MAX;
+				UpdateTile(currTile);
+			}
+
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				UpdateTile(currLinks.neighbors[i]);
+			}
+		}
+	}
+
+	void IncrementalSearch::UpdateTile(int32_t tile)
+	{
+		if (tile != request.destination)
+		{
+			rhs[tile] = GetLookaheadCost(tile);
+		}
+
+		if (nodePool.costs[tile] != rhs[tile])
+		{
+			keys[tile] = CalculateKey(tile);
+
+			if (IsQueued(tile))
+			{
+				Update(tile);
+			}
+			else
+			{
+				Push(tile);
+			}
+		}
+		else if (IsQueued(tile))
+		{
+			Remove(tile);
+		}
+	}
+
+	int32_t IncrementalSearch::GetLookaheadCost(int32_t tile) const
+	{
+		// The path leaves the tile, so it must have the path color.
+		if (CanLeave(tile) == false)
+		{
+			return INT32_MAX;
+		}
+
+		int32_t minCost = INT32_MAX;
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = tileLinks.neighbors[i];
+			const int32_t neighborCost = nodePool.costs[neighborTile];
+
+			if (neighborCost == INT32_MAX)
+			{
+				continue;
+			}
+
+			if ((*request.nodeBlockTest)(nodePool, tile, neighborTile, tileLinks.IsPassable(i)) == false)
+			{
+				// Blocked.
+				continue;
+			}
+
+			minCost = std::min(minCost, neighborCost + tileLinks.costs[i]);
+		}
+
+		return minCost;
+	}
+
+	IncrementalSearch::Key IncrementalSearch::CalculateKey(int32_t tile) const
+	{
+		const int32_t cost = std::min(nodePool.costs[tile], rhs[tile]);
+
+		if (cost == INT32_MAX)
+		{
+			return Key();
+		}
+
+		Key key;
+		key.primary = cost + Adjacency->Distance(request.start, tile) + keyModifier;
+		key.secondary = cost;
+		return key;
+	}
+
+	int32_t IncrementalSearch::GetNextTile(int32_t tile) const
+	{
+		int32_t nextTile = InvalidIndex;
+		int32_t minCost = INT32_MAX;
+
+		const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+		for (int i = 0; i < tileLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = tileLinks.neighbors[i];
+			const int32_t neighborCost = nodePool.costs[neighborTile];
+
+			if (neighborCost == INT32_MAX || (*request.nodeBlockTest)(nodePool, tile, neighborTile, tileLinks.IsPassable(i)) == false)
+			{
+				continue;
+			}
+
+			if (neighborCost + tileLinks.costs[i] < minCost)
+			{
+				nextTile = neighborTile;
+				minCost = neighborCost + tileLinks.costs[i];
+			}
+		}
+
+		return nextTile;
+	}
+
+	void IncrementalSearch::Push(int32_t tile)
+	{
+		heap.push_back(tile);
+		SiftUp(static_cast<int32_t>(heap.size()) - 1);
+	}
+
+	void IncrementalSearch::Remove(int32_t tile)
+	{
+		const int32_t heapIndex = nodePool.heapIndices[tile];
+		assert(heapIndex != InvalidIndex);
+
+		const int32_t lastTile = heap.back();
+		heap.pop_back();
+		nodePool.heapIndices[tile] = InvalidIndex;
+
+		if (lastTile != tile)
+		{
+			heap[heapIndex] = lastTile;
+			nodePool.heapIndices[lastTile] = heapIndex;
+			Update(lastTile);
+		}
+	}
+
+	void IncrementalSearch::Update(int32_t tile)
+	{
+		// The key may have gone either way.
+		SiftUp(nodePool.heapIndices[tile]);
+		SiftDown(nodePool.heapIndices[tile]);
+	}
+
+	void IncrementalSearch::SiftUp(int32_t heapIndex)
+	{
+		const int32_t tile = heap[heapIndex];
+
+		while (heapIndex > 0)
+		{
+			const int32_t parentHeapIndex = (heapIndex - 1) / 2;
+			const int32_t parentTile = heap[parentHeapIndex];
+
+			if ((keys[tile] < keys[parentTile]) == false)
+			{
+				break;
+			}
+
+			// Move the parent down.
+			heap[heapIndex] = parentTile;
+			nodePool.heapIndices[parentTile] = heapIndex;
+			heapIndex = parentHeapIndex;
+		}
+
+		heap[heapIndex] = tile;
+		nodePool.heapIndices[tile] = heapIndex;
+	}
+
+	void IncrementalSearch::SiftDown(int32_t heapIndex)
+	{
+		const int32_t tile = heap[heapIndex];
+		const int32_t heapNum = static_cast<int32_t>(heap.size());
+
+		while (true)
+		{
+			int32_t childHeapIndex = heapIndex * 2 + 1;
+
+			if (childHeapIndex >= heapNum)
+			{
+				break;
+			}
+
+			// Pick the better child.
+			if (childHeapIndex + 1 < heapNum && keys[heap[childHeapIndex + 1]] < keys[heap[childHeapIndex]])
+			{
+				++childHeapIndex;
+			}
+
+			const int32_t childTile = heap[childHeapIndex];
+
+			if ((keys[childTile] < keys[tile]) == false)
+			{
+				break;
+			}
+
+			// Move the child up.
+			heap[heapIndex] = childTile;
+			nodePool.heapIndices[childTile] = heapIndex;
+			heapIndex = childHeapIndex;
+		}
+
+		heap[heapIndex] = tile;
+		nodePool.heapIndices[tile] = heapIndex;
+	}
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "AStarSearch.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Path search which keeps its tree between queries to the same destination (D* Lite).
+	 *
+	 *		  The search runs backwards from the destination, so the start may move
+	 *		  and tiles may change between queries. A query then only searches again
+	 *		  the tiles whose cost to the destination the change affects.
+	 *		  A query with another destination or other rules starts over.
+	 *
+	 *		  Nodes cover the whole grid and node index is tile index.
+	 */
+	class IncrementalSearch
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		// Same rules and output as AStarSearch::FindPath.
+		bool FindPath(const PathRequest& request, std::vector<int32_t>& OutPath);
+
+		// Call after the adjacency was rebuilt for the given tiles. The next query searches what they affect.
+		void NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles);
+
+		// Forget the tree, so the next query starts over.
+		void Reset() { bStarted = false; }
+
+		// Counters of the last query.
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = nodePool.GetNodeBytes() + static_cast<int64_t>(rhs.size()) * (sizeof(int32_t) + sizeof(Key));
+			return result;
+		}
+
+	private:
+		// Compared by primary, then secondary.
+		struct Key
+		{
+			int32_t primary = INT32_MAX;
+			int32_t secondary = INT32_MAX;
+
+			bool operator<(const Key& other) const
+			{
+				return primary < other.primary || (primary == other.primary && secondary < other.secondary);
+			}
+		};
+
+		void StartOver(const PathRequest& request);
+		void ComputeShortestPath();
+
+		// Recompute the cost of the tile from its steps and queue it if the cost it has doesn't match.
+		void UpdateTile(int32_t tile);
+		int32_t GetLookaheadCost(int32_t tile) const;
+		Key CalculateKey(int32_t tile) const;
+
+		// Tile of the cheapest step on to the destination, InvalidIndex if none.
+		int32_t GetNextTile(int32_t tile) const;
+
+		bool CanLeave(int32_t tile) const { return tile != request.destination && (nodePool.colors[tile] & request.pathColor) != 0; }
+
+		bool IsQueued(int32_t tile) const { return nodePool.heapIndices[tile] != InvalidIndex; }
+		void Push(int32_t tile);
+		void Remove(int32_t tile);
+		void Update(int32_t tile);
+		void SiftUp(int32_t heapIndex);
+		void SiftDown(int32_t heapIndex);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		// Destination and rules of the tree.
+		PathRequest request;
+		bool bStarted = false;
+
+		// Start of the last query, and the heuristic drop of all queued keys since the tree started.
+		int32_t lastStart = InvalidIndex;
+		int32_t keyModifier = 0;
+
+		// Costs are the settled costs to the destination.
+		NodePool nodePool;
+
+		// One step lookahead of the costs.
+		std::vector<int32_t> rhs;
+		std::vector<Key> keys;
+		std::vector<int32_t> heap;
+	};
+}
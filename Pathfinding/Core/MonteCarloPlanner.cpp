@@ -0,0 +1,579 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MonteCarloPlanner.h"
+
+#include <cmath>
+#include <unordered_map>
+
+namespace AkPathfinding
+{
+	void MonteCarloPlanner::Initialize(const IPathGrid* InGrid, const GridSnapshot& Tiles, int32_t workerCount)
+	{
+		Grid = InGrid;
+		tiles = Tiles;
+		rootUnitTiles.clear();
+		workers.clear();
+
+		blocked.resize(Tiles.GetTileCount());
+
+		for (int32_t tile = 0; tile < Tiles.GetTileCount(); ++tile)
+		{
+			blocked[tile] = Grid->IsBlocked(tile);
+		}
+
+		for (int32_t i = 0; i < std::max(workerCount, 1); ++i)
+		{
+			std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+			worker->grid.Initialize(InGrid, Tiles);
+			worker->range.Initialize(&worker->grid.GetAdjacency());
+			worker->planner.Initialize(&worker->grid.GetAdjacency());
+			worker->random.seed(static_cast<uint32_t>(i) + 1);
+
+			workers.push_back(std::move(worker));
+		}
+	}
+
+	void MonteCarloPlanner::SetTiles(const GridSnapshot& Tiles)
+	{
+		tiles = Tiles;
+
+		for (const std::unique_ptr<Worker>& worker : workers)
+		{
+			// The snapshot undoes the edits of the last state.
+			worker->grid.SetSnapshot(Tiles);
+			worker->appliedEdits.clear();
+		}
+
+		for (int32_t tile = 0; tile < Tiles.GetTileCount(); ++tile)
+		{
+			const bool bBlocked = Grid->IsBlocked(tile);
+
+			// skip.
+			if ((blocked[tile] != 0) == bBlocked)
+			{
+				continue;
+			}
+
+			blocked[tile] = bBlocked;
+
+			for (const std::unique_ptr<Worker>& worker : workers)
+			{
+				worker->grid.SetBlocked(tile, bBlocked);
+			}
+		}
+
+		for (const std::unique_ptr<Worker>& worker : workers)
+		{
+			worker->grid.RebuildEditedTiles();
+		}
+	}
+
+	void MonteCarloPlanner::PlayTurn(const GameRules& Rules, GameState& State, int32_t moveTile, std::vector<PlanStep>& OutPlan)
+	{
+		PlayTurn(Rules, State, moveTile, *workers[0], OutPlan);
+	}
+
+	void MonteCarloPlanner::GetMoves(const GameRules& Rules, const GameState& State, std::vector<int32_t>& OutMoves)
+	{
+		GetMoves(Rules, State, *workers[0], OutMoves);
+	}
+
+	float MonteCarloPlanner::Evaluate(const GameRules& Rules, const GameState& State, uint8_t team)
+	{
+		if (State.winner != InvalidIndex)
+		{
+			return State.winner == team ? 1.f : 0.f;
+		}
+
+		// Tiles each team still has to go to score.
+		int32_t distances[TeamCount];
+
+		for (uint8_t scoringTeam = 0; scoringTeam < TeamCount; ++scoringTeam)
+		{
+			const GameFlag& flag = State.flags[scoringTeam ^ 1];
+
+			if (flag.carrier != InvalidIndex)
+			{
+				distances[scoringTeam] = Rules.adjacency->Distance(flag.tile, GetNearestEndZone(Rules, scoringTeam, flag.tile));
+				continue;
+			}
+
+			// Farther than any tile if the team has no units left.
+			int32_t toFlag = Rules.adjacency->GetTileCount();
+
+			for (const GameUnit& unit : State.units)
+			{
+				if (unit.team == scoringTeam)
+				{
+					toFlag = std::min(toFlag, Rules.adjacency->Distance(unit.tile, flag.tile));
+				}
+			}
+
+			distances[scoringTeam] = toFlag + Rules.adjacency->Distance(flag.tile, GetNearestEndZone(Rules, scoringTeam, flag.tile));
+		}
+
+		// A turn's move apart is worth about three to one.
+		const float lead = static_cast<float>(distances[team ^ 1] - distances[team]) / static_cast<float>(std::max(Rules.moveDistance, 1));
+		return 1.f / (1.f + std::exp(-lead));
+	}
+
+	int32_t MonteCarloPlanner::GetObjective(const GameRules& Rules, const GameState& State, int32_t unit)
+	{
+		const GameUnit& Unit = State.units[unit];
+		const GameFlag& ownFlag = State.flags[Unit.team];
+		const GameFlag& enemyFlag = State.flags[Unit.team ^ 1];
+
+		// The carrier, or its escort.
+		if (enemyFlag.carrier != InvalidIndex)
+		{
+			return GetNearestEndZone(Rules, Unit.team, Unit.tile);
+		}
+
+		if (ownFlag.carrier != InvalidIndex)
+		{
+			return State.units[ownFlag.carrier].tile;
+		}
+
+		// Only the closest unit goes for the flag, so units of other elements don't expand over each other on its tile.
+		// The others go after the enemy closest to the own flag.
+		const int32_t distance = Rules.adjacency->Distance(Unit.tile, enemyFlag.tile);
+
+		for (int32_t other = 0; other < static_cast<int32_t>(State.units.size()); ++other)
+		{
+			const GameUnit& Other = State.units[other];
+			const int32_t otherDistance = Rules.adjacency->Distance(Other.tile, enemyFlag.tile);
+
+			if (Other.team == Unit.team && (otherDistance < distance || (otherDistance == distance && other < unit)))
+			{
+				return GetNearestEnemy(Rules, State, Unit.team, ownFlag.tile);
+			}
+		}
+
+		return enemyFlag.tile;
+	}
+
+	int32_t MonteCarloPlanner::GetNearestEnemy(const GameRules& Rules, const GameState& State, uint8_t team, int32_t tile)
+	{
+		int32_t nearest = tile;
+		int32_t nearestDistance = INT32_MAX;
+
+		for (const GameUnit& unit : State.units)
+		{
+			const int32_t distance = Rules.adjacency->Distance(tile, unit.tile);
+
+			if (unit.team != team && distance < nearestDistance)
+			{
+				nearest = unit.tile;
+				nearestDistance = distance;
+			}
+		}
+
+		return nearest;
+	}
+
+	int32_t MonteCarloPlanner::GetNearestEndZone(const GameRules& Rules, uint8_t team, int32_t tile)
+	{
+		int32_t nearest = tile;
+		int32_t nearestDistance = INT32_MAX;
+
+		for (const int32_t endZone : Rules.endZones[team])
+		{
+			const int32_t distance = Rules.adjacency->Distance(tile, endZone);
+
+			if (distance < nearestDistance)
+			{
+				nearest = endZone;
+				nearestDistance = distance;
+			}
+		}
+
+		return nearest;
+	}
+
+	void MonteCarloPlanner::PlayTurn(const GameRules& Rules, GameState& State, int32_t moveTile, Worker& InWorker, std::vector<PlanStep>& OutPlan) const
+	{
+		const uint8_t team = State.team;
+		const int32_t unitIndex = State.nextUnits[team];
+		GameUnit& unit = State.units[unitIndex];
+		GameFlag& ownFlag = State.flags[team];
+		GameFlag& enemyFlag = State.flags[team ^ 1];
+
+		OutPlan.clear();
+
+		unit.tile = moveTile;
+
+		// The other units block where they stand, the acting one has moved.
+		SetState(State, InWorker);
+
+		if (unit.bHasFlag)
+		{
+			enemyFlag.tile = moveTile;
+		}
+		else if (enemyFlag.carrier == InvalidIndex && enemyFlag.tile == moveTile)
+		{
+			enemyFlag.carrier = unitIndex;
+			unit.bHasFlag = true;
+		}
+
+		// Caught the carrier of the own flag.
+		if (ownFlag.carrier != InvalidIndex && Rules.adjacency->Distance(moveTile, State.units[ownFlag.carrier].tile) <= 1)
+		{
+			State.units[ownFlag.carrier].bHasFlag = false;
+			ownFlag.carrier = InvalidIndex;
+			ownFlag.tile = ownFlag.home;
+		}
+
+		if (unit.bHasFlag && std::find(Rules.endZones[team].begin(), Rules.endZones[team].end(), moveTile) != Rules.endZones[team].end())
+		{
+			State.winner = team;
+		}
+		else
+		{
+			InWorker.planner.settings.maxExpansions = settings.planExpansions;
+			InWorker.planner.Plan(InWorker.grid.GetSnapshot(), moveTile, GetObjective(Rules, State, unitIndex), unit.elementColor, Rules.abilityBudget, OutPlan);
+
+			ApplyPlan(OutPlan, unit.elementColor, InWorker.grid.GetSnapshot(), State);
+		}
+
+		// Next unit of the team, round robin.
+		const int32_t unitCount = static_cast<int32_t>(State.units.size());
+
+		for (int32_t i = 1; i <= unitCount; ++i)
+		{
+			const int32_t next = (unitIndex + i) % unitCount;
+
+			if (State.units[next].team == team)
+			{
+				State.nextUnits[team] = next;
+				break;
+			}
+		}
+
+		State.team = team ^ 1;
+		++State.turn;
+	}
+
+	void MonteCarloPlanner::GetMoves(const GameRules& Rules, const GameState& State, Worker& InWorker, std::vector<int32_t>& OutMoves) const
+	{
+		const int32_t unitIndex = State.nextUnits[State.team];
+		const GameUnit& unit = State.units[unitIndex];
+		const int32_t objective = GetObjective(Rules, State, unitIndex);
+
+		// Only rebuilds tiles the state differs in from the last one.
+		SetState(State, InWorker);
+		InWorker.range.GetMovementRange(unit.tile, Rules.moveDistance, InWorker.rangeTiles, unit.elementColor, false, false, false);
+
+		const GridSnapshot& Tiles = InWorker.grid.GetSnapshot();
+
+		OutMoves.clear();
+
+		for (const int32_t tile : InWorker.rangeTiles)
+		{
+			// skip, guarding the own flag is next to it, not on it.
+			if (tile == unit.tile || tile == State.flags[State.team].tile || (Tiles.GetColor(tile) & unit.elementColor) == 0)
+			{
+				continue;
+			}
+
+			const bool bOccupied = std::any_of(State.units.begin(), State.units.end(), [tile](const GameUnit& other) { return other.tile == tile; });
+
+			if (bOccupied == false)
+			{
+				OutMoves.push_back(tile);
+			}
+		}
+
+		const int32_t keptCount = std::min(static_cast<int32_t>(OutMoves.size()), std::max(settings.maxMoves - 1, 0));
+
+		std::partial_sort(OutMoves.begin(), OutMoves.begin() + keptCount, OutMoves.end(), [&](int32_t lhs, int32_t rhs)
+		{
+			return Rules.adjacency->Distance(lhs, objective) < Rules.adjacency->Distance(rhs, objective);
+		});
+
+		OutMoves.resize(keptCount);
+		OutMoves.push_back(unit.tile);
+	}
+
+	void MonteCarloPlanner::BeginDecision(const GameState& Root)
+	{
+		++decision;
+
+		rootUnitTiles.clear();
+
+		for (const GameUnit& unit : Root.units)
+		{
+			rootUnitTiles.push_back(unit.tile);
+		}
+
+		std::sort(rootUnitTiles.begin(), rootUnitTiles.end());
+
+		for (const std::unique_ptr<Worker>& worker : workers)
+		{
+			worker->tree.clear();
+			worker->iterations = 0;
+
+			// The grid may block the tiles of the units, so let the next state free them where they left.
+			worker->unitTiles.insert(worker->unitTiles.end(), rootUnitTiles.begin(), rootUnitTiles.end());
+			std::sort(worker->unitTiles.begin(), worker->unitTiles.end());
+			worker->unitTiles.erase(std::unique(worker->unitTiles.begin(), worker->unitTiles.end()), worker->unitTiles.end());
+		}
+	}
+
+	void MonteCarloPlanner::SetState(const GameState& State, Worker& InWorker) const
+	{
+		SnapshotGrid& grid = InWorker.grid;
+
+		// Undo the edits the state doesn't have, both lists are in order of tiles.
+		auto edit = State.edits.begin();
+
+		for (const TileEdit& applied : InWorker.appliedEdits)
+		{
+			while (edit != State.edits.end() && edit->tile < applied.tile)
+			{
+				++edit;
+			}
+
+			if (edit == State.edits.end() || edit->tile != applied.tile)
+			{
+				grid.SetTile(applied.tile, tiles.GetHeight(applied.tile), tiles.GetColor(applied.tile));
+			}
+		}
+
+		// Tiles already as the state has them are skipped.
+		for (const TileEdit& stateEdit : State.edits)
+		{
+			grid.SetTile(stateEdit.tile, stateEdit.height, stateEdit.color);
+		}
+
+		InWorker.appliedEdits = State.edits;
+
+		for (const int32_t tile : InWorker.unitTiles)
+		{
+			grid.SetBlocked(tile, IsTerrainBlocked(tile));
+		}
+
+		InWorker.unitTiles.clear();
+		const int32_t actingUnit = State.nextUnits[State.team];
+
+		for (int32_t i = 0; i < static_cast<int32_t>(State.units.size()); ++i)
+		{
+			if (i != actingUnit)
+			{
+				grid.SetBlocked(State.units[i].tile, true);
+				InWorker.unitTiles.push_back(State.units[i].tile);
+			}
+		}
+
+		grid.RebuildEditedTiles();
+	}
+
+	bool MonteCarloPlanner::IsTerrainBlocked(int32_t tile) const
+	{
+		return blocked[tile] != 0 && std::binary_search(rootUnitTiles.begin(), rootUnitTiles.end(), tile) == false;
+	}
+
+	void MonteCarloPlanner::ApplyPlan(const std::vector<PlanStep>& Plan, uint8_t elementColor, const GridSnapshot& Tiles, GameState& State)
+	{
+		for (const PlanStep& step : Plan)
+		{
+			// skip.
+			if (step.action == PlanAction::Walk)
+			{
+				continue;
+			}
+
+			auto edit = std::lower_bound(State.edits.begin(), State.edits.end(), step.tile, [](const TileEdit& lhs, int32_t tile) { return lhs.tile < tile; });
+
+			if (edit == State.edits.end() || edit->tile != step.tile)
+			{
+				edit = State.edits.insert(edit, { step.tile, static_cast<int8_t>(Tiles.GetHeight(step.tile)), Tiles.GetColor(step.tile) });
+			}
+
+			switch (step.action)
+			{
+			case PlanAction::Raise:
+				++edit->height;
+				break;
+
+			case PlanAction::Lower:
+				--edit->height;
+				break;
+
+			case PlanAction::Expand:
+				edit->color = elementColor;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	void MonteCarloPlanner::GrowTree(const GameRules& Rules, const GameState& Root, std::chrono::steady_clock::time_point deadline, Worker& InWorker)
+	{
+		std::vector<TreeNode>& tree = InWorker.tree;
+		InWorker.decision = decision;
+
+		tree.emplace_back();
+		tree[0].state = Root;
+
+		if (Root.winner == InvalidIndex)
+		{
+			GetMoves(Rules, Root, InWorker, InWorker.moves);
+			tree[0].untriedMoves.assign(InWorker.moves.rbegin(), InWorker.moves.rend());
+		}
+
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			int32_t node = 0;
+
+			// Select.
+			while (tree[node].untriedMoves.empty() && tree[node].children.empty() == false)
+			{
+				node = SelectChild(tree, node);
+			}
+
+			// Expand.
+			if (tree[node].untriedMoves.empty() == false && static_cast<int32_t>(tree.size()) < settings.maxTreeNodes)
+			{
+				TreeNode child;
+				child.state = tree[node].state;
+				child.parent = node;
+				child.moveTile = tree[node].untriedMoves.back();
+				tree[node].untriedMoves.pop_back();
+
+				PlayTurn(Rules, child.state, child.moveTile, InWorker, InWorker.plan);
+
+				if (child.state.winner == InvalidIndex)
+				{
+					GetMoves(Rules, child.state, InWorker, InWorker.moves);
+					child.untriedMoves.assign(InWorker.moves.rbegin(), InWorker.moves.rend());
+				}
+
+				const int32_t childIndex = static_cast<int32_t>(tree.size());
+				tree.push_back(std::move(child));
+				tree[node].children.push_back(childIndex);
+				node = childIndex;
+			}
+
+			// Simulate for the team which moved into the node.
+			float value = Rollout(Rules, tree[node].state, tree[node].state.team ^ 1, deadline, InWorker);
+
+			// Back up, turning the value around for the other team at every level.
+			for (; node != InvalidIndex; node = tree[node].parent)
+			{
+				++tree[node].visits;
+				tree[node].valueSum += value;
+				value = 1.f - value;
+			}
+
+			++InWorker.iterations;
+		}
+	}
+
+	float MonteCarloPlanner::Rollout(const GameRules& Rules, GameState State, uint8_t team, std::chrono::steady_clock::time_point deadline, Worker& InWorker) const
+	{
+		std::uniform_real_distribution<float> chance(0.f, 1.f);
+
+		for (int32_t turn = 0; turn < settings.rolloutTurns && State.winner == InvalidIndex; ++turn)
+		{
+			// Score where it got to rather than run over the budget.
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+
+			GetMoves(Rules, State, InWorker, InWorker.moves);
+
+			// Closest to the objective, or now and then any of the moves.
+			int32_t move = 0;
+
+			if (chance(InWorker.random) < settings.rolloutRandomMove)
+			{
+				move = std::uniform_int_distribution<int32_t>(0, static_cast<int32_t>(InWorker.moves.size()) - 1)(InWorker.random);
+			}
+
+			PlayTurn(Rules, State, InWorker.moves[move], InWorker, InWorker.plan);
+		}
+
+		return Evaluate(Rules, State, team);
+	}
+
+	int32_t MonteCarloPlanner::SelectChild(const std::vector<TreeNode>& Tree, int32_t node) const
+	{
+		const float logVisits = std::log(static_cast<float>(std::max(Tree[node].visits, 1)));
+
+		int32_t best = Tree[node].children[0];
+		float bestScore = -1.f;
+
+		for (const int32_t childIndex : Tree[node].children)
+		{
+			const TreeNode& child = Tree[childIndex];
+			const float visits = static_cast<float>(std::max(child.visits, 1));
+			const float score = child.valueSum / visits + settings.exploration * std::sqrt(logVisits / visits);
+
+			if (score > bestScore)
+			{
+				best = childIndex;
+				bestScore = score;
+			}
+		}
+
+		return best;
+	}
+
+	MonteCarloDecision MonteCarloPlanner::PickDecision(const GameRules& Rules, const GameState& Root)
+	{
+		MonteCarloDecision result;
+
+		// Visits and values of the moves of the root, summed over the trees.
+		std::unordered_map<int32_t, std::pair<int32_t, float>> moves;
+
+		for (const std::unique_ptr<Worker>& worker : workers)
+		{
+			// Started after the deadline, so its tree is of an earlier decision if any.
+			if (worker->decision != decision || worker->tree.empty())
+			{
+				continue;
+			}
+
+			result.iterations += worker->iterations;
+
+			for (const int32_t childIndex : worker->tree[0].children)
+			{
+				const TreeNode& child = worker->tree[childIndex];
+				std::pair<int32_t, float>& move = moves[child.moveTile];
+				move.first += child.visits;
+				move.second += child.valueSum;
+			}
+		}
+
+		for (const auto& move : moves)
+		{
+			if (move.second.first > result.visits || (move.second.first == result.visits && move.first < result.moveTile))
+			{
+				result.moveTile = move.first;
+				result.visits = move.second.first;
+				result.value = move.second.second / static_cast<float>(move.second.first);
+			}
+		}
+
+		if (Root.winner != InvalidIndex)
+		{
+			return result;
+		}
+
+		// No time for a single iteration, take the closest move.
+		if (result.moveTile == InvalidIndex)
+		{
+			std::vector<int32_t> fallback;
+			GetMoves(Rules, Root, fallback);
+			result.moveTile = fallback[0];
+		}
+
+		GameState state = Root;
+		PlayTurn(Rules, state, result.moveTile, result.plan);
+
+		return result;
+	}
+}
@@ -0,0 +1,260 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "AbilityPlanner.h"
+#include "GridSnapshot.h"
+#include "PathGrid.h"
+#include "RangeSearch.h"
+
+namespace AkPathfinding
+{
+	constexpr int32_t TeamCount = 2;
+
+	struct GameUnit
+	{
+		int32_t tile = InvalidIndex;
+		uint8_t elementColor = ElementMask::None;
+		uint8_t team = 0;
+		bool bHasFlag = false;
+	};
+
+	struct GameFlag
+	{
+		// Where the flag goes back to when its carrier is caught.
+		int32_t home = InvalidIndex;
+		// Where it lies, or the tile of its carrier.
+		int32_t tile = InvalidIndex;
+		int32_t carrier = InvalidIndex;
+	};
+
+	/*!
+	 * \brief Compact model of a match: tile edits, units and the flag of each team.
+	 *
+	 *		  Teams take turns, one unit each, round robin over the units of the team.
+	 *		  A turn moves the unit within its movement range, then uses shift abilities toward its objective.
+	 *		  A unit stepping onto the enemy flag takes it, units never stand on the flag of their team. A unit ending its move next to the enemy carrier sends the flag home.
+	 *		  A carrier reaching an end zone tile of its team wins.
+	 */
+	struct GameState
+	{
+		// Tiles shift abilities changed since the tiles of the planner, one edit per tile in order of tiles.
+		// A state costs its units and edits, not a copy of the grid.
+		std::vector<TileEdit> edits;
+		std::vector<GameUnit> units;
+		// Flag each team protects.
+		GameFlag flags[TeamCount];
+
+		uint8_t team = 0;
+		// Unit of each team acting on its next turn.
+		int32_t nextUnits[TeamCount] = { InvalidIndex, InvalidIndex };
+
+		int32_t turn = 0;
+		int32_t winner = InvalidIndex;
+	};
+
+	// Parts of the match which never change.
+	struct GameRules
+	{
+		// Hex distances between tiles.
+		const AdjacencyTable* adjacency = nullptr;
+
+		// End zone tiles of each team, where its carrier scores.
+		std::vector<int32_t> endZones[TeamCount];
+
+		int32_t moveDistance = 4;
+		int32_t abilityBudget = 3;
+	};
+
+	struct MonteCarloSettings
+	{
+		// Moves tried from a state, the closest to the objective first.
+		int32_t maxMoves = 6;
+
+		// Turns a rollout plays before the state is scored.
+		int32_t rolloutTurns = 8;
+		// Chance a rollout takes a random move instead of the closest one.
+		float rolloutRandomMove = 0.25f;
+
+		// Expanded states of the shift ability plan of a turn, to bound the time a turn takes.
+		int32_t planExpansions = 256;
+
+		float exploration = 0.7f;
+
+		// Nodes of each tree. Every node keeps a state, whose units and tile edits grow with the turns played since the root.
+		int32_t maxTreeNodes = 4096;
+	};
+
+	struct MonteCarloDecision
+	{
+		int32_t moveTile = InvalidIndex;
+		// Shift abilities after the move.
+		std::vector<PlanStep> plan;
+
+		int64_t iterations = 0;
+		int32_t visits = 0;
+		// Share of the rollouts through the move the acting team won, with unfinished ones scored by progress.
+		float value = 0.f;
+	};
+
+	/*!
+	 * \brief Monte Carlo tree search over the turns of both teams, within a hard time budget.
+	 *
+	 *		  Every worker grows a tree of its own from the same root with UCT, so trees share nothing but the root state,
+	 *		  and their visits are summed per move of the root at the end. Workers are spread with parallelFor(count, body),
+	 *		  which may be WorkerPool::ParallelFor or the engine's ParallelFor; workers which start after the deadline return at once.
+	 *		  States keep their tile edits on top of the tiles set with SetTiles, as AbilityPlanner does.
+	 *		  Every worker switches the SnapshotGrid it owns to the state it simulates, undoing and redoing the edits the states
+	 *		  differ in and blocking the tiles the other units stand on. Moves come from RangeSearch on that grid,
+	 *		  shift abilities from AbilityPlanner. Iterations stop at the deadline, so a decision overruns it by at most a simulated turn.
+	 */
+	class MonteCarloPlanner
+	{
+	public:
+		/*!
+		 * \brief Build the search contexts of every worker, outside the time budget.
+		 *
+		 * \param InGrid
+		 *		  Neighbors, costs and blocking of the tiles. Must outlive the planner.
+		 *
+		 * \param Tiles
+		 *		  Heights and colors of the grid, as for SetTiles.
+		 */
+		void Initialize(const IPathGrid* InGrid, const GridSnapshot& Tiles, int32_t workerCount);
+
+		/*!
+		 * \brief Heights and colors the edits of the states are on top of, and blocked tiles of the grid, read again.
+		 *		  Call between decisions when the grid changed, outside the time budget: only tiles which changed are rebuilt,
+		 *		  but every tile is checked for blocking.
+		 */
+		void SetTiles(const GridSnapshot& Tiles);
+
+		template <typename ParallelForType>
+		MonteCarloDecision Decide(const GameRules& Rules, const GameState& Root, std::chrono::nanoseconds budget, ParallelForType&& parallelFor)
+		{
+			const auto deadline = std::chrono::steady_clock::now() + budget;
+
+			BeginDecision(Root);
+
+			parallelFor(static_cast<int32_t>(workers.size()), [&](int32_t worker)
+			{
+				if (std::chrono::steady_clock::now() < deadline)
+				{
+					GrowTree(Rules, Root, deadline, *workers[worker]);
+				}
+			});
+
+			return PickDecision(Rules, Root);
+		}
+
+		int32_t GetWorkerCount() const { return static_cast<int32_t>(workers.size()); }
+
+		/*!
+		 * \brief Play a turn of the acting unit of the state: move to the tile, then use the shift abilities planned toward its objective.
+		 *		  Runs on the context of the first worker, so not while deciding.
+		 */
+		void PlayTurn(const GameRules& Rules, GameState& State, int32_t moveTile, std::vector<PlanStep>& OutPlan);
+
+		/*!
+		 * \brief Tiles the acting unit may move to, the closest to its objective first, at most maxMoves.
+		 *		  Staying is always one of them. Runs on the context of the first worker, so not while deciding.
+		 */
+		void GetMoves(const GameRules& Rules, const GameState& State, std::vector<int32_t>& OutMoves);
+
+		// Score of the state for the team, 1 if it won, 0 if it lost, by how close each team is to scoring otherwise.
+		static float Evaluate(const GameRules& Rules, const GameState& State, uint8_t team);
+
+		// Tile the unit heads for: an end zone when its team carries, the carrier if the own flag is taken,
+		// the enemy flag for the closest unit of the team, and the enemy closest to the own flag for the others.
+		static int32_t GetObjective(const GameRules& Rules, const GameState& State, int32_t unit);
+
+		MonteCarloSettings settings;
+
+	private:
+		struct TreeNode
+		{
+			GameState state;
+
+			int32_t parent = InvalidIndex;
+			// Move of the parent's acting unit leading here.
+			int32_t moveTile = InvalidIndex;
+
+			std::vector<int32_t> children;
+			// Moves not expanded yet, the best last.
+			std::vector<int32_t> untriedMoves;
+
+			int32_t visits = 0;
+			// For the team which moved into this node.
+			float valueSum = 0.f;
+		};
+
+		struct Worker
+		{
+			SnapshotGrid grid;
+			RangeSearch range;
+			AbilityPlanner planner;
+
+			std::mt19937 random;
+
+			std::vector<TreeNode> tree;
+			int64_t iterations = 0;
+			// Decision the tree was grown for. Workers which started after the deadline keep an older one.
+			uint32_t decision = 0;
+
+			std::vector<int32_t> moves;
+			std::vector<int32_t> rangeTiles;
+			std::vector<PlanStep> plan;
+
+			// Edits and unit tiles the grid is switched to.
+			std::vector<TileEdit> appliedEdits;
+			std::vector<int32_t> unitTiles;
+		};
+
+		// Drop the trees of the last decision, before any worker starts.
+		void BeginDecision(const GameState& Root);
+
+		// Switch the grid of the worker to the tiles of the state, with the units but the acting one blocking their tiles.
+		void SetState(const GameState& State, Worker& InWorker) const;
+		// Blocked in the grid, rather than by a unit of the root.
+		bool IsTerrainBlocked(int32_t tile) const;
+
+		// Apply the abilities of a plan to the edits of the state. The worker's grid must be switched to the state.
+		static void ApplyPlan(const std::vector<PlanStep>& Plan, uint8_t elementColor, const GridSnapshot& Tiles, GameState& State);
+
+		void GrowTree(const GameRules& Rules, const GameState& Root, std::chrono::steady_clock::time_point deadline, Worker& InWorker);
+
+		void PlayTurn(const GameRules& Rules, GameState& State, int32_t moveTile, Worker& InWorker, std::vector<PlanStep>& OutPlan) const;
+		void GetMoves(const GameRules& Rules, const GameState& State, Worker& InWorker, std::vector<int32_t>& OutMoves) const;
+
+		static int32_t GetNearestEndZone(const GameRules& Rules, uint8_t team, int32_t tile);
+		// Tile of the unit of the other team closest to the tile.
+		static int32_t GetNearestEnemy(const GameRules& Rules, const GameState& State, uint8_t team, int32_t tile);
+
+		// Score of the state for the team after playing turns with the rollout policy.
+		float Rollout(const GameRules& Rules, GameState State, uint8_t team, std::chrono::steady_clock::time_point deadline, Worker& InWorker) const;
+
+		// Child of the node with the best UCT score.
+		int32_t SelectChild(const std::vector<TreeNode>& Tree, int32_t node) const;
+
+		// Most visited move of the root over the trees of all workers.
+
+		MonteCarloDecision PickDecision(const GameRules& Rules, const GameState& Root);
+
+	private:
+		const IPathGrid* Grid = nullptr;
+		GridSnapshot tiles;
+		std::vector<uint8_t> blocked;
+		// Tiles of the units of the root, in order. Blocked by them rather than the grid.
+		std::vector<int32_t> rootUnitTiles;
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		uint32_t decision = 0;
+	};
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MoveEvaluation.h"
+
+#include <cstdlib>
+
+namespace AkPathfinding
+{
+	namespace
+	{
+		// Added to candidates which can't reach a goal, so any which can comes first.
+		constexpr int64_t UnreachableScore = int64_t(1) << 40;
+	}
+
+	void MoveEvaluator::Prepare(const MoveSnapshot& snapshot, const DistanceField& Field, const DistanceField& FallbackField, const std::vector<int32_t>& Candidates, int32_t fallbackGoal)
+	{
+		candidates.resize(Candidates.size());
+
+		for (size_t i = 0; i < Candidates.size(); ++i)
+		{
+			MoveCandidate& candidate = candidates[i];
+			candidate = MoveCandidate();
+			candidate.tile = Candidates[i];
+			candidate.field = &Field;
+			candidate.steps = Field.GetDistance(candidate.tile);
+
+			if (candidate.steps == INT32_MAX)
+			{
+				candidate.field = &FallbackField;
+				candidate.steps = FallbackField.GetDistance(candidate.tile);
+			}
+
+			// The steps alone are a lower bound of the full score.
+			if (candidate.steps != INT32_MAX)
+			{
+				candidate.score = static_cast<int64_t>(settings.stepWeight) * candidate.steps;
+			}
+			else
+			{
+				candidate.score = UnreachableScore + static_cast<int64_t>(settings.stepWeight) * snapshot.adjacency->Distance(candidate.tile, fallbackGoal);
+			}
+		}
+
+		std::stable_sort(candidates.begin(), candidates.end(), [](const MoveCandidate& lhs, const MoveCandidate& rhs) { return lhs.score < rhs.score; });
+	}
+
+	void MoveEvaluator::Score(const MoveSnapshot& snapshot, uint8_t elementColor, const std::vector<int32_t>& Threats, int32_t guardTile, MoveCandidate& OutCandidate) const
+	{
+		const AdjacencyTable& Adjacency = *snapshot.adjacency;
+		const DistanceField& Field = *OutCandidate.field;
+
+		// Walk the path as UseShiftAbility would, the unit standing on its element.
+		if (OutCandidate.steps != INT32_MAX)
+		{
+			int32_t height = snapshot.tiles.GetHeight(OutCandidate.tile);
+			int32_t tile = Field.GetNextStep(OutCandidate.tile);
+
+			for (int32_t step = 0; tile != InvalidIndex && step < settings.maxSimulatedSteps; ++step)
+			{
+				const int32_t heightDifference = snapshot.tiles.GetHeight(tile) - height;
+
+				if (snapshot.tiles.GetColor(tile) & elementColor)
+				{
+					// Raise or lower the next tile until it is one apart.
+					if (std::abs(heightDifference) > 1)
+					{
+						OutCandidate.shifts += std::abs(heightDifference) - 1;
+						height += heightDifference > 0 ? 1 : -1;
+					}
+					else
+					{
+						height = snapshot.tiles.GetHeight(tile);
+					}
+				}
+				else
+				{
+					// Raise or lower the current tile to the same height, then expand onto the next.
+					OutCandidate.shifts += std::abs(heightDifference) + 1;
+					height = snapshot.tiles.GetHeight(tile);
+				}
+
+				tile = Field.GetNextStep(tile);
+			}
+		}
+
+		// Enemies close to the guarded tile, and how much further from it the unit ends than they are.
+		if (guardTile != InvalidIndex)
+		{
+			const int32_t guardDistance = Adjacency.Distance(OutCandidate.tile, guardTile);
+
+			for (const int32_t threat : Threats)
+			{
+				const int32_t threatDistance = Adjacency.Distance(threat, guardTile);
+
+				if (threatDistance < settings.threatRadius)
+				{
+					OutCandidate.threat = std::max(OutCandidate.threat, guardDistance - threatDistance);
+				}
+			}
+		}
+
+		OutCandidate.score += static_cast<int64_t>(settings.shiftWeight) * OutCandidate.shifts + static_cast<int64_t>(settings.threatWeight) * OutCandidate.threat;
+		OutCandidate.bEvaluated = true;
+	}
+
+	int32_t MoveEvaluator::PickBest() const
+	{
+		if (candidates.empty())
+		{
+			return InvalidIndex;
+		}
+
+		// Scores of candidates left out are only lower bounds, so they don't compete with full scores.
+		const MoveCandidate* best = nullptr;
+
+		for (const MoveCandidate& candidate : candidates)
+		{
+			if (candidate.bEvaluated && (best == nullptr || candidate.score < best->score))
+			{
+				best = &candidate;
+			}
+		}
+
+		// Nothing scored in time, the fewest steps will do.
+		return best != nullptr ? best->tile : candidates.front().tile;
+	}
+}
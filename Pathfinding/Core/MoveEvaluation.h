@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "DistanceField.h"
+#include "GridSnapshot.h"
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief State of the grid move evaluation reads from worker threads.
+	 *		  Filled on the game thread between evaluations, never while one runs.
+	 */
+	struct MoveSnapshot
+	{
+		const AdjacencyTable* adjacency = nullptr;
+
+		// Heights and colors of the tiles, as the game thread copied them. Neighbors and distances come from the adjacency.
+		GridSnapshot tiles;
+	};
+
+	// Weights of the score, in twelfths of a turn: a unit moves four tiles and uses three shift abilities a turn.
+	struct MoveEvaluationSettings
+	{
+		int32_t stepWeight = 3;
+		int32_t shiftWeight = 4;
+
+		// Per tile the unit ends further from the guarded tile than an enemy within the threat radius of it.
+		int32_t threatWeight = 6;
+		int32_t threatRadius = 3;
+
+		// Steps of the path shift abilities are counted for. Steps further than that count as needing none.
+		int32_t maxSimulatedSteps = 32;
+	};
+
+	struct MoveCandidate
+	{
+		int32_t tile = InvalidIndex;
+
+		// Steps of the path from the candidate to the goal, INT32_MAX if there is none.
+		int32_t steps = INT32_MAX;
+		// Field the steps come from: the unit's own, or the fallback where that has no path.
+		const DistanceField* field = nullptr;
+		// Shift abilities the path needs, the way UPlayerAI::UseShiftAbility clears it.
+		int32_t shifts = 0;
+		int32_t threat = 0;
+
+		// Lower is better. Candidates left out by the budget keep the score of their steps alone.
+		int64_t score = 0;
+		bool bEvaluated = false;
+	};
+
+	/*!
+	 * \brief Scores tiles a unit may move to, on worker threads, within a time budget.
+	 *
+	 *		  Candidates are first ordered by the steps of their path, read from the distance field of the unit's rules,
+	 *		  or from the fallback field where those rules reach no goal,
+	 *		  then scored in that order in chunks spread with parallelFor(count, body),
+	 *		  which may be WorkerPool::ParallelFor or the engine's ParallelFor.
+	 *		  A full score walks the path to count the shift abilities it needs and checks how far the unit ends from a threatened flag.
+	 *		  Chunks starting after the deadline are skipped, so the best so far is picked in time
+	 *		  however many candidates there are. Workers only read the snapshot, the fields and the settings.
+	 */
+	class MoveEvaluator
+	{
+	public:
+		/*!
+		 * \brief Score every candidate and return the best one, or InvalidIndex if there are none.
+		 *
+		 * \param Field
+		 *		  Field toward the goal, under the rules the unit follows its path with.
+		 *
+		 * \param FallbackField
+		 *		  Field toward the same goal, for candidates Field has no path from, such as the shortest field clearing the path with shift abilities.
+		 *
+		 * \param elementColor
+		 *		  ElementMask of the unit. Steps onto other colors need the tile expanded first.
+		 *
+		 * \param Threats
+		 *		  Tiles of enemy units.
+		 *
+		 * \param guardTile
+		 *		  Own flag, or the enemy carrying it. Candidates further from it than an enemy threatening it score worse. InvalidIndex for none.
+		 *
+		 * \param fallbackGoal
+		 *		  Candidates which can't reach a goal of the field are ordered by straight line distance to this tile.
+		 */
+		template <typename ParallelForType>
+		int32_t Evaluate(const MoveSnapshot& snapshot, const DistanceField& Field, const DistanceField& FallbackField, uint8_t elementColor, const std::vector<int32_t>& Candidates, const std::vector<int32_t>& Threats, int32_t guardTile, int32_t fallbackGoal, std::chrono::nanoseconds budget, ParallelForType&& parallelFor)
+		{
+			const auto deadline = std::chrono::steady_clock::now() + budget;
+
+			Prepare(snapshot, Field, FallbackField, Candidates, fallbackGoal);
+
+			const int32_t candidateCount = static_cast<int32_t>(candidates.size());
+			const int32_t chunkCount = (candidateCount + ChunkSize - 1) / ChunkSize;
+
+			evaluatedCount.store(0, std::memory_order_relaxed);
+
+			parallelFor(chunkCount, [&](int32_t chunk)
+			{
+				// Out of time, keep the order of the steps alone.
+				if (std::chrono::steady_clock::now() >= deadline)
+				{
+					return;
+				}
+
+				const int32_t begin = chunk * ChunkSize;
+				const int32_t end = std::min(begin + ChunkSize, candidateCount);
+
+				for (int32_t i = begin; i < end; ++i)
+				{
+					Score(snapshot, elementColor, Threats, guardTile, candidates[i]);
+				}
+
+				evaluatedCount.fetch_add(end - begin, std::memory_order_relaxed);
+			});
+
+			return PickBest();
+		}
+
+		// Candidates of the last evaluation, ordered by their steps.
+		const std::vector<MoveCandidate>& GetCandidates() const { return candidates; }
+
+		// Candidates the last evaluation scored fully before the deadline.
+		int32_t GetEvaluatedCount() const { return evaluatedCount.load(std::memory_order_relaxed); }
+
+		MoveEvaluationSettings settings;
+
+		// Candidates a worker scores before checking the deadline again.
+		static constexpr int32_t ChunkSize = 8;
+
+	private:
+		// Fill the candidates with their steps and order them.
+		void Prepare(const MoveSnapshot& snapshot, const DistanceField& Field, const DistanceField& FallbackField, const std::vector<int32_t>& Candidates, int32_t fallbackGoal);
+
+		// Count the shift abilities of the path and the threat, reading only shared state.
+		void Score(const MoveSnapshot& snapshot, uint8_t elementColor, const std::vector<int32_t>& Threats, int32_t guardTile, MoveCandidate& OutCandidate) const;
+
+		int32_t PickBest() const;
+
+	private:
+		std::vector<MoveCandidate> candidates;
+		std::atomic<int32_t> evaluatedCount { 0 };
+	};
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "AStarSearch.h"
+#include "SearchPool.h"
+
+namespace AkPathfinding
+{
+	struct PathResult
+	{
+		bool bFound = false;
+
+		// Same order as AStarSearch output, from the destination back to the start.
+		std::vector<int32_t> tiles;
+	};
+
+	// Requests a worker runs with one borrowed search before taking more.
+	constexpr int32_t PathBatchChunkSize = 4;
+
+	/*!
+	 * \brief Run all requests and fill results of the same index.
+	 *
+	 *		  Requests are split into chunks spread with parallelFor(count, body),
+	 *		  which may be WorkerPool::ParallelFor or the engine's ParallelFor.
+	 *		  Each chunk borrows one search from the pool, so workers reuse node storage between requests.
+	 *		  Keep results between batches to reuse their tile buffers as well.
+	 */
+	template <typename ParallelForType>
+	void FindPaths(SearchPool<AStarSearch>& searches, const std::vector<PathRequest>& requests, std::vector<PathResult>& results, ParallelForType&& parallelFor)
+	{
+		const int32_t requestCount = static_cast<int32_t>(requests.size());
+		const int32_t chunkCount = (requestCount + PathBatchChunkSize - 1) / PathBatchChunkSize;
+
+		results.resize(requests.size());
+
+		parallelFor(chunkCount, [&](int32_t chunk)
+		{
+			auto context = searches.Acquire();
+
+			const int32_t begin = chunk * PathBatchChunkSize;
+			const int32_t end = std::min(begin + PathBatchChunkSize, requestCount);
+
+			for (int32_t i = begin; i < end; ++i)
+			{
+				results[i].bFound = context->search.FindPath(requests[i], results[i].tiles);
+			}
+		});
+	}
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+// Set to 1 to record counters and timings of queries in SearchMetrics. Otherwise its hooks compile to nothing.
+#ifndef AK_PATHFINDING_METRICS
+#define AK_PATHFINDING_METRICS 0
+#endif
+
+/*!
+ * Engine independent pathfinding core.
+ * Nothing under this namespace may include engine headers, so that it builds with plain CMake.
+ */
+namespace AkPathfinding
+{
+	constexpr int32_t InvalidIndex = -1;
+	constexpr int MaxNeighbors = 6;
+
+	namespace ElementMask
+	{
+		constexpr uint8_t None = 0;
+		constexpr uint8_t Stone = 1;
+		constexpr uint8_t Water = 2;
+		constexpr uint8_t Vine = 4;
+		constexpr uint8_t Fire = 8;
+		constexpr uint8_t Lightning = 16;
+		constexpr uint8_t Any = Stone | Water | Vine | Fire | Lightning;
+	}
+
+	/*!
+	 * \brief Minimal view of a hex grid the searches need.
+	 *
+	 *		  Tiles are addressed by a dense index in [0, GetTileCount()),
+	 *		  so that search containers can be plain arrays.
+	 */
+	class IPathGrid
+	{
+	public:
+		virtual ~IPathGrid() = default;
+
+		virtual int32_t GetTileCount() const = 0;
+
+		/*!
+		 * \brief Fill OutNeighbors with tiles adjacent to the given tile.
+		 *
+		 * \return int
+		 *		   Number of valid neighbors.
+		 */
+		virtual int GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[MaxNeighbors]) const = 0;
+
+		// Cost of the step between two adjacent tiles. Always positive.
+		virtual int32_t GetCost(int32_t from, int32_t to) const = 0;
+
+		// Height rule for the step between two adjacent tiles.
+		virtual bool IsPassable(int32_t from, int32_t to) const = 0;
+		
+		virtual bool IsBlocked(int32_t tile) const = 0;
+
+		// ElementMask bit of the top type of the tile.
+		virtual uint8_t GetTileColor(int32_t tile) const = 0;
+
+		// Hex distance used as the heuristic.
+		virtual int32_t Distance(int32_t from, int32_t to) const = 0;
+	};
+}
@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "QueryCache.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace AkPathfinding
+{
+	namespace
+	{
+		// Flags of a range key.
+		constexpr uint8_t AllowWaterType = 1;
+		constexpr uint8_t LightningSpecial = 2;
+		constexpr uint8_t AllowAnyDestination = 4;
+
+		// Flags of a path key. Ties may break the other way searched from both ends.
+		constexpr uint8_t Bidirectional = 8;
+	}
+
+	QueryKey QueryKey::MakePathKey(const PathRequest& request)
+	{
+		QueryKey key;
+		key.kind = Kind::Path;
+		key.start = request.start;
+		key.goal = request.destination;
+		key.pathColor = request.pathColor;
+		key.destinationColor = request.destinationColor;
+		key.nodeBlockTest = request.nodeBlockTest;
+		key.flags = request.bBidirectional ? Bidirectional : 0;
+
+		return key;
+	}
+
+	QueryKey QueryKey::MakeRangeKey(int32_t position, int32_t distance, uint8_t elementColor, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination)
+	{
+		QueryKey key;
+		key.kind = Kind::Range;
+		key.start = position;
+		key.goal = distance;
+		key.pathColor = elementColor;
+		key.destinationColor = elementColor;
+		key.flags = (allowWaterType ? AllowWaterType : 0) | (lightningSpecial ? LightningSpecial : 0) | (allowAnyDestination ? AllowAnyDestination : 0);
+		key.nodeBlockTest = &NodeTester::Test_Height;
+
+		return key;
+	}
+
+	bool QueryKey::operator==(const QueryKey& other) const
+	{
+		return kind == other.kind
+			&& start == other.start
+			&& goal == other.goal
+			&& pathColor == other.pathColor
+			&& destinationColor == other.destinationColor
+			&& flags == other.flags
+			&& nodeBlockTest == other.nodeBlockTest;
+	}
+
+	size_t QueryKeyHash::operator()(const QueryKey& key) const
+	{
+		uint64_t hash = static_cast<uint32_t>(key.start);
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(key.goal);
+		hash = hash * 0x9E3779B97F4A7C15ull + (static_cast<uint32_t>(key.kind) << 24 | static_cast<uint32_t>(key.flags) << 16 | static_cast<uint32_t>(key.pathColor) << 8 | key.destinationColor);
+
+		return static_cast<size_t>(hash ^ hash >> 29) ^ std::hash<NodeBlockTest>()(key.nodeBlockTest);
+	}
+
+	void QueryCache::Initialize(const AdjacencyTable* InAdjacency, int64_t InMaxBytes)
+	{
+		Adjacency = InAdjacency;
+		maxBytes = InMaxBytes;
+
+		Clear();
+	}
+
+	const QueryCache::Result* QueryCache::Find(const QueryKey& key)
+	{
+		// The adjacency changed without telling which tiles.
+		if (version != Adjacency->GetVersion())
+		{
+			Clear();
+		}
+
+		const auto found = index.find(key);
+
+		if (found == index.end())
+		{
+			++missCount;
+			return nullptr;
+		}
+
+		++hitCount;
+
+		// Move to the front.
+		entries.splice(entries.begin(), entries, found->second);
+
+		return &found->second->result;
+	}
+
+	void QueryCache::AddPath(const QueryKey& key, bool bFound, const std::vector<int32_t>& Tiles, const std::vector<int32_t>& VisitedTiles)
+	{
+		Entry& entry = Add(key);
+		entry.result.bFound = bFound;
+		entry.result.tiles = Tiles;
+
+		// A search which stopped at the destination color didn't visit the destination.
+		entry.dependencies = VisitedTiles;
+		entry.dependencies.push_back(key.start);
+		entry.dependencies.push_back(key.goal);
+
+		std::sort(entry.dependencies.begin(), entry.dependencies.end());
+		entry.dependencies.erase(std::unique(entry.dependencies.begin(), entry.dependencies.end()), entry.dependencies.end());
+
+		entry.bytes = GetEntryBytes(entry);
+		bytes += entry.bytes;
+
+		// Old entries first, so the new one is kept even if it alone is over the budget.
+		while (bytes > maxBytes && entries.size() > 1)
+		{
+			Remove(std::prev(entries.end()));
+		}
+	}
+
+	void QueryCache::AddRange(const QueryKey& key, const std::vector<int32_t>& Tiles)
+	{
+		Entry& entry = Add(key);
+		entry.result.bFound = true;
+		entry.result.tiles = Tiles;
+		entry.dependencyRadius = key.goal;
+
+		entry.bytes = GetEntryBytes(entry);
+		bytes += entry.bytes;
+
+		while (bytes > maxBytes && entries.size() > 1)
+		{
+			Remove(std::prev(entries.end()));
+		}
+	}
+
+	void QueryCache::NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles)
+	{
+		// Checking every entry against every tile costs more than searching again.
+		if (static_cast<int32_t>(ChangedTiles.size()) >= Adjacency->GetTileCount())
+		{
+			Clear();
+			return;
+		}
+
+		version = Adjacency->GetVersion();
+
+		for (auto entry = entries.begin(); entry != entries.end();)
+		{
+			const auto next = std::next(entry);
+
+			for (const int32_t tile : ChangedTiles)
+			{
+				if (DependsOn(*entry, tile))
+				{
+					Remove(entry);
+					break;
+				}
+			}
+
+			entry = next;
+		}
+	}
+
+	void QueryCache::Clear()
+	{
+		entries.clear();
+		index.clear();
+		bytes = 0;
+
+		version = Adjacency != nullptr ? Adjacency->GetVersion() : 0;
+	}
+
+	QueryCache::Entry& QueryCache::Add(const QueryKey& key)
+	{
+		const auto found = index.find(key);
+
+		if (found != index.end())
+		{
+			Remove(found->second);
+		}
+
+		entries.emplace_front();
+		index.emplace(key, entries.begin());
+
+		Entry& entry = entries.front();
+		entry.key = key;
+
+		return entry;
+	}
+
+	void QueryCache::Remove(std::list<Entry>::iterator entry)
+	{
+		bytes -= entry->bytes;
+		index.erase(entry->key);
+		entries.erase(entry);
+	}
+
+	bool QueryCache::DependsOn(const Entry& entry, int32_t tile) const
+	{
+		if (entry.dependencyRadius != InvalidIndex)
+		{
+			// Hex distance never overestimates the steps, so tiles further than the radius can't be reached.
+			return Adjacency->Distance(entry.key.start, tile) <= entry.dependencyRadius;
+		}
+
+		return std::binary_search(entry.dependencies.begin(), entry.dependencies.end(), tile);
+	}
+
+	int64_t QueryCache::GetEntryBytes(const Entry& entry)
+	{
+		return static_cast<int64_t>(sizeof(Entry) + (entry.result.tiles.capacity() + entry.dependencies.capacity()) * sizeof(int32_t));
+	}
+}
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "AStarSearch.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	// Everything the result of a path or range query depends on, besides the grid.
+	struct QueryKey
+	{
+		enum class Kind : uint8_t
+		{
+			Path,
+			Range,
+		};
+
+		Kind kind = Kind::Path;
+		int32_t start = InvalidIndex;
+		// Destination of a path, distance of a range.
+		int32_t goal = InvalidIndex;
+
+		uint8_t pathColor = ElementMask::Any;
+		uint8_t destinationColor = ElementMask::Any;
+		// Flags of a range, or the direction of a path search.
+		uint8_t flags = 0;
+
+		NodeBlockTest nodeBlockTest = &NodeTester::Test_None;
+
+		static QueryKey MakePathKey(const PathRequest& request);
+		// Arguments of RangeSearch::GetMovementRange.
+		static QueryKey MakeRangeKey(int32_t position, int32_t distance, uint8_t elementColor, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination);
+
+		bool operator==(const QueryKey& other) const;
+	};
+
+	struct QueryKeyHash
+	{
+		size_t operator()(const QueryKey& key) const;
+	};
+
+	/*!
+	 * \brief Results of path and range queries, kept until a tile they depend on changes.
+	 *
+	 *		  A path depends on the tiles its search visited, a range on the tiles within its distance.
+	 *		  The cache is valid for the adjacency version it last caught up with, see GetVersion.
+	 *		  NotifyTilesChanged only drops entries depending on the tiles changed since then, however many rebuilds ago.
+	 *		  If the adjacency was rebuilt without telling the cache, its version differs and every entry is dropped.
+	 *		  Least recently used entries are dropped once the entries take more than the byte budget.
+	 */
+	class QueryCache
+	{
+	public:
+		struct Result
+		{
+			bool bFound = false;
+			std::vector<int32_t> tiles;
+		};
+
+		void Initialize(const AdjacencyTable* InAdjacency, int64_t InMaxBytes = DefaultMaxBytes);
+
+		// Null on a miss. Valid until the cache is changed.
+		const Result* Find(const QueryKey& key);
+
+		/*!
+		 * \brief Keep the result of a path query.
+		 *
+		 * \param VisitedTiles
+		 *		  Tiles the search read, from AStarSearch::GetVisitedTiles.
+		 */
+		void AddPath(const QueryKey& key, bool bFound, const std::vector<int32_t>& Tiles, const std::vector<int32_t>& VisitedTiles);
+
+		// Keep the result of a range query. Every step costs at least one, so it depends on nothing further than its distance.
+		void AddRange(const QueryKey& key, const std::vector<int32_t>& Tiles);
+
+		// Call with every tile the adjacency rebuilt since GetVersion, like FHexGridView::GetChangedTilesSince gives.
+		void NotifyTilesChanged(const std::vector<int32_t>& ChangedTiles);
+
+		// Adjacency version the entries are valid for.
+		uint32_t GetVersion() const { return version; }
+
+		void Clear();
+
+		int32_t Num() const { return static_cast<int32_t>(index.size()); }
+		int64_t GetBytes() const { return bytes; }
+
+		int64_t GetHitCount() const { return hitCount; }
+		int64_t GetMissCount() const { return missCount; }
+
+		static constexpr int64_t DefaultMaxBytes = 4 << 20;
+
+	private:
+		struct Entry
+		{
+			QueryKey key;
+			Result result;
+
+			// Sorted tiles a path depends on.
+			std::vector<int32_t> dependencies;
+			// Hex distance from the start a range depends on. InvalidIndex for paths.
+			int32_t dependencyRadius = InvalidIndex;
+
+			int64_t bytes = 0;
+		};
+
+		// Replace an entry of the key, then drop old entries until the budget holds.
+		Entry& Add(const QueryKey& key);
+		void Remove(std::list<Entry>::iterator entry);
+
+		bool DependsOn(const Entry& entry, int32_t tile) const;
+
+		static int64_t GetEntryBytes(const Entry& entry);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		uint32_t version = 0;
+
+		int64_t maxBytes = DefaultMaxBytes;
+		int64_t bytes = 0;
+
+		int64_t hitCount = 0;
+		int64_t missCount = 0;
+
+		// Most recently used first.
+		std::list<Entry> entries;
+		std::unordered_map<QueryKey, std::list<Entry>::iterator, QueryKeyHash> index;
+	};
+}
@@ -0,0 +1,603 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RangeSearch.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+
+#include "SearchMetrics.h"
+
+namespace AkPathfinding
+{
+	void RangeSearch::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+		nodePool.Initialize(Adjacency);
+		reachablePool.Initialize(Adjacency);
+	}
+
+	void RangeSearch::SetOpenListType(OpenListType type)
+	{
+		openList.Reset();
+		openList.SetType(type);
+
+		reachableList.Reset();
+		reachableList.SetType(type);
+	}
+
+	void RangeSearch::GetMovementRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t elementColor, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination)
+	{
+		stats.Reset();
+
+		uint8_t destinationColor = elementColor;
+		uint8_t pathColor = elementColor | ElementMask::Stone;
+
+		if (lightningSpecial)
+		{
+			destinationColor |= ElementMask::Stone;
+		}
+
+		if (allowWaterType)
+		{
+			destinationColor |= ElementMask::Water;
+			pathColor |= ElementMask::Water;
+		}
+
+		if (FloodFillRange(position, distance, OutMovablePoints, allowAnyDestination ? ElementMask::Any : destinationColor, pathColor, allowAnyDestination == false))
+		{
+			return;
+		}
+
+		if (allowAnyDestination)
+		{
+			GetTilesInRange(position, distance, OutMovablePoints, ElementMask::Any, pathColor, &NodeTester::Test_Height);
+			return;
+		}
+
+		GetTilesInRange(position, distance, OutMovablePoints, destinationColor, pathColor, &NodeTester::Test_Height);
+		FindReachableDestinations(position, distance, OutMovablePoints, destinationColor, &NodeTester::Test_Height);
+
+		// Keep tiles which can still reach a destination with the remaining budget, preserving order.
+		int32_t keptNum = 0;
+
+		for (const int32_t tile : OutMovablePoints)
+		{
+			const int32_t rangeNodeIndex = nodePool.Find(tile);
+			const int32_t destinationNodeIndex = reachablePool.Find(tile);
+
+			if ((nodePool.colors[rangeNodeIndex] & destinationColor)
+				|| (destinationNodeIndex != InvalidIndex && reachablePool.costs[destinationNodeIndex] <= distance - nodePool.costs[rangeNodeIndex]))
+			{
+				OutMovablePoints[keptNum++] = tile;
+			}
+		}
+
+		OutMovablePoints.resize(keptNum);
+	}
+
+	void RangeSearch::GetTilesInRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		AK_PATHFINDING_QUERY_SCOPE(QueryKind::Range, position, distance, stats, &nodePool, &openList);
+
+		WithNodeTester(nodeBlockTest, [&](auto tester) { SearchRange(position, distance, OutMovablePoints, destinationColor, pathColor, tester); });
+	}
+
+	template <typename Tester>
+	void RangeSearch::SearchRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, Tester tester)
+	{
+		// Reset all containers.
+		nodePool.Reset();
+		openList.Reset();
+		OutMovablePoints.clear();
+
+		// Push start node and kick off the search.
+		const int32_t startNodeIndex = nodePool.Add(position);
+		nodePool.costs[startNodeIndex] = 0;
+
+		openList.Push(startNodeIndex);
+
+		// Do search.
+		while (openList.Num() > 0)
+		{
+			const int32_t currNodeIndex = openList.PopIndex();
+			nodePool.SetClosed(currNodeIndex, true);
+
+			const int32_t currTile = nodePool.tiles[currNodeIndex];
+			const int32_t currCost = nodePool.costs[currNodeIndex];
+
+			// Minimum cost node is not reachable.
+			if (currCost > distance)
+			{
+				// Done.
+				return;
+			}
+
+			// Don't need to check initial node.
+			if (currTile != position)
+			{
+				// It is destination node.
+				if (currCost == distance)
+				{
+					if ((nodePool.colors[currNodeIndex] & destinationColor) == 0)
+					{
+						// Not valid color.
+						continue;
+					}
+				}
+				else if ((nodePool.colors[currNodeIndex] & pathColor) == 0)
+				{
+					continue;
+				}
+			}
+
+			// This node is reachable. Store it.
+			OutMovablePoints.push_back(currTile);
+
+			++stats.nodesExpanded;
+
+			// Grab neighbors to expand.
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			// Check all neighbors.
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = currLinks.neighbors[i];
+				const int32_t neighborNodeIndex = nodePool.FindOrAdd(neighborTile);
+
+				// If it is starting point, it is guaranteed to be passable.
+				if (neighborTile != position)
+				{
+					// If it isn't, do test.
+					if (tester(nodePool, currNodeIndex, neighborNodeIndex, currLinks.IsPassable(i)) == false)
+					{
+						// Blocked.
+						continue;
+					}
+				}
+
+				const int32_t newCost = currCost + currLinks.costs[i];
+
+				// If this is not better than previous approach,
+				if (newCost >= nodePool.costs[neighborNodeIndex])
+				{
+					// skip.
+					continue;
+				}
+
+				// Fill in.
+				nodePool.costs[neighborNodeIndex] = newCost;
+				assert(newCost > 0);
+				nodePool.parents[neighborNodeIndex] = currNodeIndex;
+				nodePool.SetClosed(neighborNodeIndex, false);
+
+				// If this node is not in the open list,
+				if (nodePool.IsOpened(neighborNodeIndex) == false)
+				{
+					// add to the open list.
+					openList.Push(neighborNodeIndex);
+				}
+				else
+				{
+					// otherwise move it up to its new place.
+					openList.Update(neighborNodeIndex);
+				}
+			}
+		}
+	}
+
+	void RangeSearch::FindReachableDestinations(int32_t position, int32_t distance, const std::vector<int32_t>& Tiles, uint8_t elementColor, NodeBlockTest nodeBlockTest)
+	{
+		AK_PATHFINDING_QUERY_SCOPE(QueryKind::ReachableDestinations, position, distance, stats, &reachablePool, &reachableList);
+
+		WithNodeTester(nodeBlockTest, [&](auto tester) { SearchDestinations(position, distance, Tiles, elementColor, tester); });
+	}
+
+	template <typename Tester>
+	void RangeSearch::SearchDestinations(int32_t position, int32_t distance, const std::vector<int32_t>& Tiles, uint8_t elementColor, Tester tester)
+	{
+		reachablePool.Reset();
+		reachableList.Reset();
+		ringNodes.clear();
+
+		// Tiles of the color are destinations themselves, so only the others need the search.
+		// Most of them step right onto a destination, which settles them without the search as well.
+		// The rest are targets of the search, the first ring.
+		int32_t budget = 0;
+		int32_t targetsLeft = 0;
+
+		for (const int32_t tile : Tiles)
+		{
+			const int32_t rangeNodeIndex = nodePool.Find(tile);
+
+			if (nodePool.colors[rangeNodeIndex] & elementColor)
+			{
+				continue;
+			}
+
+			const int32_t remaining = distance - nodePool.costs[rangeNodeIndex];
+			const int32_t nodeIndex = reachablePool.FindOrAdd(tile);
+			const int32_t adjacentCost = GetAdjacentDestinationCost(position, nodeIndex, elementColor, tester);
+
+			if (adjacentCost <= remaining)
+			{
+				reachablePool.costs[nodeIndex] = adjacentCost;
+				reachableList.Push(nodeIndex);
+				continue;
+			}
+
+			reachablePool.depths[nodeIndex] = 0;
+			ringNodes.push_back(nodeIndex);
+
+			budget = std::max(budget, remaining);
+			++targetsLeft;
+		}
+
+		const int64_t expandedBefore = stats.nodesExpanded;
+
+		// Tiles the targets can step to are discovered ring by ring, breadth first.
+		int32_t ringBegin = 0;
+		int32_t ringNum = 0;
+
+		while (targetsLeft > 0)
+		{
+			// Every step costs at least one, so a destination out of the discovered rings costs more than ringNum.
+			// Discover more until the cheapest open node can't be beaten by them.
+			while (ringNum < budget && (reachableList.Num() == 0 || reachablePool.costs[reachableList.TopIndex()] > ringNum))
+			{
+				const int32_t ringEnd = static_cast<int32_t>(ringNodes.size());
+				DiscoverRing(position, ringBegin, ringEnd, elementColor, tester, stats.nodesExpanded > expandedBefore);
+
+				ringBegin = ringEnd;
+				++ringNum;
+			}
+
+			if (reachableList.Num() == 0)
+			{
+				// No destination around.
+				return;
+			}
+
+			const int32_t currNodeIndex = reachableList.PopIndex();
+
+			const int32_t currTile = reachablePool.tiles[currNodeIndex];
+			const int32_t currCost = reachablePool.costs[currNodeIndex];
+
+			// No target can afford more than the budget.
+			if (currCost > budget)
+			{
+				// Done.
+				return;
+			}
+
+			// A target has its final cost.
+			if (reachablePool.depths[currNodeIndex] == 0 && reachablePool.IsClosed(currNodeIndex) == false)
+			{
+				--targetsLeft;
+			}
+
+			reachablePool.SetClosed(currNodeIndex, true);
+			++stats.nodesExpanded;
+
+			// Grab neighbors to expand.
+			const TileLinks& currLinks = Adjacency->GetLinks(currTile);
+
+			// Check all neighbors, walking the step backwards.
+			for (int i = 0; i < currLinks.neighborCount; ++i)
+			{
+				const int32_t neighborNodeIndex = reachablePool.Find(currLinks.neighbors[i]);
+
+				// Not discovered yet. It will pull the cost from this node when it is.
+				if (neighborNodeIndex == InvalidIndex)
+				{
+					continue;
+				}
+
+				RelaxBackwards(position, neighborNodeIndex, currNodeIndex, currLinks.reverseCosts[i], currLinks.IsReversePassable(i), tester);
+			}
+		}
+	}
+
+	bool RangeSearch::FloodFillRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, bool bReachDestinations)
+	{
+		const HexBitboards* bitboards = Adjacency->GetBitboards();
+
+		if (bitboards == nullptr || distance < 0 || distance > HexBitboards::MaxRadius)
+		{
+			return false;
+		}
+
+		// Timed even when it gives up, as the search after it pays for that too.
+		AK_PATHFINDING_QUERY_SCOPE(QueryKind::RangeFlood, position, distance, stats, nullptr, nullptr);
+
+		// Nothing in range is further than the distance, either way.
+		bitboards->GetWindow(position, distance, pathColor, destinationColor, window);
+
+		const int32_t rowCount = window.rowCount;
+		const int32_t centerRow = distance;
+		const uint64_t centerBit = uint64_t(1) << distance;
+
+		uint64_t visited[HexBitboards::MaxWindowRows] = {};
+		uint64_t frontier[HexBitboards::MaxWindowRows] = {};
+		uint64_t reached[HexBitboards::MaxWindowRows];
+
+		// Layer k holds the tiles of cost k.
+		layerRows.assign(static_cast<size_t>(distance + 1) * rowCount, 0);
+		layerRows[centerRow] = centerBit;
+		visited[centerRow] = centerBit;
+		frontier[centerRow] = centerBit;
+
+		int64_t layerTileCount = 1;
+
+		for (int32_t cost = 1; cost <= distance; ++cost)
+		{
+			// Layers only hold while every step costs one.
+			for (int32_t row = 0; row < rowCount; ++row)
+			{
+				if (frontier[row] & ~window.uniform[row])
+				{
+					return false;
+				}
+			}
+
+			HexBitboards::StepForward(window, frontier, reached);
+
+			uint64_t* layer = &layerRows[static_cast<size_t>(cost) * rowCount];
+			bool bExpanding = false;
+
+			for (int32_t row = 0; row < rowCount; ++row)
+			{
+				reached[row] &= window.open[row] & ~visited[row];
+				visited[row] |= reached[row];
+
+				// Tiles short of the distance are left again, so need the path color. The last ones need the destination color.
+				frontier[row] = reached[row] & window.leave[row];
+				layer[row] = cost < distance ? frontier[row] : reached[row] & window.destination[row];
+
+				layerTileCount += std::bitset<64>(layer[row]).count();
+				bExpanding = bExpanding || frontier[row] != 0;
+			}
+
+			if (bExpanding == false)
+			{
+				break;
+			}
+		}
+
+		if (bReachDestinations)
+		{
+			uint64_t current[HexBitboards::MaxWindowRows];
+			uint64_t stepped[HexBitboards::MaxWindowRows];
+
+			// Steps onto the origin pass whatever blocks them, so every neighbor of it can take one.
+			uint64_t origin[HexBitboards::MaxWindowRows] = {};
+			uint64_t originNeighbors[HexBitboards::MaxWindowRows];
+			origin[centerRow] = centerBit;
+			HexBitboards::GetNeighbors(window, origin, originNeighbors);
+
+			// Reach j holds the tiles at most j steps from a destination.
+			reachRows.assign(static_cast<size_t>(distance + 1) * rowCount, 0);
+
+			for (int32_t row = 0; row < rowCount; ++row)
+			{
+				reachRows[row] = window.destination[row];
+				current[row] = window.destination[row];
+			}
+
+			for (int32_t steps = 1; steps <= distance; ++steps)
+			{
+				const uint64_t* previous = &reachRows[static_cast<size_t>(steps - 1) * rowCount];
+				uint64_t* reach = &reachRows[static_cast<size_t>(steps) * rowCount];
+
+				// A walk stops at the first destination, and steps onto the origin pass whatever blocks it.
+				for (int32_t row = 0; row < rowCount; ++row)
+				{
+					current[row] &= row == centerRow ? window.open[row] | centerBit : window.open[row];
+				}
+
+				HexBitboards::StepBackward(window, current, stepped);
+				const bool bFromOrigin = (current[centerRow] & centerBit) != 0;
+
+				for (int32_t row = 0; row < rowCount; ++row)
+				{
+					if (bFromOrigin)
+					{
+						stepped[row] |= originNeighbors[row];
+					}
+
+					current[row] = stepped[row] & ~previous[row];
+
+					if (current[row] & ~window.uniform[row])
+					{
+						return false;
+					}
+
+					reach[row] = previous[row] | current[row];
+				}
+			}
+		}
+
+		stats.nodesExpanded += layerTileCount;
+		OutMovablePoints.clear();
+
+		// Cheapest first, like the search.
+		for (int32_t cost = 0; cost <= distance; ++cost)
+		{
+			const uint64_t* layer = &layerRows[static_cast<size_t>(cost) * rowCount];
+			const uint64_t* reach = bReachDestinations ? &reachRows[static_cast<size_t>(distance - cost) * rowCount] : nullptr;
+
+			for (int32_t row = 0; row < rowCount; ++row)
+			{
+				uint64_t bits = reach != nullptr ? layer[row] & reach[row] : layer[row];
+
+				while (bits != 0)
+				{
+					OutMovablePoints.push_back(bitboards->ToTile(window, row, HexBitboards::FirstBit(bits)));
+					bits &= bits - 1;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Tester>
+	void RangeSearch::DiscoverRing(int32_t position, int32_t ringBegin, int32_t ringEnd, uint8_t elementColor, Tester tester, bool bPullCosts)
+	{
+		for (int32_t ringIndex = ringBegin; ringIndex < ringEnd; ++ringIndex)
+		{
+			const int32_t ringNodeIndex = ringNodes[ringIndex];
+
+			// A walk stops at the first destination, so don't step beyond one.
+			if (reachablePool.colors[ringNodeIndex] & elementColor)
+			{
+				continue;
+			}
+
+			const TileLinks& ringLinks = Adjacency->GetLinks(reachablePool.tiles[ringNodeIndex]);
+
+			for (int i = 0; i < ringLinks.neighborCount; ++i)
+			{
+				const int32_t neighborTile = ringLinks.neighbors[i];
+				int32_t neighborNodeIndex = reachablePool.Find(neighborTile);
+
+				if (neighborNodeIndex == InvalidIndex)
+				{
+					neighborNodeIndex = AddDiscoveredNode(position, neighborTile, elementColor, tester, bPullCosts);
+				}
+
+				// Already in a ring.
+				if (reachablePool.depths[neighborNodeIndex] != InvalidIndex)
+				{
+					continue;
+				}
+
+				// If it is starting point, it is guaranteed to be passable.
+				if (neighborTile != position)
+				{
+					// If it isn't, do test.
+					if (tester(reachablePool, ringNodeIndex, neighborNodeIndex, ringLinks.IsPassable(i)) == false)
+					{
+						// Blocked.
+						continue;
+					}
+				}
+
+				reachablePool.depths[neighborNodeIndex] = reachablePool.depths[ringNodeIndex] + 1;
+				ringNodes.push_back(neighborNodeIndex);
+			}
+		}
+	}
+
+	template <typename Tester>
+	int32_t RangeSearch::GetAdjacentDestinationCost(int32_t position, int32_t nodeIndex, uint8_t elementColor, Tester tester)
+	{
+		int32_t minCost = INT32_MAX;
+
+		const TileLinks& nodeLinks = Adjacency->GetLinks(reachablePool.tiles[nodeIndex]);
+
+		for (int i = 0; i < nodeLinks.neighborCount; ++i)
+		{
+			const int32_t neighborTile = nodeLinks.neighbors[i];
+			int32_t neighborNodeIndex = reachablePool.Find(neighborTile);
+
+			if (neighborNodeIndex == InvalidIndex)
+			{
+				neighborNodeIndex = AddDiscoveredNode(position, neighborTile, elementColor, tester, false);
+			}
+
+			if ((reachablePool.colors[neighborNodeIndex] & elementColor) == 0)
+			{
+				continue;
+			}
+
+			// If it is starting point, it is guaranteed to be passable.
+			if (neighborTile != position)
+			{
+				// If it isn't, do test.
+				if (tester(reachablePool, nodeIndex, neighborNodeIndex, nodeLinks.IsPassable(i)) == false)
+				{
+					// Blocked.
+					continue;
+				}
+			}
+
+			minCost = std::min(minCost, nodeLinks.costs[i]);
+		}
+
+		return minCost;
+	}
+
+	template <typename Tester>
+	int32_t RangeSearch::AddDiscoveredNode(int32_t position, int32_t tile, uint8_t elementColor, Tester tester, bool bPullCosts)
+	{
+		const int32_t newNodeIndex = reachablePool.Add(tile);
+
+		// Every tile of the color is a destination already.
+		if (reachablePool.colors[newNodeIndex] & elementColor)
+		{
+			reachablePool.costs[newNodeIndex] = 0;
+			reachableList.Push(newNodeIndex);
+			return newNodeIndex;
+		}
+
+		// Neighbors expanded before this tile was discovered couldn't reach it, so pull from them.
+		if (bPullCosts)
+		{
+			const TileLinks& tileLinks = Adjacency->GetLinks(tile);
+
+			for (int i = 0; i < tileLinks.neighborCount; ++i)
+			{
+				const int32_t neighborNodeIndex = reachablePool.Find(tileLinks.neighbors[i]);
+
+				if (neighborNodeIndex != InvalidIndex && reachablePool.IsClosed(neighborNodeIndex))
+				{
+					RelaxBackwards(position, newNodeIndex, neighborNodeIndex, tileLinks.costs[i], tileLinks.IsPassable(i), tester);
+				}
+			}
+		}
+
+		return newNodeIndex;
+	}
+
+	template <typename Tester>
+	void RangeSearch::RelaxBackwards(int32_t position, int32_t fromNode, int32_t toNode, int32_t stepCost, bool bPassable, Tester tester)
+	{
+		// If the step goes to the starting point, it is guaranteed to be passable.
+		if (reachablePool.tiles[toNode] != position)
+		{
+			// If it isn't, do test.
+			if (tester(reachablePool, fromNode, toNode, bPassable) == false)
+			{
+				// Blocked.
+				return;
+			}
+		}
+
+		const int32_t newCost = reachablePool.costs[toNode] + stepCost;
+
+		// If this is not better than previous approach,
+		if (newCost >= reachablePool.costs[fromNode])
+		{
+			// skip.
+			return;
+		}
+
+		// Fill in.
+		reachablePool.costs[fromNode] = newCost;
+		assert(newCost > 0);
+		reachablePool.parents[fromNode] = toNode;
+
+		// If this node is not in the open list,
+		if (reachablePool.IsOpened(fromNode) == false)
+		{
+			// add to the open list.
+			reachableList.Push(fromNode);
+		}
+		else
+		{
+			// otherwise move it up to its new place.
+			reachableList.Update(fromNode);
+		}
+	}
+}
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "PathGrid.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Engine independent implementation behind UMovementRange.
+	 *
+	 *		  On grids with HexBitboards, GetMovementRange floods bit rows of the area around the tile one cost at a time,
+	 *		  and only runs Dijkstra when a step there costs more than one or the distance doesn't fit a window.
+	 */
+	class RangeSearch
+	{
+	public:
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		// Binary heap by default. Buckets suit grids with small step costs.
+		void SetOpenListType(OpenListType type);
+
+		/*!
+		 * \brief Find movable tiles in this turn from the given tile.
+		 *
+		 * \param position
+		 *		  Origin tile to start the search.
+		 *
+		 * \param distance
+		 *		  Maximum distance can move from the position.
+		 *
+		 * \param OutMovablePoints
+		 *		  Output container which contains reachable tiles.
+		 *		  Note: OutMovablePoints[0] = position always.
+		 */
+		void GetMovementRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t elementColor, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination);
+
+		void GetTilesInRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, NodeBlockTest nodeBlockTest);
+
+		/*!
+		 * \brief For tiles of the range, find the cost to the closest tile of the given color.
+		 *
+		 *		  Runs a single Dijkstra backwards from all tiles of the color at once,
+		 *		  instead of a forward search per tile of the range.
+		 *		  Tiles the range can step to are discovered ring by ring only as far as the search needs,
+		 *		  so nearby destinations stay about as cheap as with separate early-out searches.
+		 *		  Results are left in reachablePool: a tile can reach the color within its remaining budget
+		 *		  if it has a node whose cost is at most the budget.
+		 *
+		 * \param position
+		 *		  Origin of the range. Steps into it are always passable.
+		 *
+		 * \param distance
+		 *		  Budget of the range. Tiles have whatever their nodePool cost leaves of it.
+		 *
+		 * \param Tiles
+		 *		  Tiles of the range found by GetTilesInRange. Must still be in nodePool.
+		 */
+		void FindReachableDestinations(int32_t position, int32_t distance, const std::vector<int32_t>& Tiles, uint8_t elementColor, NodeBlockTest nodeBlockTest);
+
+		SearchStats GetStats() const
+		{
+			SearchStats result = stats;
+			result.nodeBytes = nodePool.GetNodeBytes() + reachablePool.GetNodeBytes();
+			return result;
+		}
+
+	private:
+		// GetTilesInRange and FindReachableDestinations compiled for the tester.
+		template <typename Tester>
+		void SearchRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, Tester tester);
+		template <typename Tester>
+		void SearchDestinations(int32_t position, int32_t distance, const std::vector<int32_t>& Tiles, uint8_t elementColor, Tester tester);
+
+		/*!
+		 * \brief Same tiles as GetMovementRange with Test_Height, in the same order of costs, without searching.
+		 *
+		 * \param bReachDestinations
+		 *		  Keep only tiles of the destination color, or which can reach one with what is left of the distance,
+		 *		  like FindReachableDestinations.
+		 *
+		 * \return bool
+		 *		   False if the grid has no bitboards, the distance doesn't fit a window or a step costs more than one.
+		 *		   OutMovablePoints is left as it was.
+		 */
+		bool FloodFillRange(int32_t position, int32_t distance, std::vector<int32_t>& OutMovablePoints, uint8_t destinationColor, uint8_t pathColor, bool bReachDestinations);
+
+		// bPullCosts can be false while no node has been expanded yet.
+		template <typename Tester>
+		void DiscoverRing(int32_t position, int32_t ringBegin, int32_t ringEnd, uint8_t elementColor, Tester tester, bool bPullCosts);
+		// Cheapest step from the node onto a tile of the color. INT32_MAX if there is none.
+		template <typename Tester>
+		int32_t GetAdjacentDestinationCost(int32_t position, int32_t nodeIndex, uint8_t elementColor, Tester tester);
+		// Return the index of the new node.
+		template <typename Tester>
+		int32_t AddDiscoveredNode(int32_t position, int32_t tile, uint8_t elementColor, Tester tester, bool bPullCosts);
+
+		// Relax the step from fromNode to toNode of the backwards search.
+		template <typename Tester>
+		void RelaxBackwards(int32_t position, int32_t fromNode, int32_t toNode, int32_t stepCost, bool bPassable, Tester tester);
+
+	private:
+		const AdjacencyTable* Adjacency = nullptr;
+		SearchStats stats;
+
+		NodePool nodePool;
+		NodeSorter nodeSorter = NodeSorter(nodePool);
+		OpenList openList = OpenList(nodePool, nodeSorter);
+
+		// Containers for FindReachableDestinations, kept apart since it runs while nodePool holds the range result.
+		NodePool reachablePool;
+		NodeSorter reachableSorter = NodeSorter(reachablePool);
+		OpenList reachableList = OpenList(reachablePool, reachableSorter);
+
+		// Node indices of reachablePool in the order FindReachableDestinations discovered them.
+		std::vector<int32_t> ringNodes;
+
+		// Containers for FloodFillRange. Rows of the window per cost, and per steps to a destination.
+		HexBitboards::Window window;
+		std::vector<uint64_t> layerRows;
+		std::vector<uint64_t> reachRows;
+	};
+}
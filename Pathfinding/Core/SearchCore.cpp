@@ -0,0 +1,346 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SearchCore.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AkPathfinding
+{
+	NodePool::NodePool()
+	{
+		Grow();
+	}
+
+	void NodePool::Initialize(const AdjacencyTable* InAdjacency)
+	{
+		Adjacency = InAdjacency;
+
+		slots.assign(Adjacency->GetTileCount(), NodeSlot());
+		generation = 1;
+		num = 0;
+	}
+
+	int32_t NodePool::Add(int32_t tile)
+	{
+		if (num == static_cast<int32_t>(tiles.size()))
+		{
+			Grow();
+		}
+
+		const int32_t index = num++;
+
+		NodeSlot& slot = slots[tile];
+		slot.generation = generation;
+		slot.index = index;
+
+		tiles[index] = tile;
+		costs[index] = INT32_MAX;
+		totalCosts[index] = INT32_MAX;
+		parents[index] = InvalidIndex;
+		depths[index] = InvalidIndex;
+		heapIndices[index] = InvalidIndex;
+		flags[index] = 0;
+
+		RefreshTileData(index);
+
+		return index;
+	}
+
+	void NodePool::RefreshTileData(int32_t node)
+	{
+		const TileLinks& tileLinks = Adjacency->GetLinks(tiles[node]);
+
+		SetFlag(node, NodeFlags::Blocked, tileLinks.bBlocked);
+		colors[node] = tileLinks.color;
+	}
+
+	int32_t NodePool::FindOrAdd(int32_t tile)
+	{
+		const NodeSlot& slot = slots[tile];
+		return slot.generation == generation ? slot.index : Add(tile);
+	}
+
+	int32_t NodePool::Find(int32_t tile) const
+	{
+		const NodeSlot& slot = slots[tile];
+		return slot.generation == generation ? slot.index : InvalidIndex;
+	}
+
+	void NodePool::Reset()
+	{
+		num = 0;
+
+		// Generation 0 is never valid, so on wrap-around clear stale stamps once.
+		if (++generation == 0)
+		{
+			std::fill(slots.begin(), slots.end(), NodeSlot());
+			generation = 1;
+		}
+	}
+
+	void NodePool::Grow()
+	{
+		const size_t capacity = std::max<size_t>(tiles.size() * 2, SearchPolicy::NodePoolSize);
+
+		tiles.resize(capacity);
+		costs.resize(capacity);
+		totalCosts.resize(capacity);
+		parents.resize(capacity);
+		depths.resize(capacity);
+		heapIndices.resize(capacity);
+		flags.resize(capacity);
+		colors.resize(capacity);
+	}
+
+	NodeSorter::NodeSorter(const NodePool& InNodePool, NodeSortKey InSortKey)
+			: nodePool(InNodePool), sortKey(InSortKey)
+	{}
+
+	bool NodeSorter::operator()(int32_t lhs, int32_t rhs) const
+	{
+		const int32_t lhsKey = GetKey(lhs);
+		const int32_t rhsKey = GetKey(rhs);
+
+		if (lhsKey != rhsKey || sortKey == NodeSortKey::Cost)
+		{
+			return lhsKey < rhsKey;
+		}
+
+		// Same total cost, so the node closer to the goal is the better guess.
+		return nodePool.costs[lhs] > nodePool.costs[rhs];
+	}
+
+	void BucketQueue::Push(int32_t index, int32_t key)
+	{
+		assert(key >= 0);
+
+		if (key >= static_cast<int32_t>(buckets.size()))
+		{
+			buckets.resize(key + 1);
+		}
+
+		buckets[key].push_back(index);
+		maxKey = std::max(maxKey, key);
+
+		if (num == 0 || key < minKey)
+		{
+			minKey = key;
+		}
+
+		++num;
+	}
+
+	int32_t BucketQueue::Pop()
+	{
+		std::vector<int32_t>& bucket = buckets[minKey];
+		const int32_t index = bucket.back();
+		bucket.pop_back();
+
+		// Move on to the next non-empty bucket.
+		if (--num > 0)
+		{
+			while (buckets[minKey].empty())
+			{
+				++minKey;
+			}
+		}
+
+		return index;
+	}
+
+	void BucketQueue::Reset()
+	{
+		for (int32_t key = 0; key <= maxKey; ++key)
+		{
+			buckets[key].clear();
+		}
+
+		minKey = 0;
+		maxKey = -1;
+		num = 0;
+	}
+
+	OpenList::OpenList(NodePool& InNodePool, const NodeSorter& InNodeSorter)
+			: nodePool(InNodePool), nodeSorter(InNodeSorter)
+	{
+		heap.reserve(SearchPolicy::OpenSetSize);
+	}
+
+	void OpenList::Push(int32_t node)
+	{
+		if (type == OpenListType::Buckets)
+		{
+			buckets.Push(node, nodeSorter.GetKey(node));
+		}
+		else
+		{
+			heap.push_back(node);
+			SiftUp(static_cast<int32_t>(heap.size()) - 1);
+		}
+
+		nodePool.SetOpened(node, true);
+		++openNum;
+
+#if AK_PATHFINDING_METRICS
+		++pushCount;
+#endif
+	}
+
+	void OpenList::Update(int32_t node)
+	{
+		if (type == OpenListType::Buckets)
+		{
+			// The old entry becomes stale, its key no longer matches.
+			buckets.Push(node, nodeSorter.GetKey(node));
+		}
+		else
+		{
+			SiftUp(nodePool.heapIndices[node]);
+		}
+	}
+
+	int32_t OpenList::PopIndex()
+	{
+		int32_t searchNodeIndex = InvalidIndex;
+
+		if (type == OpenListType::Buckets)
+		{
+			PurgeStaleBuckets();
+			searchNodeIndex = buckets.Pop();
+		}
+		else
+		{
+			searchNodeIndex = heap.front();
+
+			const int32_t lastIndex = heap.back();
+			heap.pop_back();
+
+			if (heap.empty() == false)
+			{
+				heap.front() = lastIndex;
+				nodePool.heapIndices[lastIndex] = 0;
+				SiftDown(0);
+			}
+		}
+
+		nodePool.SetOpened(searchNodeIndex, false);
+		nodePool.heapIndices[searchNodeIndex] = InvalidIndex;
+		--openNum;
+
+#if AK_PATHFINDING_METRICS
+		++popCount;
+#endif
+
+		return searchNodeIndex;
+	}
+
+	int32_t OpenList::TopIndex()
+	{
+		if (type == OpenListType::Buckets)
+		{
+			PurgeStaleBuckets();
+			return buckets.Top();
+		}
+
+		return heap.front();
+	}
+
+	void OpenList::Reset()
+	{
+		heap.clear();
+		buckets.Reset();
+		openNum = 0;
+	}
+
+	void OpenList::SiftUp(int32_t heapIndex)
+	{
+		const int32_t searchNodeIndex = heap[heapIndex];
+
+		while (heapIndex > 0)
+		{
+			const int32_t parentHeapIndex = (heapIndex - 1) / 2;
+			const int32_t parentIndex = heap[parentHeapIndex];
+
+			if (nodeSorter(searchNodeIndex, parentIndex) == false)
+			{
+				break;
+			}
+
+			// Move the parent down.
+			heap[heapIndex] = parentIndex;
+			nodePool.heapIndices[parentIndex] = heapIndex;
+			heapIndex = parentHeapIndex;
+		}
+
+		heap[heapIndex] = searchNodeIndex;
+		nodePool.heapIndices[searchNodeIndex] = heapIndex;
+	}
+
+	void OpenList::SiftDown(int32_t heapIndex)
+	{
+		const int32_t searchNodeIndex = heap[heapIndex];
+		const int32_t heapNum = static_cast<int32_t>(heap.size());
+
+		while (true)
+		{
+			int32_t childHeapIndex = heapIndex * 2 + 1;
+
+			if (childHeapIndex >= heapNum)
+			{
+				break;
+			}
+
+			// Pick the better child.
+			if (childHeapIndex + 1 < heapNum && nodeSorter(heap[childHeapIndex + 1], heap[childHeapIndex]))
+			{
+				++childHeapIndex;
+			}
+
+			const int32_t childIndex = heap[childHeapIndex];
+
+			if (nodeSorter(childIndex, searchNodeIndex) == false)
+			{
+				break;
+			}
+
+			// Move the child up.
+			heap[heapIndex] = childIndex;
+			nodePool.heapIndices[childIndex] = heapIndex;
+			heapIndex = childHeapIndex;
+		}
+
+		heap[heapIndex] = searchNodeIndex;
+		nodePool.heapIndices[searchNodeIndex] = heapIndex;
+	}
+
+	void OpenList::PurgeStaleBuckets()
+	{
+		while (buckets.Num() > 0)
+		{
+			const int32_t searchNodeIndex = buckets.Top();
+
+			if (nodePool.IsOpened(searchNodeIndex) && nodeSorter.GetKey(searchNodeIndex) == buckets.TopKey())
+			{
+				return;
+			}
+
+			buckets.Pop();
+		}
+	}
+
+	bool NodeTester::Test_None(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool bPassable)
+	{
+		return NoneTest()(nodePool, parentNode, neighborNode, bPassable);
+	}
+
+	bool NodeTester::Test_Block(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool bPassable)
+	{
+		return BlockTest()(nodePool, parentNode, neighborNode, bPassable);
+	}
+
+	bool NodeTester::Test_Height(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool bPassable)
+	{
+		return HeightTest()(nodePool, parentNode, neighborNode, bPassable);
+	}
+}
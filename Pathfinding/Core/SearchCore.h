@@ -0,0 +1,300 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "PathGrid.h"
+
+namespace AkPathfinding
+{
+	// Same reservation sizes as FGraphAStarDefaultPolicy.
+	struct SearchPolicy
+	{
+		static constexpr int32_t NodePoolSize = 64;
+		static constexpr int32_t OpenSetSize = 64;
+	};
+	
+	// Counters of the last query.
+	struct SearchStats
+	{
+		int64_t nodesExpanded = 0;
+
+		// Bytes of node data the query filled in.
+		int64_t nodeBytes = 0;
+
+		void Reset() { *this = SearchStats(); }
+	};
+	
+	namespace NodeFlags
+	{
+		constexpr uint8_t Opened = 1;
+		constexpr uint8_t Closed = 2;
+
+		// Cached from the adjacency when the node is added.
+		constexpr uint8_t Blocked = 4;
+	}
+
+	/*!
+	 * \brief Nodes of a single search, stored as parallel arrays indexed by node.
+	 *
+	 *		  Sorting and relaxing mostly read costs, so each field has its own array
+	 *		  and a cache line holds the costs of sixteen nodes instead of one or two whole nodes.
+	 *		  Arrays only grow, and keep their storage across Reset().
+	 *
+	 *		  Tile to node lookup goes through a slot per grid tile.
+	 *		  A slot refers to a node only if its generation matches the pool's,
+	 *		  so Reset() doesn't need to touch the slot table.
+	 */
+	class NodePool
+	{
+	public:
+		NodePool();
+
+		// Must be called before any search, and again if the tile count of the grid changes.
+		void Initialize(const AdjacencyTable* InAdjacency);
+
+		// Return the index of the new node.
+		int32_t Add(int32_t tile);
+		int32_t FindOrAdd(int32_t tile);
+
+		// InvalidIndex if the tile has no node in the current search.
+		int32_t Find(int32_t tile) const;
+
+		void Reset();
+
+		// Read blocking and color of the node's tile again, after the adjacency was rebuilt for it.
+		void RefreshTileData(int32_t node);
+
+		int32_t Num() const { return num; }
+
+		// Bytes of node data the current search uses.
+		int64_t GetNodeBytes() const { return static_cast<int64_t>(num) * BytesPerNode; }
+
+		bool IsOpened(int32_t node) const { return (flags[node] & NodeFlags::Opened) != 0; }
+		bool IsClosed(int32_t node) const { return (flags[node] & NodeFlags::Closed) != 0; }
+		bool IsBlocked(int32_t node) const { return (flags[node] & NodeFlags::Blocked) != 0; }
+
+		void SetOpened(int32_t node, bool bOpened) { SetFlag(node, NodeFlags::Opened, bOpened); }
+		void SetClosed(int32_t node, bool bClosed) { SetFlag(node, NodeFlags::Closed, bClosed); }
+
+	public:
+		std::vector<int32_t> tiles;
+
+		std::vector<int32_t> costs;
+		std::vector<int32_t> totalCosts;
+		std::vector<int32_t> parents;
+
+		// Number of steps from the origin of the search. InvalidIndex until reached.
+		std::vector<int32_t> depths;
+
+		// Position in the binary heap of the open list while opened.
+		std::vector<int32_t> heapIndices;
+
+		std::vector<uint8_t> flags;
+
+		// Cached from the adjacency when the node is added.
+		std::vector<uint8_t> colors;
+
+		static constexpr int32_t BytesPerNode = 6 * sizeof(int32_t) + 2 * sizeof(uint8_t);
+
+	private:
+		void Grow();
+
+		void SetFlag(int32_t node, uint8_t flag, bool bSet)
+		{
+			flags[node] = bSet ? (flags[node] | flag) : (flags[node] & ~flag);
+		}
+
+	private:
+		struct NodeSlot
+		{
+			uint32_t generation = 0;
+			int32_t index = InvalidIndex;
+		};
+
+		const AdjacencyTable* Adjacency = nullptr;
+		int32_t num = 0;
+
+		std::vector<NodeSlot> slots;
+		uint32_t generation = 1;
+	};
+
+	enum class NodeSortKey : uint8_t
+	{
+		// Cost so far, for Dijkstra.
+		Cost,
+		// Cost so far plus heuristic, for A*. Ties go to the deeper node.
+		TotalCost,
+	};
+
+	struct NodeSorter
+	{
+		const NodePool& nodePool;
+		const NodeSortKey sortKey;
+
+		NodeSorter(const NodePool& InNodePool, NodeSortKey InSortKey = NodeSortKey::Cost);
+		bool operator()(int32_t lhs, int32_t rhs) const;
+
+		// Priority of the node, lower first.
+		int32_t GetKey(int32_t index) const { return sortKey == NodeSortKey::TotalCost ? nodePool.totalCosts[index] : nodePool.costs[index]; }
+	};
+
+	/*!
+	 * \brief Bucket queue of node indices for small non-negative integer keys (Dial's algorithm).
+	 *
+	 *		  Push and pop are O(1) plus the scan over empty buckets, which is bounded by the step cost
+	 *		  as long as keys are popped in increasing order. Pushing a key below the current minimum is allowed.
+	 *		  Nodes of the same key pop last in, first out.
+	 */
+	class BucketQueue
+	{
+	public:
+		void Push(int32_t index, int32_t key);
+		int32_t Pop();
+		int32_t Top() const { return buckets[minKey].back(); }
+		int32_t TopKey() const { return minKey; }
+
+		void Reset();
+		int32_t Num() const { return num; }
+
+	private:
+		// Buckets keep their capacity between searches.
+		std::vector<std::vector<int32_t>> buckets;
+
+		// Lowest non-empty bucket, if any.
+		int32_t minKey = 0;
+
+		// Highest bucket touched since the last Reset().
+		int32_t maxKey = -1;
+
+		int32_t num = 0;
+	};
+
+	enum class OpenListType : uint8_t
+	{
+		BinaryHeap,
+		Buckets,
+	};
+
+	/*!
+	 * \brief Open nodes ordered by NodeSorter, stored in a binary heap or a bucket queue.
+	 *
+	 *		  When the key of an opened node drops, Update() must be called.
+	 *		  The heap sifts the node up from its tracked position.
+	 *		  The bucket queue pushes it again and skips the stale entry when it comes up.
+	 */
+	class OpenList
+	{
+	public:
+		OpenList(NodePool& InNodePool, const NodeSorter& InNodeSorter);
+
+		// Must be empty when the type changes.
+		void SetType(OpenListType InType) { type = InType; }
+		OpenListType GetType() const { return type; }
+
+		void Push(int32_t node);
+		void Update(int32_t node);
+		int32_t PopIndex();
+		int32_t TopIndex();
+		
+		void Reset();
+
+		// Number of opened nodes.
+		int32_t Num() const { return openNum; }
+
+#if AK_PATHFINDING_METRICS
+		// Since the list was created, so a query reads the difference.
+		int64_t GetPushCount() const { return pushCount; }
+		int64_t GetPopCount() const { return popCount; }
+#endif
+
+	private:
+		void SiftUp(int32_t heapIndex);
+		void SiftDown(int32_t heapIndex);
+
+		void PurgeStaleBuckets();
+
+	private:
+		NodePool& nodePool;
+		const NodeSorter nodeSorter;
+		OpenListType type = OpenListType::BinaryHeap;
+
+		std::vector<int32_t> heap;
+		BucketQueue buckets;
+
+		int32_t openNum = 0;
+
+#if AK_PATHFINDING_METRICS
+		int64_t pushCount = 0;
+		int64_t popCount = 0;
+#endif
+	};
+
+	// bPassable is the height rule of the step from the parent to the neighbor, read from TileLinks.
+	namespace NodeTester
+	{
+		bool Test_None(const NodePool&, int32_t, int32_t, bool);
+		bool Test_Block(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool);
+		bool Test_Height(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool bPassable);
+	}
+
+	typedef bool (*NodeBlockTest)(const NodePool&, int32_t, int32_t, bool);
+
+	// Same tests as types, so a search loop compiled per tester inlines the test instead of calling through a pointer.
+	namespace NodeTester
+	{
+		struct NoneTest
+		{
+			bool operator()(const NodePool&, int32_t, int32_t, bool) const { return true; }
+		};
+
+		struct BlockTest
+		{
+			bool operator()(const NodePool& nodePool, int32_t, int32_t neighborNode, bool) const { return nodePool.IsBlocked(neighborNode) == false; }
+		};
+
+		struct HeightTest
+		{
+			bool operator()(const NodePool& nodePool, int32_t, int32_t neighborNode, bool bPassable) const { return nodePool.IsBlocked(neighborNode) == false && bPassable; }
+		};
+
+		// Any other test, called through the pointer.
+		struct IndirectTest
+		{
+			NodeBlockTest nodeBlockTest;
+
+			bool operator()(const NodePool& nodePool, int32_t parentNode, int32_t neighborNode, bool bPassable) const { return (*nodeBlockTest)(nodePool, parentNode, neighborNode, bPassable); }
+		};
+	}
+
+	/*!
+	 * \brief Call the function with the tester type of the test, so it runs the loop compiled for that tester.
+	 *
+	 * \param function
+	 *		  Generic callable taking the tester by value.
+	 */
+	template <typename Function>
+	auto WithNodeTester(NodeBlockTest nodeBlockTest, Function&& function)
+	{
+		if (nodeBlockTest == &NodeTester::Test_Height)
+		{
+			return function(NodeTester::HeightTest());
+		}
+
+		if (nodeBlockTest == &NodeTester::Test_Block)
+		{
+			return function(NodeTester::BlockTest());
+		}
+
+		if (nodeBlockTest == &NodeTester::Test_None)
+		{
+			return function(NodeTester::NoneTest());
+		}
+
+		return function(NodeTester::IndirectTest { nodeBlockTest });
+	}
+}
@@ -0,0 +1,301 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SearchMetrics.h"
+
+#if AK_PATHFINDING_METRICS
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace AkPathfinding
+{
+	namespace
+	{
+		const char* const CounterNames[] = { "expanded", "generated", "pushes", "pops", "nanoseconds" };
+
+		bool IsFaster(const QueryRecord& a, const QueryRecord& b)
+		{
+			return a.nanoseconds > b.nanoseconds;
+		}
+	}
+
+	const char* ToString(QueryKind kind)
+	{
+		switch (kind)
+		{
+		case QueryKind::Path: return "Path";
+		case QueryKind::BidirectionalPath: return "BidirectionalPath";
+		case QueryKind::MultiGoalPath: return "MultiGoalPath";
+		case QueryKind::Range: return "Range";
+		case QueryKind::RangeFlood: return "RangeFlood";
+		case QueryKind::ReachableDestinations: return "ReachableDestinations";
+		default: return "Unknown";
+		}
+	}
+
+	void Histogram::Add(int64_t value)
+	{
+		value = std::max<int64_t>(value, 0);
+
+		int32_t bucket = 0;
+
+		while (bucket < BucketCount - 1 && (value >> bucket) != 0)
+		{
+			++bucket;
+		}
+
+		++buckets[bucket];
+		++count;
+		sum += value;
+		max = std::max(max, value);
+	}
+
+	int64_t Histogram::GetPercentile(double fraction) const
+	{
+		const int64_t rank = static_cast<int64_t>(fraction * count);
+		int64_t below = 0;
+
+		for (int32_t bucket = 0; bucket < BucketCount; ++bucket)
+		{
+			below += buckets[bucket];
+
+			if (below > rank)
+			{
+				return std::min(bucket == 0 ? 0 : (int64_t(1) << bucket) - 1, max);
+			}
+		}
+
+		return max;
+	}
+
+	SearchMetrics& SearchMetrics::Get()
+	{
+		static SearchMetrics metrics;
+		return metrics;
+	}
+
+	void SearchMetrics::SetMapLabel(const std::string& label)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const auto found = std::find(mapLabels.begin(), mapLabels.end(), label);
+		mapLabel = static_cast<int32_t>(found - mapLabels.begin());
+
+		if (found == mapLabels.end())
+		{
+			mapLabels.push_back(label);
+		}
+	}
+
+	void SearchMetrics::Record(QueryRecord record)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		record.mapLabel = mapLabel;
+
+		KindMetrics& metrics = kinds[static_cast<int32_t>(record.kind)];
+		metrics.histograms[Expanded].Add(record.nodesExpanded);
+		metrics.histograms[Generated].Add(record.nodesGenerated);
+		metrics.histograms[Pushes].Add(record.openPushes);
+		metrics.histograms[Pops].Add(record.openPops);
+		metrics.histograms[Nanoseconds].Add(record.nanoseconds);
+
+		if (record.nodesGenerated > SearchPolicy::NodePoolSize)
+		{
+			++metrics.poolOverflows;
+		}
+
+		if (static_cast<int32_t>(slowest.size()) < SlowestQueryNum)
+		{
+			slowest.push_back(record);
+			std::push_heap(slowest.begin(), slowest.end(), IsFaster);
+		}
+		else if (record.nanoseconds > slowest.front().nanoseconds)
+		{
+			std::pop_heap(slowest.begin(), slowest.end(), IsFaster);
+			slowest.back() = record;
+			std::push_heap(slowest.begin(), slowest.end(), IsFaster);
+		}
+
+		if (static_cast<int32_t>(traceEvents.size()) < MaxTraceEvents)
+		{
+			traceEvents.push_back(record);
+		}
+	}
+
+	void SearchMetrics::Reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		origin = std::chrono::steady_clock::now();
+
+		for (KindMetrics& metrics : kinds)
+		{
+			metrics = KindMetrics();
+		}
+
+		slowest.clear();
+		traceEvents.clear();
+	}
+
+	int64_t SearchMetrics::Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	void SearchMetrics::WriteHistograms(std::ostream& stream) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		stream << "kind,counter,count,mean,p50,p90,p99,max,pool_overflows";
+
+		for (int32_t bucket = 0; bucket < Histogram::BucketCount; ++bucket)
+		{
+			stream << ",le_" << (bucket == 0 ? 0 : (int64_t(1) << bucket) - 1);
+		}
+
+		stream << '\n';
+
+		for (int32_t kind = 0; kind < static_cast<int32_t>(QueryKind::Count); ++kind)
+		{
+			const KindMetrics& metrics = kinds[kind];
+
+			if (metrics.histograms[Nanoseconds].count == 0)
+			{
+				continue;
+			}
+
+			for (int32_t counter = 0; counter < CounterCount; ++counter)
+			{
+				const Histogram& histogram = metrics.histograms[counter];
+
+				stream << ToString(static_cast<QueryKind>(kind)) << ',' << CounterNames[counter]
+					<< ',' << histogram.count
+					<< ',' << static_cast<double>(histogram.sum) / histogram.count
+					<< ',' << histogram.GetPercentile(0.5)
+					<< ',' << histogram.GetPercentile(0.9)
+					<< ',' << histogram.GetPercentile(0.99)
+					<< ',' << histogram.max
+					<< ',' << metrics.poolOverflows;
+
+				for (const int64_t bucketCount : histogram.buckets)
+				{
+					stream << ',' << bucketCount;
+				}
+
+				stream << '\n';
+			}
+		}
+	}
+
+	void SearchMetrics::WriteSlowestQueries(std::ostream& stream) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<QueryRecord> records = slowest;
+		std::sort(records.begin(), records.end(), IsFaster);
+
+		stream << "kind,map,start,goal,nanoseconds,expanded,generated,pushes,pops\n";
+
+		for (const QueryRecord& record : records)
+		{
+			stream << ToString(record.kind)
+				<< ',' << (record.mapLabel < static_cast<int32_t>(mapLabels.size()) ? mapLabels[record.mapLabel] : std::string())
+				<< ',' << record.start
+				<< ',' << record.goal
+				<< ',' << record.nanoseconds
+				<< ',' << record.nodesExpanded
+				<< ',' << record.nodesGenerated
+				<< ',' << record.openPushes
+				<< ',' << record.openPops
+				<< '\n';
+		}
+	}
+
+	void SearchMetrics::WriteTrace(std::ostream& stream) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Complete events, in microseconds.
+		stream << "{\"traceEvents\":[";
+
+		for (size_t i = 0; i < traceEvents.size(); ++i)
+		{
+			const QueryRecord& record = traceEvents[i];
+
+			stream << (i == 0 ? "\n" : ",\n")
+				<< "{\"name\":\"" << ToString(record.kind) << "\",\"cat\":\"pathfinding\",\"ph\":\"X\""
+				<< ",\"ts\":" << record.startNanoseconds / 1000.0
+				<< ",\"dur\":" << record.nanoseconds / 1000.0
+				<< ",\"pid\":0,\"tid\":" << record.thread
+				<< ",\"args\":{\"start\":" << record.start
+				<< ",\"goal\":" << record.goal
+				<< ",\"expanded\":" << record.nodesExpanded
+				<< ",\"generated\":" << record.nodesGenerated
+				<< ",\"pushes\":" << record.openPushes
+				<< ",\"pops\":" << record.openPops
+				<< "}}";
+		}
+
+		stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	}
+
+	int64_t SearchMetrics::GetQueryCount(QueryKind kind) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return kinds[static_cast<int32_t>(kind)].histograms[Nanoseconds].count;
+	}
+
+	int64_t SearchMetrics::GetPoolOverflowCount(QueryKind kind) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return kinds[static_cast<int32_t>(kind)].poolOverflows;
+	}
+
+	QueryScope::QueryScope(QueryKind kind, int32_t start, int32_t goal, const SearchStats& InStats, const NodePool* InNodePool, const OpenList* InOpenList)
+		: Stats(InStats)
+		, Pool(InNodePool)
+		, List(InOpenList)
+	{
+		record.kind = kind;
+		record.start = start;
+		record.goal = goal;
+
+		// Start values, subtracted again at the end.
+		record.nodesExpanded = Stats.nodesExpanded;
+
+		if (List != nullptr)
+		{
+			record.openPushes = List->GetPushCount();
+			record.openPops = List->GetPopCount();
+		}
+
+		record.startNanoseconds = SearchMetrics::Get().Now();
+	}
+
+	QueryScope::~QueryScope()
+	{
+		SearchMetrics& metrics = SearchMetrics::Get();
+
+		record.nanoseconds = metrics.Now() - record.startNanoseconds;
+		record.nodesExpanded = Stats.nodesExpanded - record.nodesExpanded;
+
+		if (Pool != nullptr)
+		{
+			record.nodesGenerated = Pool->Num();
+		}
+
+		if (List != nullptr)
+		{
+			record.openPushes = List->GetPushCount() - record.openPushes;
+			record.openPops = List->GetPopCount() - record.openPops;
+		}
+
+		record.thread = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+		metrics.Record(record);
+	}
+}
+
+#endif
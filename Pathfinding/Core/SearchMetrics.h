@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "PathGrid.h"
+
+#if AK_PATHFINDING_METRICS
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	enum class QueryKind : uint8_t
+	{
+		Path,
+		BidirectionalPath,
+		MultiGoalPath,
+		Range,
+		RangeFlood,
+		ReachableDestinations,
+		Count,
+	};
+
+	const char* ToString(QueryKind kind);
+
+	// Counters of a single query.
+	struct QueryRecord
+	{
+		QueryKind kind = QueryKind::Path;
+		int32_t start = InvalidIndex;
+		// Destination of a path, goal count of a multi goal path, distance of a range.
+		int32_t goal = InvalidIndex;
+
+		int64_t nodesExpanded = 0;
+		// Nodes added to the pool. Pools only grow during a query, so it is also the peak size.
+		int64_t nodesGenerated = 0;
+		int64_t openPushes = 0;
+		int64_t openPops = 0;
+
+		// Since the metrics were reset.
+		int64_t startNanoseconds = 0;
+		int64_t nanoseconds = 0;
+
+		uint32_t thread = 0;
+		int32_t mapLabel = 0;
+	};
+
+	// Values counted in power of two buckets. Bucket 0 holds zero, bucket i the values in [2^(i-1), 2^i).
+	struct Histogram
+	{
+		static constexpr int32_t BucketCount = 48;
+
+		int64_t buckets[BucketCount] = {};
+		int64_t count = 0;
+		int64_t sum = 0;
+		int64_t max = 0;
+
+		void Add(int64_t value);
+
+		// Upper bound of the bucket holding the fraction of values, clamped to the max.
+		int64_t GetPercentile(double fraction) const;
+	};
+
+	/*!
+	 * \brief Histograms of the counters of every query, per kind of query, and the slowest queries.
+	 *
+	 *		  Only built with AK_PATHFINDING_METRICS. Queries record themselves through AK_PATHFINDING_QUERY_SCOPE.
+	 *		  Searches run on any thread, so recording takes a lock; the counters themselves are kept by the search.
+	 */
+	class SearchMetrics
+	{
+	public:
+		static SearchMetrics& Get();
+
+		// Name of the map the following queries run on, kept with the slowest ones.
+		void SetMapLabel(const std::string& label);
+
+		void Record(QueryRecord record);
+		void Reset();
+
+		// Nanoseconds since the metrics were reset.
+		int64_t Now() const;
+
+		/*!
+		 * \brief CSV with a row per counter of each kind of query.
+		 *		  Count, mean, percentiles and max, then the count of every bucket.
+		 */
+		void WriteHistograms(std::ostream& stream) const;
+
+		// CSV of the slowest queries, with their map and tiles.
+		void WriteSlowestQueries(std::ostream& stream) const;
+
+		// Trace events of the first queries since the reset, for chrome://tracing or Perfetto.
+		void WriteTrace(std::ostream& stream) const;
+
+		int64_t GetQueryCount(QueryKind kind) const;
+		// Queries generating more nodes than SearchPolicy::NodePoolSize, which outgrow the reserved pool.
+		int64_t GetPoolOverflowCount(QueryKind kind) const;
+
+		static constexpr int32_t SlowestQueryNum = 64;
+		static constexpr int32_t MaxTraceEvents = 1 << 16;
+
+	private:
+		enum Counter
+		{
+			Expanded,
+			Generated,
+			Pushes,
+			Pops,
+			Nanoseconds,
+			CounterCount,
+		};
+
+		struct KindMetrics
+		{
+			Histogram histograms[CounterCount];
+			int64_t poolOverflows = 0;
+		};
+
+		mutable std::mutex mutex;
+		std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+		std::vector<std::string> mapLabels;
+		int32_t mapLabel = 0;
+
+		KindMetrics kinds[static_cast<int32_t>(QueryKind::Count)];
+
+		// Min heap on the time, so the fastest of the slowest is replaced.
+		std::vector<QueryRecord> slowest;
+		std::vector<QueryRecord> traceEvents;
+	};
+
+	/*!
+	 * \brief Times a query and records the counters of its search when it goes out of scope.
+	 *
+	 *		  The counters are read as the difference from the start, so stats must not be reset inside the scope.
+	 *		  Pool and list may be null for queries without them.
+	 */
+	class QueryScope
+	{
+	public:
+		QueryScope(QueryKind kind, int32_t start, int32_t goal, const SearchStats& InStats, const NodePool* InNodePool, const OpenList* InOpenList);
+		~QueryScope();
+
+		QueryScope(const QueryScope&) = delete;
+		QueryScope& operator=(const QueryScope&) = delete;
+
+	private:
+		QueryRecord record;
+
+		const SearchStats& Stats;
+		const NodePool* Pool;
+		const OpenList* List;
+	};
+}
+
+#define AK_PATHFINDING_QUERY_SCOPE(kind, start, goal, stats, nodePool, openList) \
+	const AkPathfinding::QueryScope AkQueryScope(kind, start, goal, stats, nodePool, openList)
+
+#else
+
+#define AK_PATHFINDING_QUERY_SCOPE(kind, start, goal, stats, nodePool, openList)
+
+#endif
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "SearchCore.h"
+
+namespace AkPathfinding
+{
+	// A search with the buffer its query writes tiles to.
+	template <typename SearchType>
+	struct SearchContext
+	{
+		SearchType search;
+		std::vector<int32_t> tiles;
+	};
+
+	/*!
+	 * \brief Search contexts for queries running concurrently on the same AdjacencyTable.
+	 *
+	 *		  A query borrows a context with Acquire() and gives it back when the handle goes out of scope.
+	 *		  Contexts are created on demand and reused, so node storage is allocated once per concurrent query.
+	 *		  The table is read only while queries run: rebuild it, initialize the pool or change the open list type
+	 *		  only when no context is borrowed.
+	 */
+	template <typename SearchType>
+	class SearchPool
+	{
+	public:
+		using Context = SearchContext<SearchType>;
+
+		class Handle
+		{
+		public:
+			Handle(SearchPool& InPool, std::unique_ptr<Context> InContext)
+					: pool(&InPool), context(std::move(InContext))
+			{}
+
+			Handle(Handle&& other) = default;
+			Handle& operator=(Handle&& other) = delete;
+
+			~Handle()
+			{
+				if (context)
+				{
+					pool->Release(std::move(context));
+				}
+			}
+
+			Context* operator->() const { return context.get(); }
+			Context& operator*() const { return *context; }
+
+		private:
+			SearchPool* pool;
+			std::unique_ptr<Context> context;
+		};
+
+		void Initialize(const AdjacencyTable* InAdjacency)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			Adjacency = InAdjacency;
+
+			for (std::unique_ptr<Context>& context : freeContexts)
+			{
+				context->search.Initialize(Adjacency);
+			}
+		}
+
+		void SetOpenListType(OpenListType type)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			openListType = type;
+
+			for (std::unique_ptr<Context>& context : freeContexts)
+			{
+				context->search.SetOpenListType(openListType);
+			}
+		}
+
+		Handle Acquire()
+		{
+			const AdjacencyTable* adjacency = nullptr;
+			OpenListType type = OpenListType::BinaryHeap;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (freeContexts.empty() == false)
+				{
+					std::unique_ptr<Context> context = std::move(freeContexts.back());
+					freeContexts.pop_back();
+
+					return Handle(*this, std::move(context));
+				}
+
+				adjacency = Adjacency;
+				type = openListType;
+			}
+
+			// Set up a new one outside the lock, node storage takes a while for big grids.
+			std::unique_ptr<Context> context(new Context());
+			context->search.Initialize(adjacency);
+			context->search.SetOpenListType(type);
+
+			return Handle(*this, std::move(context));
+		}
+
+	private:
+		void Release(std::unique_ptr<Context> context)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeContexts.push_back(std::move(context));
+		}
+
+	private:
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Context>> freeContexts;
+
+		const AdjacencyTable* Adjacency = nullptr;
+		OpenListType openListType = OpenListType::BinaryHeap;
+	};
+}
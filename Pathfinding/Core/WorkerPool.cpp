@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WorkerPool.h"
+
+namespace AkPathfinding
+{
+	WorkerPool::WorkerPool(int32_t workerCount)
+	{
+		workers.reserve(workerCount);
+
+		for (int32_t i = 0; i < workerCount; ++i)
+		{
+			workers.emplace_back(&WorkerPool::WorkerLoop, this);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bStopping = true;
+		}
+
+		startCondition.notify_all();
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	void WorkerPool::ParallelFor(int32_t count, const std::function<void(int32_t)>& InBody)
+	{
+		std::lock_guard<std::mutex> callLock(callMutex);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			body = &InBody;
+			itemCount = count;
+			nextItem.store(0, std::memory_order_relaxed);
+
+			busyWorkers = GetWorkerCount();
+			++generation;
+		}
+
+		startCondition.notify_all();
+
+		// Help instead of waiting.
+		RunItems();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+
+		body = nullptr;
+	}
+
+	int32_t WorkerPool::DefaultWorkerCount()
+	{
+		const int32_t hardwareThreads = static_cast<int32_t>(std::thread::hardware_concurrency());
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	void WorkerPool::WorkerLoop()
+	{
+		uint64_t seenGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				startCondition.wait(lock, [&] { return bStopping || generation != seenGeneration; });
+
+				if (bStopping)
+				{
+					return;
+				}
+
+				seenGeneration = generation;
+			}
+
+			RunItems();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (--busyWorkers == 0)
+				{
+					doneCondition.notify_one();
+				}
+			}
+		}
+	}
+
+	void WorkerPool::RunItems()
+	{
+		for (int32_t item = nextItem.fetch_add(1, std::memory_order_relaxed); item < itemCount; item = nextItem.fetch_add(1, std::memory_order_relaxed))
+		{
+			(*body)(item);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AkPathfinding
+{
+	/*!
+	 * \brief Persistent worker threads for ParallelFor outside the engine.
+	 *
+	 *		  Workers and the calling thread take indices from a shared atomic counter,
+	 *		  so a slow item never holds up the others queued behind it.
+	 *		  In the engine, use ParallelFor of the task graph instead.
+	 */
+	class WorkerPool
+	{
+	public:
+		// Threads besides the calling one. 0 runs everything on the calling thread.
+		explicit WorkerPool(int32_t workerCount = DefaultWorkerCount());
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// Run body for every index in [0, count) and return when all are done. One call at a time.
+		void ParallelFor(int32_t count, const std::function<void(int32_t)>& body);
+
+		int32_t GetWorkerCount() const { return static_cast<int32_t>(workers.size()); }
+
+		// One worker per hardware thread besides the calling one.
+		static int32_t DefaultWorkerCount();
+
+	private:
+		void WorkerLoop();
+		void RunItems();
+
+	private:
+		std::vector<std::thread> workers;
+
+		std::mutex callMutex;
+
+		std::mutex mutex;
+		std::condition_variable startCondition;
+		std::condition_variable doneCondition;
+
+		const std::function<void(int32_t)>* body = nullptr;
+		int32_t itemCount = 0;
+		std::atomic<int32_t> nextItem { 0 };
+
+		uint64_t generation = 0;
+		int32_t busyWorkers = 0;
+		bool bStopping = false;
+	};
+}
@@ -7,225 +7,70 @@
 void UMovementRange::Initialize(UHexGrid* InHexGrid)
 {
 	HexGrid = InHexGrid;
-	nodePool.HexGrid = HexGrid;
+	GridView = FHexGridView::FindOrCreate(HexGrid);
+
+	Searches.Initialize(&GridView->GetAdjacency());
+	Cache.Initialize(&GridView->GetAdjacency());
 }
 
-void UMovementRange::GetMovementRange(const FIntPoint& position, int32 distance, TArray<FIntPoint>& OutMovablePoints, EAkElementType InElementType, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination)
+void UMovementRange::SetOpenListType(AkPathfinding::OpenListType type)
 {
-	const uint8 ElementType = ElementMask::MapColor(InElementType);
-	start = position;
+	Searches.SetOpenListType(type);
+}
 
-	int destinationColor = ElementType;
-	int pathColor = ElementType | ElementMask::Stone;
-	
-	if (lightningSpecial)
-	{
-		destinationColor |= ElementMask::Stone;
-	}
+void UMovementRange::NotifyTilesChanged(const TArray<FIntPoint>& Positions)
+{
+	GridView->NotifyTilesChanged(Positions);
+	SyncGrid();
+}
 
-	if (allowWaterType)
-	{
-		destinationColor |= ElementMask::Water;
-		pathColor |= ElementMask::Water;
-	}
+void UMovementRange::RefreshGrid()
+{
+	GridView->RefreshAdjacency();
+	SyncGrid();
+}
 
-	if (allowAnyDestination)
+void UMovementRange::SyncGrid()
+{
+	if (IsInGameThread() == false)
 	{
-		GetTilesInRange(position, distance, OutMovablePoints, ElementMask::Any, pathColor, &NodeTester::Test_Height);
 		return;
 	}
 
-	GetTilesInRange(position, distance, OutMovablePoints, destinationColor, pathColor, &NodeTester::Test_Height);
-	
-	for (int i = 0; i < OutMovablePoints.Num(); ++i)
+	FScopeLock Lock(&CacheLock);
+
+	// Ranges are valid for the stamp the cache last caught up with.
+	if (Cache.GetVersion() != GridView->GetStamp())
 	{
-		const FIntPoint& pos = OutMovablePoints[i];
-		
-		if (ReachableTileExist(pos, distance - nodePool.FindOrAdd(pos).cost, OutMovablePoints, destinationColor, &NodeTester::Test_Height) == false)
-		{
-			OutMovablePoints.RemoveAt(i);
-			--i;
-		}
+		GridView->GetChangedTilesSince(Cache.GetVersion(), GridChangedTiles);
+		Cache.NotifyTilesChanged(GridChangedTiles);
 	}
 }
 
-void UMovementRange::GetTilesInRange(const FIntPoint& position, int32 distance, TArray<FIntPoint>& OutMovablePoints, uint8 destinationColor, uint8 pathColor, NodeBlockTest nodeBlockTest)
+void UMovementRange::GetMovementRange(const FIntPoint& position, int32 distance, TArray<FIntPoint>& OutMovablePoints, EAkElementType InElementType, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination)
 {
-	// Reset all containers.
-	nodePool.Reset();
-	openList.Reset();
-	OutMovablePoints.Reset();
-
-	// Push start node and kick off the search.
-	SearchNode& startNode = nodePool.Add(position);
-	startNode.cost = 0;
-	
-	openList.Push(startNode);
-
-	// Do search.
-	while (openList.Num() > 0)
-	{
-		const int32 currNodeIndex = openList.PopIndex();
-		SearchNode& currNodeUnsafe = nodePool[currNodeIndex];
-		currNodeUnsafe.bIsClosed = true;
-
-		// Minimum cost node is not reachable.
-		if (currNodeUnsafe.cost > distance)
-		{
-			// Done.
-			return;
-		}
-
-		const FIntPoint& currNodePos = currNodeUnsafe.position;
-
-		// Don't need to check initial node.
-		if (currNodePos != position)
-		{
-			// It is destination node.
-			if (currNodeUnsafe.cost == distance)
-			{
-				if ((ElementMask::MapColor(currNodeUnsafe.tileData->TopType) & destinationColor) == 0)
-				{
-					// Not valid color.
-					continue;
-				}
-			}
-			else if ((ElementMask::MapColor(currNodeUnsafe.tileData->TopType) & pathColor) == 0) 
-			{
-				continue;
-			}
-		}
+	AK_PATHFINDING_TRACE_SCOPE(UMovementRange_GetMovementRange);
+	SyncGrid();
 
-		// This node is reachable. Store it.
-		OutMovablePoints.Push(currNodePos);
-
-		// Grab neighbors to expand.
-		THexNeighbors neighbors;
-		const int neighborCount = HexGrid->GetNeighbors(currNodePos, neighbors);
-
-		// Check all neighbors.
-		for (int i = 0; i < neighborCount; ++i)
-		{
-			const FIntPoint& neighborNodePos = neighbors[i];
-			SearchNode& neighborNode = nodePool.FindOrAdd(neighborNodePos);
-
-			// If it is starting point, it is guaranteed to be passable.
-			if (neighborNodePos != position)
-			{
-				// If it isn't, do test.
-				if ((*nodeBlockTest)(currNodeUnsafe, neighborNode, HexGrid) == false)
-				{
-					// Blocked.
-					continue;
-				}
-			}
-			
-			const int32 newCost = currNodeUnsafe.cost + HexGrid->GetCost(currNodePos, neighborNodePos);
-
-			// If this is not better than previous approach,
-			if (newCost >= neighborNode.cost)
-			{
-				// skip.
-				continue;
-			}
-
-			// Fill in.
-			neighborNode.cost = newCost;
-			ensure(newCost > 0);
-			neighborNode.parentPos = currNodePos;
-			neighborNode.parentIndex = currNodeIndex;
-			neighborNode.bIsClosed = false;
-
-			// If this node is not in the open list,
-			if (neighborNode.bIsOpened == false)
-			{
-				// add to the open list.
-				openList.Push(neighborNode);
-			}
-		}
-	}
-}
+	const int32_t tile = GridView->ToIndex(position);
+	const uint8_t elementColor = ElementMask::MapColor(InElementType);
+	const AkPathfinding::QueryKey Key = AkPathfinding::QueryKey::MakeRangeKey(tile, distance, elementColor, allowWaterType, lightningSpecial, allowAnyDestination);
 
-bool UMovementRange::ReachableTileExist(const FIntPoint& position, int32 distance, const TArray<FIntPoint>& Tiles, uint8 ElementType, NodeBlockTest nodeBlockTest) const
-{
-	NodePool pool;
-	pool.HexGrid = HexGrid;
-	
-	NodeSorter sorter = NodeSorter(pool);
-	OpenList list = OpenList(pool, sorter);
-	
-	// Push start node and kick off the search.
-	SearchNode& startNode = pool.Add(position);
-	startNode.cost = 0;
-	
-	list.Push(startNode);
-
-	// Do search.
-	while (list.Num() > 0)
 	{
-		const int32 currNodeIndex = list.PopIndex();
-		SearchNode& currNodeUnsafe = pool[currNodeIndex];
-		currNodeUnsafe.bIsClosed = true;
-
-		// Node having minimum cost is not reachable.
-		if (currNodeUnsafe.cost > distance)
-		{
-			// Done.
-			return false;
-		}
+		FScopeLock Lock(&CacheLock);
 
-		if (ElementType & ElementMask::MapColor(currNodeUnsafe.tileData->TopType))
+		if (const AkPathfinding::QueryCache::Result* Cached = Cache.Find(Key))
 		{
-			return true;
+			GridView->ToPositions(Cached->tiles, OutMovablePoints);
+			return;
 		}
-		
-		const FIntPoint& currNodePos = currNodeUnsafe.position;
+	}
 
-		// Grab neighbors to expand.
-		THexNeighbors neighbors;
-		const int neighborCount = HexGrid->GetNeighbors(currNodePos, neighbors);
+	auto Context = Searches.Acquire();
 
-		// Check all neighbors.
-		for (int i = 0; i < neighborCount; ++i)
-		{
-			const FIntPoint& neighborNodePos = neighbors[i];
-			SearchNode& neighborNode = pool.FindOrAdd(neighborNodePos);
-
-			// If it is starting point, it is guaranteed to be passable.
-			if (neighborNodePos != start)
-			{
-				// If it isn't, do test.
-				if ((*nodeBlockTest)(currNodeUnsafe, neighborNode, HexGrid) == false)
-				{
-					// Blocked.
-					continue;
-				}	
-			}
-						
-			const int32 newCost = currNodeUnsafe.cost + HexGrid->GetCost(currNodePos, neighborNodePos);
-
-			// If this is not better than previous approach,
-			if (newCost >= neighborNode.cost)
-			{
-				// skip.
-				continue;
-			}
-
-			// Fill in.
-			neighborNode.cost = newCost;
-			ensure(newCost > 0);
-			neighborNode.parentPos = currNodePos;
-			neighborNode.parentIndex = currNodeIndex;
-			neighborNode.bIsClosed = false;
-
-			// If this node is not in the open list,
-			if (neighborNode.bIsOpened == false)
-			{
-				// add to the open list.
-				list.Push(neighborNode);
-			}
-		}
-	}
+	Context->search.GetMovementRange(tile, distance, Context->tiles, elementColor, allowWaterType, lightningSpecial, allowAnyDestination);
+	GridView->ToPositions(Context->tiles, OutMovablePoints);
 
-	return false;
+	FScopeLock Lock(&CacheLock);
+	Cache.AddRange(Key, Context->tiles);
 }
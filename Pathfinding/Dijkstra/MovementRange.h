@@ -7,12 +7,21 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+
+#include "QueryCache.h"
+#include "RangeSearch.h"
+#include "SearchPool.h"
+
 #include "MovementRange.generated.h"
 
 class UHexGrid;
 
 /**
- * 
+ * Adapter from UHexGrid positions to AkPathfinding::RangeSearch.
+ * Range queries may run on any thread at the same time, each borrows a search context.
+ * Initialize, SetOpenListType, NotifyTilesChanged and RefreshGrid run on the game thread and must not overlap with queries.
+ * Queries on the game thread first catch up with tiles changed through the shared FHexGridView, so they must not overlap with queries on other threads either.
+ * Ranges are kept until a tile within their distance changes, so asking again for the same unit doesn't search.
  */
 UCLASS(BlueprintType, DefaultToInstanced)
 class PATHFINDING_API UMovementRange : public UObject
@@ -22,6 +31,14 @@ class PATHFINDING_API UMovementRange : public UObject
 public:
 	void Initialize(UHexGrid* InHexGrid);
 
+	// Binary heap by default. Buckets suit grids with small step costs.
+	void SetOpenListType(AkPathfinding::OpenListType type);
+
+	// Searches use a cached copy of the grid, shared with the other adapters. Pass tiles whose height or type changed.
+	void NotifyTilesChanged(const TArray<FIntPoint>& Positions);
+	// Rebuild the cached grid, when changed tiles are unknown.
+	void RefreshGrid();
+
 	/*!
 	 * \brief Find movable tiles in this turn from the given position.
 	 *
@@ -39,20 +56,17 @@ public:
 	void GetMovementRange(const FIntPoint& position, int32 distance, TArray<FIntPoint>& OutMovablePoints, EAkElementType InElementType, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination);
 
 private:
-	typedef bool (*NodeBlockTest)(const SearchNode&, const SearchNode&, UHexGrid*);
-	typedef bool (*NodeColorTest)(const SearchNode&, EAkElementType ElementType);
-	
-	void GetTilesInRange(const FIntPoint& position, int32 distance, TArray<FIntPoint>& OutMovablePoints, uint8 destinationColor, uint8 pathColor, NodeBlockTest nodeBlockTest);
-	bool ReachableTileExist(const FIntPoint& position, int32 distance, const TArray<FIntPoint>& Tiles, uint8 ElementType, NodeBlockTest nodeBlockTest) const;
-	
+	// Pass tiles changed since the version of the cache on to it. Game thread only.
+	void SyncGrid();
+
 private:
 	UPROPERTY(Transient)
 	UHexGrid* HexGrid = nullptr;
 
-	NodePool nodePool;
-	NodeSorter nodeSorter = NodeSorter(nodePool);
-	OpenList openList = OpenList(nodePool, nodeSorter);
+	TSharedPtr<FHexGridView> GridView;
+	AkPathfinding::SearchPool<AkPathfinding::RangeSearch> Searches;
 
-	FIntPoint start;
-	bool validStart;
+	FCriticalSection CacheLock;
+	AkPathfinding::QueryCache Cache;
+	std::vector<int32_t> GridChangedTiles;
 };
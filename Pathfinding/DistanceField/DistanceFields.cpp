@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DistanceFields.h"
+#include "HexGrid.h"
+
+#include "AStarSearch.h"
+
+void UDistanceFields::Initialize(UHexGrid* InHexGrid)
+{
+	HexGrid = InHexGrid;
+	GridView = FHexGridView::FindOrCreate(HexGrid);
+	GridStamp = GridView->GetStamp();
+
+	Fields.Initialize(&GridView->GetAdjacency());
+}
+
+void UDistanceFields::NotifyTilesChanged(const TArray<FIntPoint>& Positions)
+{
+	GridView->NotifyTilesChanged(Positions);
+	SyncGrid();
+}
+
+void UDistanceFields::RefreshGrid()
+{
+	GridView->RefreshAdjacency();
+	SyncGrid();
+}
+
+void UDistanceFields::SyncGrid()
+{
+	if (GridStamp == GridView->GetStamp())
+	{
+		return;
+	}
+
+	GridView->GetChangedTilesSince(GridStamp, GridChangedTiles);
+	GridStamp = GridView->GetStamp();
+
+	Fields.Repair(GridChangedTiles);
+}
+
+const AkPathfinding::DistanceField& UDistanceFields::GetShortestField(const TArray<FIntPoint>& InGoals)
+{
+	AK_PATHFINDING_TRACE_SCOPE(UDistanceFields_GetShortestField);
+	SyncGrid();
+	ToIndices(InGoals);
+
+	const AkPathfinding::PathRequest request = AkPathfinding::AStarSearch::MakeShortestPathRequest(AkPathfinding::InvalidIndex, AkPathfinding::InvalidIndex);
+	return Fields.GetField(Goals, request.pathColor, request.nodeBlockTest);
+}
+
+const AkPathfinding::DistanceField& UDistanceFields::GetField(const TArray<FIntPoint>& InGoals, EAkElementType InElementType, bool allowWaterType)
+{
+	AK_PATHFINDING_TRACE_SCOPE(UDistanceFields_GetField);
+	SyncGrid();
+	ToIndices(InGoals);
+
+	const AkPathfinding::PathRequest request = AkPathfinding::AStarSearch::MakePathRequest(AkPathfinding::InvalidIndex, AkPathfinding::InvalidIndex, ElementMask::MapColor(InElementType), allowWaterType, true);
+	return Fields.GetField(Goals, request.pathColor, request.nodeBlockTest);
+}
+
+int32 UDistanceFields::GetDistance(const AkPathfinding::DistanceField& Field, const FIntPoint& position) const
+{
+	return Field.GetDistance(GridView->ToIndex(position));
+}
+
+bool UDistanceFields::GetPath(const AkPathfinding::DistanceField& Field, const FIntPoint& position, TArray<FIntPoint>& OutPath) const
+{
+	const bool bFound = Field.GetPath(GridView->ToIndex(position), Tiles);
+	GridView->ToPositions(Tiles, OutPath);
+	return bFound;
+}
+
+void UDistanceFields::ToIndices(const TArray<FIntPoint>& Positions)
+{
+	Goals.clear();
+
+	for (const FIntPoint& position : Positions)
+	{
+		Goals.push_back(GridView->ToIndex(position));
+	}
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Pathfinding.h"
+#include "TileData.h"
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+
+#include "DistanceField.h"
+
+#include "DistanceFields.generated.h"
+
+class UHexGrid;
+
+/**
+ * Adapter from UHexGrid positions to AkPathfinding::DistanceFieldCache.
+ * A field gives the path cost and the next step from any position to the closest of its goals,
+ * so units heading for the same flag or end zone share one search instead of running one each.
+ * Fields are repaired where tiles changed, whether passed to NotifyTilesChanged or to FHexGridView::NotifyGridChanged.
+ * Not thread safe, use it from the game thread.
+ */
+UCLASS(BlueprintType, DefaultToInstanced)
+class PATHFINDING_API UDistanceFields : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Initialize(UHexGrid* InHexGrid);
+
+	// Fields use a cached copy of the grid, shared with the other adapters. Pass tiles whose height or type changed.
+	void NotifyTilesChanged(const TArray<FIntPoint>& Positions);
+	// Rebuild the cached grid, when changed tiles are unknown. Fields are repaired where it differs.
+	void RefreshGrid();
+
+	/*!
+	 * \brief Field toward the goals, under the rules of UAStar::GetShortestPath.
+	 *		  Built on first use. The reference may be rebuilt for other goals by the next Get*Field call.
+	 */
+	const AkPathfinding::DistanceField& GetShortestField(const TArray<FIntPoint>& InGoals);
+
+	// Field toward the goals, under the rules of UAStar::GetPath with any destination allowed.
+	const AkPathfinding::DistanceField& GetField(const TArray<FIntPoint>& InGoals, EAkElementType InElementType, bool allowWaterType);
+
+	// MAX_int32 if no goal can be reached from the position.
+	int32 GetDistance(const AkPathfinding::DistanceField& Field, const FIntPoint& position) const;
+
+	/*!
+	 * \brief Path from the position to the closest goal of the field.
+	 *
+	 * \param OutPath
+	 *		  Same order as UAStar: the goal first, the position itself excluded.
+	 *
+	 * \return false if no goal can be reached from the position.
+	 */
+	bool GetPath(const AkPathfinding::DistanceField& Field, const FIntPoint& position, TArray<FIntPoint>& OutPath) const;
+
+	// Tiles of the fields are indices of this view.
+	const FHexGridView& GetGridView() const { return *GridView; }
+
+private:
+	// Repair the fields where tiles changed since GridStamp.
+	void SyncGrid();
+
+	void ToIndices(const TArray<FIntPoint>& Positions);
+
+private:
+	UPROPERTY(Transient)
+	UHexGrid* HexGrid = nullptr;
+
+	TSharedPtr<FHexGridView> GridView;
+	AkPathfinding::DistanceFieldCache Fields;
+
+	// Stamp of the view the fields last caught up with.
+	uint32 GridStamp = 0;
+	std::vector<int32_t> GridChangedTiles;
+
+	// Scratch buffers for conversions.
+	std::vector<int32_t> Goals;
+	mutable std::vector<int32_t> Tiles;
+};
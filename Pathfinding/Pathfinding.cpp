@@ -1,92 +1,301 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 #include "Pathfinding.h"
 
+#include <algorithm>
+#include <numeric>
+
 #include "GridUtils.h"
 #include "LogPathfinding.h"
 #include "Modules/ModuleManager.h"
 
 #include "HexGrid.h"
 
+#if AK_PATHFINDING_METRICS
+#include <sstream>
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "SearchMetrics.h"
+#endif
+
 IMPLEMENT_GAME_MODULE( FDefaultGameModuleImpl, Pathfinding );
 DEFINE_LOG_CATEGORY(LogPathfinding);
 
-SearchNode::SearchNode(const FIntPoint& InPosition)
-		: position(InPosition)
-{}
+#if AK_PATHFINDING_METRICS
+namespace
+{
+	void SaveMetrics(const TCHAR* FileName, void (AkPathfinding::SearchMetrics::*Write)(std::ostream&) const)
+	{
+		std::ostringstream Stream;
+		(AkPathfinding::SearchMetrics::Get().*Write)(Stream);
+
+		const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Pathfinding"), FileName);
+		FFileHelper::SaveStringToFile(FString(UTF8_TO_TCHAR(Stream.str().c_str())), *Path);
 
-NodePool::NodePool()
-		: Super()
+		UE_LOG(LogPathfinding, Log, TEXT("Wrote %s"), *Path);
+	}
+
+	FAutoConsoleCommand DumpMetricsCommand(
+		TEXT("Pathfinding.DumpMetrics"),
+		TEXT("Write histograms, slowest queries and a trace of the pathfinding queries to Saved/Pathfinding, then reset them."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			SaveMetrics(TEXT("Histograms.csv"), &AkPathfinding::SearchMetrics::WriteHistograms);
+			SaveMetrics(TEXT("SlowestQueries.csv"), &AkPathfinding::SearchMetrics::WriteSlowestQueries);
+			SaveMetrics(TEXT("Trace.json"), &AkPathfinding::SearchMetrics::WriteTrace);
+
+			AkPathfinding::SearchMetrics::Get().Reset();
+		}));
+}
+#endif
+
+namespace
 {
-	Super::Reserve(Policy::NodePoolSize);
+	// Weak both ways, so a view goes with its last adapter or its grid.
+	TMap<TWeakObjectPtr<UHexGrid>, TWeakPtr<FHexGridView>>& GetViews()
+	{
+		static TMap<TWeakObjectPtr<UHexGrid>, TWeakPtr<FHexGridView>> Views;
+		return Views;
+	}
 }
 
-SearchNode& NodePool::Add(const SearchNode& searchNode)
+TSharedRef<FHexGridView> FHexGridView::FindOrCreate(UHexGrid* InHexGrid)
 {
-	const int32 index = TArray<SearchNode>::Add(searchNode);
-	NodeMap.Add(searchNode.position, index);
-		
-	SearchNode& newNode = (*this)[index];
-	newNode.searchNodeIndex = index;
-	newNode.tileData = HexGrid->GetTileData(newNode.position);
-	
-	return newNode;
+	check(IsInGameThread());
+
+	TMap<TWeakObjectPtr<UHexGrid>, TWeakPtr<FHexGridView>>& Views = GetViews();
+
+	for (auto It = Views.CreateIterator(); It; ++It)
+	{
+		if (It.Key().IsValid() == false || It.Value().IsValid() == false)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (const TWeakPtr<FHexGridView>* Found = Views.Find(InHexGrid))
+	{
+		return Found->Pin().ToSharedRef();
+	}
+
+	TSharedRef<FHexGridView> View = MakeShared<FHexGridView>();
+	View->Initialize(InHexGrid);
+	Views.Add(InHexGrid, View);
+
+	return View;
 }
 
-SearchNode& NodePool::FindOrAdd(const FIntPoint& position)
+void FHexGridView::NotifyGridChanged(UHexGrid* InHexGrid, const TArray<FIntPoint>& Positions)
 {
-	const int32* indexPtr = NodeMap.Find(position);
-	return indexPtr ? (*this)[*indexPtr] : Add(position);
+	check(IsInGameThread());
+
+	if (const TWeakPtr<FHexGridView>* Found = GetViews().Find(InHexGrid))
+	{
+		if (const TSharedPtr<FHexGridView> View = Found->Pin())
+		{
+			View->NotifyTilesChanged(Positions);
+		}
+	}
 }
 
-void NodePool::Reset()
+void FHexGridView::Initialize(UHexGrid* InHexGrid)
 {
-	Super::Reset(Policy::NodePoolSize);
-	NodeMap.Reset();
+	HexGrid = InHexGrid;
+
+	// Bounds of the tiles linked to an end zone, which every map has. Only neighbors and end zones are asked of the grid.
+	const FIntPoint Seed = HexGrid->GetEndZoneTileCoords()[0][0];
+	FIntPoint Min = Seed;
+	FIntPoint Max = Seed;
+
+	TSet<FIntPoint> Visited;
+	TArray<FIntPoint> Open;
+	Visited.Add(Seed);
+	Open.Add(Seed);
+
+	while (Open.Num() > 0)
+	{
+		const FIntPoint Position = Open.Pop(false);
+		Min = Min.ComponentMin(Position);
+		Max = Max.ComponentMax(Position);
+
+		THexNeighbors Neighbors;
+		const int NeighborCount = HexGrid->GetNeighbors(Position, Neighbors);
+
+		for (int i = 0; i < NeighborCount; ++i)
+		{
+			bool bVisited = false;
+			Visited.Add(Neighbors[i], &bVisited);
+
+			if (bVisited == false)
+			{
+				Open.Add(Neighbors[i]);
+			}
+		}
+	}
+
+	GridMin = Min;
+	GridSize = Max - Min + FIntPoint(1, 1);
+	checkf(Visited.Num() == GridSize.X * GridSize.Y, TEXT("Tiles of the grid must fill its bounds, so they can be indexed row by row."));
+
+	Adjacency.Build(this);
+
+	Changes.clear();
+	OldestStamp = GetStamp();
+
+#if AK_PATHFINDING_METRICS
+	AkPathfinding::SearchMetrics::Get().SetMapLabel(TCHAR_TO_UTF8(*HexGrid->GetName()));
+#endif
 }
 
-NodeSorter::NodeSorter(const TArray<SearchNode>& InNodePool)
-		: NodePool(InNodePool)
-{}
+void FHexGridView::ToPositions(const std::vector<int32_t>& Tiles, TArray<FIntPoint>& OutPositions) const
+{
+	OutPositions.Reset(Tiles.size());
+
+	for (const int32_t tile : Tiles)
+	{
+		OutPositions.Add(ToPosition(tile));
+	}
+}
 
-bool NodeSorter::operator()(const int32 lhs, const int32 rhs) const
+void FHexGridView::NotifyTilesChanged(const TArray<FIntPoint>& Positions)
 {
-	return NodePool[lhs].cost < NodePool[rhs].cost;
+	ChangedTiles.clear();
+
+	for (const FIntPoint& position : Positions)
+	{
+		ChangedTiles.push_back(ToIndex(position));
+	}
+
+	Adjacency.RebuildTiles(ChangedTiles);
+	RecordChanges();
+
+	TilesChangedEvent.Broadcast(ChangedTiles);
 }
 
-OpenList::OpenList(TArray<SearchNode>& InNodePool, const NodeSorter& InNodeSorter)
-		: nodePool(InNodePool), nodeSorter(InNodeSorter)
+void FHexGridView::RefreshAdjacency()
 {
-	Super::Reserve(Policy::OpenSetSize);
+	Adjacency.Refresh(ChangedTiles);
+	RecordChanges();
+
+	TilesChangedEvent.Broadcast(ChangedTiles);
 }
 
-void OpenList::Push(SearchNode& searchNode)
+void FHexGridView::GetChangedTilesSince(uint32 Stamp, std::vector<int32_t>& OutTiles) const
 {
-	HeapPush(searchNode.searchNodeIndex, nodeSorter);
-	searchNode.bIsOpened = true;
+	OutTiles.clear();
+
+	if (Stamp < OldestStamp)
+	{
+		OutTiles.resize(GetTileCount());
+		std::iota(OutTiles.begin(), OutTiles.end(), 0);
+		return;
+	}
+
+	const auto First = std::upper_bound(Changes.begin(), Changes.end(), Stamp, [](uint32 InStamp, const FTileChange& Change)
+	{
+		return InStamp < Change.Stamp;
+	});
+
+	for (auto It = First; It != Changes.end(); ++It)
+	{
+		OutTiles.push_back(It->Tile);
+	}
+
+	std::sort(OutTiles.begin(), OutTiles.end());
+	OutTiles.erase(std::unique(OutTiles.begin(), OutTiles.end()), OutTiles.end());
+}
+
+void FHexGridView::RecordChanges()
+{
+	if (ChangedTiles.empty())
+	{
+		return;
+	}
+
+	for (const int32_t tile : ChangedTiles)
+	{
+		Changes.push_back({ GetStamp(), tile });
+	}
+
+	const int32 Count = static_cast<int32>(Changes.size());
+
+	if (Count > MaxChanges)
+	{
+		// Forget whole stamps, so a stamp is either fully kept or older than OldestStamp.
+		OldestStamp = Changes[Count - MaxChanges].Stamp;
+
+		const auto Kept = std::upper_bound(Changes.begin(), Changes.end(), OldestStamp, [](uint32 InStamp, const FTileChange& Change)
+		{
+			return InStamp < Change.Stamp;
+		});
+
+		Changes.erase(Changes.begin(), Kept);
+	}
+}
+
+void FHexGridView::CopyTiles(AkPathfinding::GridSnapshot& OutSnapshot) const
+{
+	OutSnapshot.Initialize(GetTileCount());
+
+	for (int32_t tile = 0; tile < GetTileCount(); ++tile)
+	{
+		const FTileData* Data = HexGrid->GetTileData(ToPosition(tile));
+		OutSnapshot.SetTile(tile, Data->Height, ElementMask::MapColor(Data->TopType));
+	}
+}
+
+void FHexGridView::CopyTiles(AkPathfinding::GridSnapshot& OutSnapshot, const std::vector<int32_t>& Tiles) const
+{
+	for (const int32_t tile : Tiles)
+	{
+		const FTileData* Data = HexGrid->GetTileData(ToPosition(tile));
+		OutSnapshot.SetTile(tile, Data->Height, ElementMask::MapColor(Data->TopType));
+	}
+}
+
+int32_t FHexGridView::GetTileCount() const
+{
+	return GridSize.X * GridSize.Y;
+}
+
+int FHexGridView::GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[AkPathfinding::MaxNeighbors]) const
+{
+	THexNeighbors neighbors;
+	const int neighborCount = HexGrid->GetNeighbors(ToPosition(tile), neighbors);
+
+	for (int i = 0; i < neighborCount; ++i)
+	{
+		OutNeighbors[i] = ToIndex(neighbors[i]);
+	}
+
+	return neighborCount;
+}
+
+int32_t FHexGridView::GetCost(int32_t from, int32_t to) const
+{
+	return HexGrid->GetCost(ToPosition(from), ToPosition(to));
 }
 
-int32 OpenList::PopIndex(bool bAllowShrinking)
+bool FHexGridView::IsPassable(int32_t from, int32_t to) const
 {
-	int32 searchNodeIndex = INDEX_NONE;
-	HeapPop(searchNodeIndex, nodeSorter, false);
-	nodePool[searchNodeIndex].bIsOpened = false;
-	return searchNodeIndex;
+	return HexGrid->IsPassable(ToPosition(from), ToPosition(to));
 }
 
-bool NodeTester::Test_None(const SearchNode&, const SearchNode&, UHexGrid*)
+bool FHexGridView::IsBlocked(int32_t tile) const
 {
-	return true;
+	return HexGrid->GetTileData(ToPosition(tile))->bBlocked;
 }
 
-bool NodeTester::Test_Block(const SearchNode& , const SearchNode& neighborNode, UHexGrid*)
+uint8_t FHexGridView::GetTileColor(int32_t tile) const
 {
-	return neighborNode.tileData->bBlocked == false;
+	return ElementMask::MapColor(HexGrid->GetTileData(ToPosition(tile))->TopType);
 }
 
-bool NodeTester::Test_Height(const SearchNode& parentNode, const SearchNode& neighborNode, UHexGrid* HexGrid)
+int32_t FHexGridView::Distance(int32_t from, int32_t to) const
 {
-	return neighborNode.tileData->bBlocked == false
-		&& HexGrid->IsPassable(parentNode.position, neighborNode.position);
+	return UHexGrid::Distance(ToPosition(from), ToPosition(to));
 }
 
 uint8 ElementMask::MapColor(EAkElementType ElementType)
@@ -111,4 +320,4 @@ uint8 ElementMask::MapColor(EAkElementType ElementType)
 	default:
 		return ElementMask::None;
 	}
-}
\ No newline at end of file
+}
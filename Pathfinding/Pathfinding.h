@@ -1,90 +1,121 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "CoreMinimal.h"
-#include "GraphAStar.h"
 #include "TileData.h"
 
-class UHexGrid;
+#include <vector>
 
-using Policy = FGraphAStarDefaultPolicy;
+#include "AdjacencyTable.h"
+#include "GridSnapshot.h"
+#include "PathGrid.h"
 
-struct SearchNode
-{
-	SearchNode(const FIntPoint& InPosition);
-	
-	FIntPoint position;
-	FIntPoint parentPos;
-	
-	int32 searchNodeIndex = INDEX_NONE;
-	int32 parentIndex = INDEX_NONE;
-	
-	int32 cost = INT_MAX;
-	int32 totalCost = INT_MAX;
-
-	bool bIsOpened = false;
-	bool bIsClosed = false;
-
-	const FTileData* tileData;
-};
+#if AK_PATHFINDING_METRICS
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
-struct NodePool : TArray<SearchNode>
-{
-	typedef  TArray<SearchNode> Super;
-	TMap<FIntPoint, int32> NodeMap;
-	UHexGrid* HexGrid = nullptr;
+// Scope of an adapter query in Unreal Insights, next to the frame. The core records the same queries in SearchMetrics.
+#define AK_PATHFINDING_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE(Name)
+#else
+#define AK_PATHFINDING_TRACE_SCOPE(Name)
+#endif
 
-	NodePool();
-
-	SearchNode& Add(const SearchNode& searchNode);
-	SearchNode& FindOrAdd(const FIntPoint& position);
-
-	void Reset();
-
-	// FORCEINLINE void ReinitNodes()
-	// {
-	// 	for (SearchNode& node : *this)
-	// 	{
-	// 		new (&node) SearchNode(node.position);
-	// 	}
-	// }
-};
+class UHexGrid;
 
-struct NodeSorter
+// Indices of the tiles just rebuilt, see FHexGridView::OnTilesChanged.
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnHexTilesChanged, const std::vector<int32_t>& /* Tiles */);
+
+/*!
+ * \brief Exposes UHexGrid to the engine independent pathfinding core.
+ *		  Tiles are indexed row by row inside the grid bounds.
+ *		  Searches walk the cached adjacency, so whatever raises, lowers or expands tiles must pass them to NotifyGridChanged.
+ *		  Only those tiles are rebuilt. The stamp goes up with every change, so whoever keeps results can catch up with GetChangedTilesSince.
+ *		  One view is shared by every adapter of the same grid, see FindOrCreate.
+ */
+class PATHFINDING_API FHexGridView : public AkPathfinding::IPathGrid
 {
-	const TArray<SearchNode>& NodePool;
+public:
+	// The view of the grid, built on first use and kept while anyone holds it. Game thread only.
+	static TSharedRef<FHexGridView> FindOrCreate(UHexGrid* InHexGrid);
+	// NotifyTilesChanged on the view of the grid, if anyone holds one. Call where tiles are raised, lowered or expanded. Game thread only.
+	static void NotifyGridChanged(UHexGrid* InHexGrid, const TArray<FIntPoint>& Positions);
+
+	void Initialize(UHexGrid* InHexGrid);
+
+	FORCEINLINE int32 ToIndex(const FIntPoint& position) const
+	{
+		const FIntPoint local = position - GridMin;
+		checkSlow(local.X >= 0 && local.X < GridSize.X && local.Y >= 0 && local.Y < GridSize.Y);
+		return local.Y * GridSize.X + local.X;
+	}
+
+	FORCEINLINE FIntPoint ToPosition(int32 index) const
+	{
+		return GridMin + FIntPoint(index % GridSize.X, index / GridSize.X);
+	}
+
+	void ToPositions(const std::vector<int32_t>& Tiles, TArray<FIntPoint>& OutPositions) const;
+
+	const AkPathfinding::AdjacencyTable& GetAdjacency() const { return Adjacency; }
+
+	// Refresh the cached adjacency of tiles whose height or type changed.
+	void NotifyTilesChanged(const TArray<FIntPoint>& Positions);
+	// Rebuild the whole cache, when changed tiles are unknown.
+	void RefreshAdjacency();
+	// Tiles passed to the last NotifyTilesChanged, or found changed by the last RefreshAdjacency.
+	const std::vector<int32_t>& GetChangedTiles() const { return ChangedTiles; }
+	// Broadcast after NotifyTilesChanged and RefreshAdjacency, for copies of the tiles outside the adjacency.
+	FOnHexTilesChanged& OnTilesChanged() { return TilesChangedEvent; }
+
+	// Goes up whenever cached tiles change.
+	uint32 GetStamp() const { return Adjacency.GetVersion(); }
+	// Sorted tiles changed after the stamp. Every tile if changes that old are no longer kept.
+	void GetChangedTilesSince(uint32 Stamp, std::vector<int32_t>& OutTiles) const;
+
+	// Tiles are laid out in rows of this width.
+	int32 GetGridWidth() const { return GridSize.X; }
+
+	// Copy heights and colors of every tile, for lookahead which must not touch the grid.
+	void CopyTiles(AkPathfinding::GridSnapshot& OutSnapshot) const;
+	// Copy heights and colors of the given tiles only, such as GetChangedTiles after NotifyTilesChanged.
+	void CopyTiles(AkPathfinding::GridSnapshot& OutSnapshot, const std::vector<int32_t>& Tiles) const;
+
+	virtual int32_t GetTileCount() const override;
+	virtual int GetNeighbors(int32_t tile, int32_t (&OutNeighbors)[AkPathfinding::MaxNeighbors]) const override;
+	virtual int32_t GetCost(int32_t from, int32_t to) const override;
+	virtual bool IsPassable(int32_t from, int32_t to) const override;
+	virtual bool IsBlocked(int32_t tile) const override;
+	virtual uint8_t GetTileColor(int32_t tile) const override;
+	virtual int32_t Distance(int32_t from, int32_t to) const override;
+
+private:
+	// Add ChangedTiles to the log if they made the stamp go up.
+	void RecordChanges();
+
+private:
+	struct FTileChange
+	{
+		uint32 Stamp;
+		int32_t Tile;
+	};
 
-	NodeSorter(const TArray<SearchNode>& InNodePool);
-	bool operator()(const int32 lhs, const int32 rhs) const;
-};
+	UHexGrid* HexGrid = nullptr;
+	FIntPoint GridMin = FIntPoint::ZeroValue;
+	FIntPoint GridSize = FIntPoint::ZeroValue;
 
-struct OpenList : TArray<int32>
-{
-	typedef TArray<int32> Super;
-	TArray<SearchNode>& nodePool;
-	const NodeSorter nodeSorter;
+	AkPathfinding::AdjacencyTable Adjacency;
+	std::vector<int32_t> ChangedTiles;
 
-	OpenList(TArray<SearchNode>& InNodePool, const NodeSorter& InNodeSorter);
+	// Oldest first. Every change after OldestStamp is kept.
+	std::vector<FTileChange> Changes;
+	uint32 OldestStamp = 0;
 
-	void Push(SearchNode& searchNode);
-	int32 PopIndex(bool bAllowShrinking = true);
-};
+	FOnHexTilesChanged TilesChangedEvent;
 
-namespace NodeTester
-{
-	bool Test_None(const SearchNode&, const SearchNode&, UHexGrid*);
-	bool Test_Block(const SearchNode& parentNode, const SearchNode& neighborNode, UHexGrid*);
-	bool Test_Height(const SearchNode& parentNode, const SearchNode& neighborNode, UHexGrid* HexGrid);
-}
+	static constexpr int32 MaxChanges = 4096;
+};
 
 namespace ElementMask
 {
-	constexpr uint8 None = 0;
-	constexpr uint8 Stone = 1;
-	constexpr uint8 Water = 2;
-	constexpr uint8 Vine = 4;
-	constexpr uint8 Fire = 8;
-	constexpr uint8 Lightning = 16;
-	constexpr uint8 Any = Stone | Water | Vine | Fire | Lightning;
+	using namespace AkPathfinding::ElementMask;
 
 	uint8 MapColor(EAkElementType ElementType);
-};
\ No newline at end of file
+};
@@ -0,0 +1,643 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "AdjacencyTable.h"
+#include "AStarSearch.h"
+#include "DistanceField.h"
+#include "HexMap.h"
+#include "QueryCache.h"
+#include "RangeSearch.h"
+#include "SyntheticMap.h"
+
+using namespace AkPathfinding;
+using namespace AkBenchmark;
+
+/*
+ * Every search is checked against a brute force reference, relaxing every step of the grid until nothing changes.
+ * The reference asks the HexMap directly, so the adjacency cache is checked along the way.
+ */
+namespace
+{
+	int32_t failureNum = 0;
+
+	void Fail(const char* test, const MapSettings& settings, const char* what, int32_t a, int32_t b, int32_t expected, int32_t actual)
+	{
+		if (++failureNum <= 20)
+		{
+			std::printf("%s on %s: %s (%d, %d) expected %d, got %d\n", test, settings.ToString().c_str(), what, a, b, expected, actual);
+		}
+	}
+
+	std::vector<MapSettings> GetMapSettings()
+	{
+		std::vector<MapSettings> result;
+
+		const ElementMix mixes[] = { ElementMix::Uniform, ElementMix::StoneHeavy, ElementMix::Patches };
+
+		for (uint32_t seed = 1; seed <= 3; ++seed)
+		{
+			for (const ElementMix mix : mixes)
+			{
+				MapSettings settings;
+				// Odd sizes too, so both row parities end up on the last row.
+				settings.size = seed == 2 ? 31 : 24;
+				settings.blockPercent = seed == 3 ? 25 : 10;
+				settings.heightVariance = seed == 1 ? 1 : 3;
+				settings.mix = mix;
+				settings.seed = seed;
+				result.push_back(settings);
+			}
+		}
+
+		return result;
+	}
+
+	// Rules of a step, as the testers of SearchCore apply them. Steps into the origin always pass.
+	bool CanStep(const HexMap& map, int32_t from, int32_t to, int32_t origin, NodeBlockTest nodeBlockTest)
+	{
+		if (to == origin || nodeBlockTest == &NodeTester::Test_None)
+		{
+			return true;
+		}
+
+		if (map.IsBlocked(to))
+		{
+			return false;
+		}
+
+		return nodeBlockTest == &NodeTester::Test_Block || map.IsPassable(from, to);
+	}
+
+	// Cost from every tile to the closest goal. Every tile but the goal needs the path color.
+	std::vector<int32_t> GetReferenceCosts(const HexMap& map, const std::vector<int32_t>& Goals, int32_t origin, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		std::vector<int32_t> costs(map.GetTileCount(), INT32_MAX);
+		std::vector<uint8_t> isGoal(map.GetTileCount(), 0);
+
+		for (const int32_t goal : Goals)
+		{
+			costs[goal] = 0;
+			isGoal[goal] = 1;
+		}
+
+		int32_t neighbors[MaxNeighbors];
+		bool bChanged = true;
+
+		while (bChanged)
+		{
+			bChanged = false;
+
+			for (int32_t tile = 0; tile < map.GetTileCount(); ++tile)
+			{
+				if (isGoal[tile] || (map.GetTileColor(tile) & pathColor) == 0)
+				{
+					continue;
+				}
+
+				const int neighborNum = map.GetNeighbors(tile, neighbors);
+
+				for (int i = 0; i < neighborNum; ++i)
+				{
+					const int32_t neighbor = neighbors[i];
+
+					if (costs[neighbor] == INT32_MAX || CanStep(map, tile, neighbor, origin, nodeBlockTest) == false)
+					{
+						continue;
+					}
+
+					const int32_t cost = costs[neighbor] + map.GetCost(tile, neighbor);
+
+					if (cost < costs[tile])
+					{
+						costs[tile] = cost;
+						bChanged = true;
+					}
+				}
+			}
+		}
+
+		return costs;
+	}
+
+	// Cost from the origin to every tile. Every tile but the last needs the path color.
+	std::vector<int32_t> GetReferenceCostsFrom(const HexMap& map, int32_t origin, int32_t stepOrigin, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		std::vector<int32_t> costs(map.GetTileCount(), INT32_MAX);
+		costs[origin] = 0;
+
+		int32_t neighbors[MaxNeighbors];
+		bool bChanged = true;
+
+		while (bChanged)
+		{
+			bChanged = false;
+
+			for (int32_t tile = 0; tile < map.GetTileCount(); ++tile)
+			{
+				if (costs[tile] == INT32_MAX || (tile != stepOrigin && (map.GetTileColor(tile) & pathColor) == 0))
+				{
+					continue;
+				}
+
+				const int neighborNum = map.GetNeighbors(tile, neighbors);
+
+				for (int i = 0; i < neighborNum; ++i)
+				{
+					const int32_t neighbor = neighbors[i];
+
+					if (CanStep(map, tile, neighbor, stepOrigin, nodeBlockTest) == false)
+					{
+						continue;
+					}
+
+					const int32_t cost = costs[tile] + map.GetCost(tile, neighbor);
+
+					if (cost < costs[neighbor])
+					{
+						costs[neighbor] = cost;
+						bChanged = true;
+					}
+				}
+			}
+		}
+
+		return costs;
+	}
+
+	// Cost of a path in the order of AStarSearch, or InvalidIndex if a step of it breaks the rules of the request.
+	int32_t GetPathCost(const HexMap& map, const PathRequest& request, const std::vector<int32_t>& Path)
+	{
+		int32_t cost = 0;
+		int32_t tile = request.start;
+		int32_t neighbors[MaxNeighbors];
+
+		for (auto step = Path.rbegin(); step != Path.rend(); ++step)
+		{
+			const int neighborNum = map.GetNeighbors(tile, neighbors);
+
+			if (std::find(neighbors, neighbors + neighborNum, *step) == neighbors + neighborNum
+				|| (map.GetTileColor(tile) & request.pathColor) == 0
+				|| CanStep(map, tile, *step, request.start, request.nodeBlockTest) == false)
+			{
+				return InvalidIndex;
+			}
+
+			cost += map.GetCost(tile, *step);
+			tile = *step;
+		}
+
+		return tile == request.destination ? cost : InvalidIndex;
+	}
+
+	// Cost of the cheapest path of the request, INT32_MAX if there is none.
+	int32_t GetReferencePathCost(const HexMap& map, const PathRequest& request)
+	{
+		if (request.destinationColor != ElementMask::Any && (map.GetTileColor(request.destination) & request.destinationColor) == 0)
+		{
+			return INT32_MAX;
+		}
+
+		return GetReferenceCosts(map, { request.destination }, request.start, request.pathColor, request.nodeBlockTest)[request.start];
+	}
+
+	// Result of RangeSearch::GetTilesInRange, sorted.
+	std::vector<int32_t> GetReferenceTilesInRange(const HexMap& map, int32_t position, int32_t distance, uint8_t destinationColor, uint8_t pathColor, NodeBlockTest nodeBlockTest)
+	{
+		const std::vector<int32_t> costs = GetReferenceCostsFrom(map, position, position, pathColor, nodeBlockTest);
+		std::vector<int32_t> result;
+
+		for (int32_t tile = 0; tile < map.GetTileCount(); ++tile)
+		{
+			if (tile == position)
+			{
+				result.push_back(tile);
+			}
+			else if (costs[tile] < distance)
+			{
+				if (map.GetTileColor(tile) & pathColor)
+				{
+					result.push_back(tile);
+				}
+			}
+			else if (costs[tile] == distance && (map.GetTileColor(tile) & destinationColor))
+			{
+				result.push_back(tile);
+			}
+		}
+
+		return result;
+	}
+
+	// Result of RangeSearch::GetMovementRange, sorted.
+	std::vector<int32_t> GetReferenceMovementRange(const HexMap& map, int32_t position, int32_t distance, uint8_t elementColor, bool allowWaterType, bool lightningSpecial, bool allowAnyDestination)
+	{
+		uint8_t destinationColor = elementColor | (lightningSpecial ? ElementMask::Stone : ElementMask::None);
+		uint8_t pathColor = elementColor | ElementMask::Stone;
+
+		if (allowWaterType)
+		{
+			destinationColor |= ElementMask::Water;
+			pathColor |= ElementMask::Water;
+		}
+
+		if (allowAnyDestination)
+		{
+			return GetReferenceTilesInRange(map, position, distance, ElementMask::Any, pathColor, &NodeTester::Test_Height);
+		}
+
+		const std::vector<int32_t> tiles = GetReferenceTilesInRange(map, position, distance, destinationColor, pathColor, &NodeTester::Test_Height);
+		const std::vector<int32_t> costs = GetReferenceCostsFrom(map, position, position, pathColor, &NodeTester::Test_Height);
+
+		std::vector<int32_t> destinations;
+
+		for (int32_t tile = 0; tile < map.GetTileCount(); ++tile)
+		{
+			if (map.GetTileColor(tile) & destinationColor)
+			{
+				destinations.push_back(tile);
+			}
+		}
+
+		std::vector<int32_t> onward = GetReferenceCosts(map, destinations, position, pathColor, &NodeTester::Test_Height);
+
+		// The position may be left whatever its color.
+		for (const int32_t destination : destinations)
+		{
+			onward[position] = std::min(onward[position], costs[destination]);
+		}
+
+		// Keep tiles which can still walk onto a tile of the color. Tiles of the color cost nothing onward.
+		std::vector<int32_t> result;
+
+		for (const int32_t tile : tiles)
+		{
+			if (onward[tile] <= distance - costs[tile])
+			{
+				result.push_back(tile);
+			}
+		}
+
+		return result;
+	}
+
+	// Change a few tiles like the Raise, Lower and element abilities do. Returns the tiles changed.
+	std::vector<int32_t> EditTiles(HexMap& map, std::mt19937& random)
+	{
+		static const uint8_t colors[] = { ElementMask::Stone, ElementMask::Water, ElementMask::Vine, ElementMask::Fire, ElementMask::Lightning };
+
+		std::vector<int32_t> tiles(std::uniform_int_distribution<int32_t>(1, 3)(random));
+
+		for (int32_t& tile : tiles)
+		{
+			tile = std::uniform_int_distribution<int32_t>(0, map.GetTileCount() - 1)(random);
+
+			int32_t height = map.GetTileHeight(tile);
+			uint8_t color = map.GetTileColor(tile);
+			bool bBlocked = map.IsBlocked(tile);
+
+			switch (std::uniform_int_distribution<int32_t>(0, 3)(random))
+			{
+				case 0: height = std::min(height + 1, 5); break;
+				case 1: height = std::max(height - 1, 0); break;
+				case 2: color = colors[std::uniform_int_distribution<int32_t>(0, 4)(random)]; break;
+				default: bBlocked = !bBlocked; break;
+			}
+
+			map.SetTile(tile, height, color, bBlocked);
+		}
+
+		std::sort(tiles.begin(), tiles.end());
+		tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+		return tiles;
+	}
+
+	std::vector<PathRequest> MakeRequests(const PathQuery& query)
+	{
+		std::vector<PathRequest> requests;
+		requests.push_back(AStarSearch::MakeShortestPathRequest(query.start, query.destination));
+		requests.push_back(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, false, false));
+		requests.push_back(AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true));
+
+		// Shortest path around blocked tiles only, through the indirect tester.
+		PathRequest blockRequest = AStarSearch::MakeShortestPathRequest(query.start, query.destination);
+		blockRequest.nodeBlockTest = &NodeTester::Test_Block;
+		requests.push_back(blockRequest);
+
+		return requests;
+	}
+
+	void CheckPath(const char* test, const MapSettings& settings, const HexMap& map, const PathRequest& request, bool bFound, const std::vector<int32_t>& Path)
+	{
+		const int32_t expected = GetReferencePathCost(map, request);
+
+		if (bFound != (expected != INT32_MAX))
+		{
+			Fail(test, settings, "found", request.start, request.destination, expected != INT32_MAX, bFound);
+		}
+		else if (bFound && GetPathCost(map, request, Path) != expected)
+		{
+			Fail(test, settings, "cost", request.start, request.destination, expected, GetPathCost(map, request, Path));
+		}
+	}
+
+	void TestAStar(bool bBidirectional)
+	{
+		const char* test = bBidirectional ? "Bidirectional" : "AStar";
+
+		for (const MapSettings& settings : GetMapSettings())
+		{
+			const std::unique_ptr<HexMap> map = GenerateMap(settings);
+
+			AdjacencyTable adjacency;
+			adjacency.Build(map.get());
+
+			AStarSearch search;
+			search.Initialize(&adjacency);
+
+			std::vector<int32_t> path;
+			int32_t buffer[256];
+
+			for (const PathQuery& query : GenerateQueries(*map, 24, settings.seed))
+			{
+				for (PathRequest request : MakeRequests(query))
+				{
+					request.bBidirectional = bBidirectional;
+
+					const bool bFound = search.FindPath(request, path);
+					CheckPath(test, settings, *map, request, bFound, path);
+
+					// Same path written into storage of the caller.
+					const int32_t length = search.FindPath(request, buffer, 256);
+
+					if (length != (bFound ? static_cast<int32_t>(path.size()) : InvalidIndex)
+						|| (bFound && length <= 256 && std::equal(path.begin(), path.end(), buffer) == false))
+					{
+						Fail(test, settings, "buffer", request.start, request.destination, bFound ? static_cast<int32_t>(path.size()) : InvalidIndex, length);
+					}
+				}
+			}
+		}
+	}
+
+	void TestRange()
+	{
+		for (const MapSettings& settings : GetMapSettings())
+		{
+			const std::unique_ptr<HexMap> map = GenerateMap(settings);
+
+			AdjacencyTable adjacency;
+			adjacency.Build(map.get());
+
+			RangeSearch search;
+			search.Initialize(&adjacency);
+
+			std::vector<int32_t> tiles;
+			int32_t queryIndex = 0;
+
+			for (const PathQuery& query : GenerateQueries(*map, 16, settings.seed))
+			{
+				const int32_t distance = 1 + queryIndex % 6;
+				const bool allowWaterType = queryIndex & 1;
+				const bool lightningSpecial = query.elementColor == ElementMask::Lightning;
+				const bool allowAnyDestination = (queryIndex / 2) & 1;
+				++queryIndex;
+
+				search.GetMovementRange(query.start, distance, tiles, query.elementColor, allowWaterType, lightningSpecial, allowAnyDestination);
+
+				if (tiles.empty() || tiles[0] != query.start)
+				{
+					Fail("Range", settings, "first tile", query.start, distance, query.start, tiles.empty() ? InvalidIndex : tiles[0]);
+				}
+
+				std::sort(tiles.begin(), tiles.end());
+				const std::vector<int32_t> expected = GetReferenceMovementRange(*map, query.start, distance, query.elementColor, allowWaterType, lightningSpecial, allowAnyDestination);
+
+				if (tiles != expected)
+				{
+					Fail("Range", settings, "tiles", query.start, distance, static_cast<int32_t>(expected.size()), static_cast<int32_t>(tiles.size()));
+				}
+
+				// Dijkstra the flood fill falls back to, with each tester.
+				const NodeBlockTest testers[] = { &NodeTester::Test_Height, &NodeTester::Test_Block, &NodeTester::Test_None };
+				const uint8_t pathColor = query.elementColor | ElementMask::Stone;
+
+				for (const NodeBlockTest nodeBlockTest : testers)
+				{
+					search.GetTilesInRange(query.start, distance, tiles, query.elementColor, pathColor, nodeBlockTest);
+					std::sort(tiles.begin(), tiles.end());
+
+					if (tiles != GetReferenceTilesInRange(*map, query.start, distance, query.elementColor, pathColor, nodeBlockTest))
+					{
+						Fail("Range", settings, "tiles in range", query.start, distance, 0, 1);
+					}
+				}
+			}
+		}
+	}
+
+	void TestDistanceFieldRepair()
+	{
+		for (const MapSettings& settings : GetMapSettings())
+		{
+			std::unique_ptr<HexMap> map = GenerateMap(settings);
+
+			AdjacencyTable adjacency;
+			adjacency.Build(map.get());
+
+			// An end zone row, like the goals the AI asks for.
+			std::vector<int32_t> goals;
+
+			for (int32_t x = 0; x < map->GetWidth(); ++x)
+			{
+				goals.push_back(map->ToIndex(x, 0));
+			}
+
+			const PathRequest request = AStarSearch::MakePathRequest(InvalidIndex, InvalidIndex, ElementMask::Fire, true, true);
+
+			DistanceField field;
+			field.Initialize(&adjacency);
+			field.Build(goals, request.pathColor, request.nodeBlockTest);
+
+			DistanceField builtField;
+			builtField.Initialize(&adjacency);
+
+			std::mt19937 random(settings.seed);
+			std::vector<int32_t> path;
+
+			for (int32_t edit = 0; edit < 40; ++edit)
+			{
+				const std::vector<int32_t> tiles = EditTiles(*map, random);
+				adjacency.RebuildTiles(tiles);
+				field.Repair(tiles);
+
+				builtField.Build(goals, request.pathColor, request.nodeBlockTest);
+				const std::vector<int32_t> expected = GetReferenceCosts(*map, goals, InvalidIndex, request.pathColor, request.nodeBlockTest);
+
+				for (int32_t tile = 0; tile < map->GetTileCount(); ++tile)
+				{
+					if (field.GetDistance(tile) != expected[tile])
+					{
+						Fail("DistanceField", settings, "repaired distance", tile, edit, expected[tile], field.GetDistance(tile));
+					}
+
+					if (builtField.GetDistance(tile) != expected[tile])
+					{
+						Fail("DistanceField", settings, "built distance", tile, edit, expected[tile], builtField.GetDistance(tile));
+					}
+				}
+
+				// Next steps of the repaired field still lead along the cost.
+				for (int32_t tile = edit; tile < map->GetTileCount(); tile += 37)
+				{
+					if (field.GetPath(tile, path) == false)
+					{
+						continue;
+					}
+
+					PathRequest pathRequest = request;
+					pathRequest.start = tile;
+					pathRequest.destination = path.empty() ? tile : path.front();
+
+					if (GetPathCost(*map, pathRequest, path) != expected[tile])
+					{
+						Fail("DistanceField", settings, "path cost", tile, edit, expected[tile], GetPathCost(*map, pathRequest, path));
+					}
+				}
+			}
+		}
+	}
+
+	void TestQueryCache()
+	{
+		for (const MapSettings& settings : GetMapSettings())
+		{
+			std::unique_ptr<HexMap> map = GenerateMap(settings);
+
+			AdjacencyTable adjacency;
+			adjacency.Build(map.get());
+
+			AStarSearch search;
+			search.Initialize(&adjacency);
+			RangeSearch rangeSearch;
+			rangeSearch.Initialize(&adjacency);
+
+			QueryCache cache;
+			cache.Initialize(&adjacency);
+
+			// Few queries asked over and over, like units of a team between their turns.
+			const std::vector<PathQuery> queries = GenerateQueries(*map, 6, settings.seed);
+
+			std::mt19937 random(settings.seed);
+			std::vector<int32_t> path;
+			std::vector<int32_t> visitedTiles;
+			std::vector<int32_t> tiles;
+
+			for (int32_t round = 0; round < 30; ++round)
+			{
+				if (round % 2 == 1)
+				{
+					const std::vector<int32_t> changedTiles = EditTiles(*map, random);
+					adjacency.RebuildTiles(changedTiles);
+					cache.NotifyTilesChanged(changedTiles);
+				}
+
+				for (const PathQuery& query : queries)
+				{
+					const PathRequest request = AStarSearch::MakePathRequest(query.start, query.destination, query.elementColor, true, true);
+					const QueryKey key = QueryKey::MakePathKey(request);
+					bool bFound;
+
+					if (const QueryCache::Result* cached = cache.Find(key))
+					{
+						path = cached->tiles;
+						bFound = cached->bFound;
+					}
+					else
+					{
+						bFound = search.FindPath(request, path);
+						search.GetVisitedTiles(visitedTiles);
+						cache.AddPath(key, bFound, path, visitedTiles);
+					}
+
+					CheckPath("QueryCache", settings, *map, request, bFound, path);
+
+					const int32_t distance = 4;
+					const QueryKey rangeKey = QueryKey::MakeRangeKey(query.start, distance, query.elementColor, true, false, false);
+
+					if (const QueryCache::Result* cached = cache.Find(rangeKey))
+					{
+						tiles = cached->tiles;
+					}
+					else
+					{
+						rangeSearch.GetMovementRange(query.start, distance, tiles, query.elementColor, true, false, false);
+						cache.AddRange(rangeKey, tiles);
+					}
+
+					std::sort(tiles.begin(), tiles.end());
+
+					if (tiles != GetReferenceMovementRange(*map, query.start, distance, query.elementColor, true, false, false))
+					{
+						Fail("QueryCache", settings, "range", query.start, round, 0, 1);
+					}
+				}
+			}
+
+			if (cache.GetHitCount() == 0)
+			{
+				Fail("QueryCache", settings, "hits", 0, 0, 1, 0);
+			}
+		}
+	}
+
+	struct Test
+	{
+		const char* name;
+		void (*function)();
+	};
+
+	const Test tests[] = {
+		{ "AStar", [] { TestAStar(false); } },
+		{ "Bidirectional", [] { TestAStar(true); } },
+		{ "Range", &TestRange },
+		{ "DistanceField", &TestDistanceFieldRepair },
+		{ "QueryCache", &TestQueryCache },
+	};
+}
+
+// Runs the test named by the argument, or all of them.
+int main(int argc, char** argv)
+{
+	bool bRan = false;
+
+	for (const Test& test : tests)
+	{
+		if (argc < 2 || std::strcmp(argv[1], test.name) == 0)
+		{
+			test.function();
+			bRan = true;
+		}
+	}
+
+	if (bRan == false)
+	{
+		std::printf("No test named %s\n", argv[1]);
+		return 1;
+	}
+
+	if (failureNum > 0)
+	{
+		std::printf("%d checks failed\n", failureNum);
+		return 1;
+	}
+
+	return 0;
+}